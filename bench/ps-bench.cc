@@ -0,0 +1,339 @@
+#include <ps-encoding.h>
+#include <ps-requester.h>
+#include <ps-signer.h>
+#include <ps-verification-service.h>
+#include <ps-verifier.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <memory>
+
+#include <unistd.h>
+
+using namespace mcl::bls12;
+
+/**
+ * Benchmark of every EL PASSO phase and every message encoding.
+ *
+ * Sweeps the number of attributes and the ratio of committed (hidden) attributes, and prints
+ * one record per operation and setting as CSV (default) or JSON.
+ *
+ * Usage: ps-bench [--iterations N] [--max-attributes N] [--json]
+ */
+
+struct BenchConfig {
+  size_t iterations = 20;
+  size_t max_attribute_num = 256;
+  bool json = false;
+};
+
+struct BenchResult {
+  std::string op;
+  size_t attribute_num;
+  size_t hidden_num;
+  size_t iterations;
+  double p50_us;
+  double p99_us;
+  double mean_us;
+  double ops_per_sec;
+};
+
+static double
+percentile(const std::vector<double>& sorted, double p)
+{
+  // nearest-rank percentile
+  size_t rank = static_cast<size_t>(p * sorted.size() + 0.999999);
+  rank = std::min(std::max<size_t>(rank, 1), sorted.size());
+  return sorted[rank - 1];
+}
+
+// Runs @p op for the configured number of iterations, timing each run separately.
+static BenchResult
+measure(const std::string& name, size_t attribute_num, size_t hidden_num, size_t iterations,
+        const std::function<void()>& op)
+{
+  std::vector<double> samples;
+  samples.reserve(iterations);
+  for (size_t i = 0; i < iterations; i++) {
+    auto begin = std::chrono::steady_clock::now();
+    op();
+    auto end = std::chrono::steady_clock::now();
+    samples.push_back(std::chrono::duration<double, std::micro>(end - begin).count());
+  }
+  std::sort(samples.begin(), samples.end());
+  double total = 0;
+  for (auto sample : samples) {
+    total += sample;
+  }
+  BenchResult result;
+  result.op = name;
+  result.attribute_num = attribute_num;
+  result.hidden_num = hidden_num;
+  result.iterations = iterations;
+  result.p50_us = percentile(samples, 0.50);
+  result.p99_us = percentile(samples, 0.99);
+  result.mean_us = total / iterations;
+  result.ops_per_sec = total > 0 ? iterations * 1e6 / total : 0;
+  return result;
+}
+
+// The first hidden_num attributes are committed. The first attribute is the user's secret s and
+// the second one is gamma used by the identity retrieval token, so both are always committed.
+static std::vector<std::tuple<std::string, bool>>
+make_attributes(size_t attribute_num, size_t hidden_num)
+{
+  std::vector<std::tuple<std::string, bool>> attributes;
+  attributes.reserve(attribute_num);
+  for (size_t i = 0; i < attribute_num; i++) {
+    attributes.push_back(std::make_tuple("attribute-" + std::to_string(i), i < hidden_num));
+  }
+  return attributes;
+}
+
+static void
+bench_setting(size_t attribute_num, size_t hidden_num, size_t iterations,
+              std::vector<BenchResult>& results)
+{
+  G1 g, h, authority_pk;
+  G2 gg;
+  hashAndMapToG1(g, "abc");
+  hashAndMapToG2(gg, "edf");
+  hashAndMapToG1(authority_pk, "ghi");
+  hashAndMapToG1(h, "jkl");
+  auto attributes = make_attributes(attribute_num, hidden_num);
+  bool with_id_retrieval = attribute_num >= 2;
+
+  // IdP-KeyGen
+  PSSigner idp(attribute_num, g, gg);
+  PSPubKey pk;
+  results.push_back(measure("KeyGen", attribute_num, hidden_num, iterations, [&] { pk = idp.key_gen(); }));
+
+  PSRequester user(pk);
+  PSVerifier rp(pk);
+  rp.register_service_name("service");
+
+  // User-RequestID
+  PSIssuanceSession session;
+  results.push_back(measure("RequestID", attribute_num, hidden_num, iterations,
+                            [&] { session = user.el_passo_request_id(attributes, "hello"); }));
+
+  // IdP-ProvideID
+  PSCredential sig;
+  bool ok = true;
+  results.push_back(measure("ProvideID", attribute_num, hidden_num, iterations,
+                            [&] { ok &= idp.el_passo_provide_id(session.request, "hello", sig); }));
+  if (!ok) {
+    throw std::runtime_error("ProvideID rejected a valid request");
+  }
+
+  // User-UnblindID
+  PSCredential ubld_sig;
+  results.push_back(measure("Unblind", attribute_num, hidden_num, iterations,
+                            [&] { ubld_sig = user.unblind_credential(sig, session); }));
+
+  // User-ProveID and RP-VerifyID
+  IdProof proof;
+  if (with_id_retrieval) {
+    results.push_back(measure("ProveID", attribute_num, hidden_num, iterations, [&] {
+      proof = user.el_passo_prove_id(ubld_sig, attributes, "hello", "service", authority_pk, g, h);
+    }));
+    results.push_back(measure("VerifyID", attribute_num, hidden_num, iterations, [&] {
+      ok &= rp.el_passo_verify_id(proof, "hello", "service", authority_pk, g, h);
+    }));
+  }
+  IdProof proof_without_id_retrieval;
+  results.push_back(measure("ProveIDWithoutIdRetrieval", attribute_num, hidden_num, iterations, [&] {
+    proof_without_id_retrieval = user.el_passo_prove_id_without_id_retrieval(ubld_sig, attributes, "hello", "service");
+  }));
+  results.push_back(measure("VerifyIDWithoutIdRetrieval", attribute_num, hidden_num, iterations, [&] {
+    ok &= rp.el_passo_verify_id_without_id_retrieval(proof_without_id_retrieval, "hello", "service");
+  }));
+
+  // RP-VerifyID of 16 encoded proofs at once through the pipelined service on all cores
+  {
+    PSVerificationService service(rp, "service");
+    PSBuffer encoded = proof_without_id_retrieval.toBufferString();
+    results.push_back(measure("VerifyIDService16", attribute_num, hidden_num, iterations, [&] {
+      std::vector<std::future<bool>> verified;
+      for (size_t i = 0; i < 16; i++) {
+        verified.push_back(service.submit(encoded, "hello"));
+      }
+      for (auto& result : verified) {
+        ok &= result.get();
+      }
+    }));
+  }
+
+  // User-ProveID with a stored credential, which reuses the attribute hashes and YYi^mi
+  std::vector<std::string> all_attributes;
+  std::vector<bool> hidden;
+  for (const auto& attribute : attributes) {
+    all_attributes.push_back(std::get<0>(attribute));
+    hidden.push_back(std::get<1>(attribute));
+  }
+  auto credential = user.store_credential(ubld_sig, all_attributes);
+  IdProof stored_proof;
+  results.push_back(measure("ProveIDStoredCredential", attribute_num, hidden_num, iterations, [&] {
+    stored_proof = user.el_passo_prove_id_without_id_retrieval(credential, hidden, "hello", "service");
+  }));
+  ok &= rp.el_passo_verify_id_without_id_retrieval(stored_proof, "hello", "service");
+  if (!ok) {
+    throw std::runtime_error("VerifyID rejected a valid proof");
+  }
+
+  // Encoding and decoding of every message
+  PSBuffer buffer;
+  results.push_back(measure("EncodePubKey", attribute_num, hidden_num, iterations,
+                            [&] { buffer = pk.toBufferString(); }));
+  results.push_back(measure("DecodePubKey", attribute_num, hidden_num, iterations,
+                            [&] { pk = PSPubKey::fromBufferString(buffer); }));
+  results.push_back(measure("EncodeCredRequest", attribute_num, hidden_num, iterations,
+                            [&] { buffer = session.request.toBufferString(); }));
+  results.push_back(measure("DecodeCredRequest", attribute_num, hidden_num, iterations,
+                            [&] { session.request = PSCredRequest::fromBufferString(buffer); }));
+  results.push_back(measure("EncodeCredential", attribute_num, hidden_num, iterations,
+                            [&] { buffer = sig.toBufferString(); }));
+  results.push_back(measure("DecodeCredential", attribute_num, hidden_num, iterations,
+                            [&] { sig = PSCredential::fromBufferString(buffer); }));
+  if (!with_id_retrieval) {
+    proof = proof_without_id_retrieval;
+  }
+  results.push_back(measure("EncodeIdProof", attribute_num, hidden_num, iterations,
+                            [&] { buffer = proof.toBufferString(); }));
+  results.push_back(measure("DecodeIdProof", attribute_num, hidden_num, iterations,
+                            [&] { proof = IdProof::fromBufferString(buffer); }));
+  results.push_back(measure("ParseIdProofView", attribute_num, hidden_num, iterations,
+                            [&] { IdProofView view(buffer); }));
+  // garbage is rejected by the layout checks before any element is deserialized
+  PSBuffer truncated(buffer);
+  truncated.pop_back();
+  results.push_back(measure("RejectTruncatedIdProof", attribute_num, hidden_num, iterations,
+                            [&] { ok &= IdProof::tryFromBufferString(truncated, proof) != PSDecodeStatus::Ok; }));
+  if (!ok) {
+    throw std::runtime_error("a truncated IdProof was decoded");
+  }
+  // a replayed proof is rejected by the replay cache before any curve arithmetic
+  PSVerifier replay_rp(pk);
+  replay_rp.set_replay_cache(std::make_shared<PSReplayCache>(std::chrono::minutes(5)));
+  auto replay_verify = [&] {
+    if (with_id_retrieval) {
+      return replay_rp.el_passo_verify_id(IdProofView(buffer), "hello", "service", authority_pk, g, h);
+    }
+    return replay_rp.el_passo_verify_id_without_id_retrieval(IdProofView(buffer), "hello", "service");
+  };
+  ok &= replay_verify();
+  results.push_back(measure("RejectReplayedIdProof", attribute_num, hidden_num, iterations,
+                            [&] { ok &= !replay_verify(); }));
+  if (!ok) {
+    throw std::runtime_error("a replayed IdProof was accepted");
+  }
+  // a byte-identical retry is answered by the result cache without any curve arithmetic
+  replay_rp.set_result_cache(std::make_shared<PSResultCache>(1024, std::chrono::minutes(1)));
+  replay_rp.set_replay_cache(nullptr);
+  results.push_back(measure("VerifyIDRetryCached", attribute_num, hidden_num, iterations,
+                            [&] { ok &= replay_verify(); }));
+  if (!ok) {
+    throw std::runtime_error("a retried IdProof was rejected");
+  }
+
+  // the account of a verified user, looked up by its binary ID in an index of 100000 accounts
+  std::string index_path = "/tmp/ps-bench-accounts-" + std::to_string(::getpid()) + ".idx";
+  ::unlink(index_path.c_str());
+  {
+    PSAccountIndex index(index_path, 100000);
+    PSAccountId other_id{};
+    for (uint64_t i = 0; i < 100000; i++) {
+      std::memcpy(other_id.data(), &i, sizeof(i));
+      index.insert(other_id, i);
+    }
+    PSAccountId user_id;
+    ok &= PSVerifier::get_user_id_from_signon_request(IdProofView(buffer), user_id);
+    index.insert(user_id, 100000);
+    results.push_back(measure("LookupAccount", attribute_num, hidden_num, iterations, [&] {
+      uint64_t record;
+      ok &= PSVerifier::get_user_id_from_signon_request(IdProofView(buffer), user_id)
+            && index.find(user_id, record) && record == 100000;
+    }));
+  }
+  ::unlink(index_path.c_str());
+  if (!ok) {
+    throw std::runtime_error("the account of a user was not found");
+  }
+}
+
+static void
+print_csv(const std::vector<BenchResult>& results)
+{
+  std::cout << "op,attributes,hidden,iterations,p50_us,p99_us,mean_us,ops_per_sec" << std::endl;
+  for (const auto& r : results) {
+    std::cout << r.op << "," << r.attribute_num << "," << r.hidden_num << "," << r.iterations << ","
+              << r.p50_us << "," << r.p99_us << "," << r.mean_us << "," << r.ops_per_sec << std::endl;
+  }
+}
+
+static void
+print_json(const std::vector<BenchResult>& results)
+{
+  std::cout << "[" << std::endl;
+  for (size_t i = 0; i < results.size(); i++) {
+    const auto& r = results[i];
+    std::cout << "  {\"op\": \"" << r.op << "\", \"attributes\": " << r.attribute_num
+              << ", \"hidden\": " << r.hidden_num << ", \"iterations\": " << r.iterations
+              << ", \"p50_us\": " << r.p50_us << ", \"p99_us\": " << r.p99_us
+              << ", \"mean_us\": " << r.mean_us << ", \"ops_per_sec\": " << r.ops_per_sec << "}"
+              << (i + 1 < results.size() ? "," : "") << std::endl;
+  }
+  std::cout << "]" << std::endl;
+}
+
+int
+main(int argc, char const *argv[])
+{
+  BenchConfig config;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--json") == 0) {
+      config.json = true;
+    }
+    else if (strcmp(argv[i], "--iterations") == 0 && i + 1 < argc) {
+      config.iterations = std::max(1, atoi(argv[++i]));
+    }
+    else if (strcmp(argv[i], "--max-attributes") == 0 && i + 1 < argc) {
+      config.max_attribute_num = std::max(1, atoi(argv[++i]));
+    }
+    else {
+      std::cerr << "Usage: " << argv[0] << " [--iterations N] [--max-attributes N] [--json]" << std::endl;
+      return 1;
+    }
+  }
+
+  initPairing();
+  std::vector<BenchResult> results;
+  // attribute numbers 1, 2, 4, ..., max; committed ratios 1/4, 1/2, and all
+  const std::vector<std::pair<size_t, size_t>> hidden_ratios = {{1, 4}, {1, 2}, {1, 1}};
+  for (size_t attribute_num = 1; attribute_num <= config.max_attribute_num; attribute_num *= 2) {
+    std::vector<size_t> hidden_nums;
+    for (const auto& ratio : hidden_ratios) {
+      size_t hidden_num = std::max<size_t>(std::min<size_t>(2, attribute_num),
+                                           attribute_num * ratio.first / ratio.second);
+      if (std::find(hidden_nums.begin(), hidden_nums.end(), hidden_num) == hidden_nums.end()) {
+        hidden_nums.push_back(hidden_num);
+      }
+    }
+    for (auto hidden_num : hidden_nums) {
+      std::cerr << "benchmarking " << attribute_num << " attributes, " << hidden_num << " committed" << std::endl;
+      bench_setting(attribute_num, hidden_num, config.iterations, results);
+    }
+  }
+
+  if (config.json) {
+    print_json(results);
+  }
+  else {
+    print_csv(results);
+  }
+  return 0;
+}
@@ -0,0 +1,155 @@
+#include <ps-issuance-socket.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <memory>
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+
+using namespace mcl::bls12;
+
+/**
+ * EL PASSO IdP daemon.
+ *
+ * Loads the key pair from a file, or generates it and writes the file on the first start, writes
+ * the base64 public key to a file, and signs the ID requests sent to a Unix domain socket until
+ * SIGINT or SIGTERM. See PSIssuanceSocketServer for the protocol. The key file holds the base64
+ * PSSecretKey and is created readable by its owner only; --attributes only applies when it is created.
+ *
+ * Usage: el-passo-idpd --socket PATH --key FILE --pubkey FILE [--attributes N] [--threads N]
+ *                      [--batch N] [--window-us N] [--stats-interval S]
+ */
+
+struct DaemonConfig {
+  std::string socket_path;
+  std::string key_path;
+  std::string pubkey_path;
+  size_t attribute_num = 8;
+  size_t thread_num = 0;
+  size_t max_batch = 64;
+  long window_us = 2000;
+  long stats_interval = 60;  // seconds, 0 to never print the stats
+};
+
+static bool
+parse_args(int argc, char const *argv[], DaemonConfig& config)
+{
+  for (int i = 1; i + 1 < argc; i += 2) {
+    if (strcmp(argv[i], "--socket") == 0) {
+      config.socket_path = argv[i + 1];
+    }
+    else if (strcmp(argv[i], "--key") == 0) {
+      config.key_path = argv[i + 1];
+    }
+    else if (strcmp(argv[i], "--pubkey") == 0) {
+      config.pubkey_path = argv[i + 1];
+    }
+    else if (strcmp(argv[i], "--attributes") == 0) {
+      config.attribute_num = std::max(1, atoi(argv[i + 1]));
+    }
+    else if (strcmp(argv[i], "--threads") == 0) {
+      config.thread_num = std::max(0, atoi(argv[i + 1]));
+    }
+    else if (strcmp(argv[i], "--batch") == 0) {
+      config.max_batch = std::max(1, atoi(argv[i + 1]));
+    }
+    else if (strcmp(argv[i], "--window-us") == 0) {
+      config.window_us = std::max(0, atoi(argv[i + 1]));
+    }
+    else if (strcmp(argv[i], "--stats-interval") == 0) {
+      config.stats_interval = std::max(0, atoi(argv[i + 1]));
+    }
+    else {
+      return false;
+    }
+  }
+  return argc % 2 == 1 && !config.socket_path.empty() && !config.key_path.empty() && !config.pubkey_path.empty();
+}
+
+// the signer of the key in @p config.key_path, with a new key written there if the file does not exist
+static std::unique_ptr<PSSigner>
+load_signer(const DaemonConfig& config)
+{
+  std::ifstream key_file(config.key_path);
+  if (key_file) {
+    std::string base64;
+    key_file >> base64;
+    return std::make_unique<PSSigner>(PSSecretKey::fromBufferString(PSBuffer::fromBase64(base64)));
+  }
+  auto signer = std::make_unique<PSSigner>(config.attribute_num);
+  signer->key_gen();
+  auto base64 = signer->get_secret_key().toBufferString().toBase64() + "\n";
+  int fd = ::open(config.key_path.c_str(), O_WRONLY | O_CREAT | O_EXCL, 0600);
+  if (fd < 0) {
+    throw std::runtime_error("cannot create " + config.key_path + ": " + strerror(errno));
+  }
+  bool written = ::write(fd, base64.data(), base64.size()) == static_cast<ssize_t>(base64.size()) && ::fsync(fd) == 0;
+  ::close(fd);
+  if (!written) {
+    ::unlink(config.key_path.c_str());
+    throw std::runtime_error("cannot write " + config.key_path);
+  }
+  return signer;
+}
+
+int
+main(int argc, char const *argv[])
+{
+  DaemonConfig config;
+  if (!parse_args(argc, argv, config)) {
+    std::cerr << "Usage: " << argv[0] << " --socket PATH --key FILE --pubkey FILE [--attributes N]"
+              << " [--threads N] [--batch N] [--window-us N] [--stats-interval S]" << std::endl;
+    return 1;
+  }
+  // handled by sigtimedwait() below; blocked before any thread starts so that they inherit the mask
+  sigset_t signals;
+  sigemptyset(&signals);
+  sigaddset(&signals, SIGINT);
+  sigaddset(&signals, SIGTERM);
+  pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+
+  initPairing();
+  std::unique_ptr<PSSigner> signer;
+  try {
+    signer = load_signer(config);
+  }
+  catch (std::runtime_error& e) {
+    std::cerr << "cannot load the key: " << e.what() << std::endl;
+    return 1;
+  }
+  auto pk = signer->get_pub_key();
+  {
+    std::ofstream pubkey(config.pubkey_path);
+    pubkey << pk.toBufferString().toBase64() << std::endl;
+    if (!pubkey) {
+      std::cerr << "cannot write " << config.pubkey_path << std::endl;
+      return 1;
+    }
+  }
+
+  PSIssuanceService service(*signer, config.thread_num, 1024, config.max_batch,
+                            std::chrono::microseconds(config.window_us));
+  PSIssuanceSocketServer server(service, config.socket_path);
+  std::cerr << "listening on " << config.socket_path << std::endl;
+
+  timespec interval{config.stats_interval > 0 ? config.stats_interval : 3600, 0};
+  while (sigtimedwait(&signals, nullptr, &interval) < 0) {
+    if (errno == EAGAIN && config.stats_interval > 0) {
+      auto stats = service.stats();
+      std::cerr << "queue_depth=" << stats.queue_depth << " in_flight=" << stats.in_flight
+                << " issued=" << stats.issued << " rejected=" << stats.rejected
+                << " mean_batch_size=" << stats.mean_batch_size << " p50_latency_us=" << stats.p50_latency_us
+                << " p99_latency_us=" << stats.p99_latency_us << std::endl;
+    }
+  }
+  std::cerr << "stopping" << std::endl;
+  return 0;
+}
@@ -0,0 +1,220 @@
+#include "ps-account-index.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static const char PS_ACCOUNT_INDEX_MAGIC[8] = {'P', 'S', 'A', 'C', 'C', 'I', 'D', 'X'};
+static const uint32_t PS_ACCOUNT_INDEX_VERSION = 1;
+
+// the record of a slot: 0 while empty, ERASED once erased, record + 1 otherwise
+static const uint64_t EMPTY = 0;
+static const uint64_t ERASED = UINT64_MAX;
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "the index is shared through lock-free atomics");
+
+struct PSAccountIndex::Header {
+  char magic[8];
+  uint32_t version;
+  uint32_t slot_size;
+  uint64_t slot_num;
+  std::atomic<uint64_t> size;  // accounts in the index
+  uint64_t used;               // slots with an id, including erased ones
+  uint8_t reserved[24];
+};
+
+struct PSAccountIndex::Slot {
+  std::atomic<uint64_t> record;
+  PSAccountId id;
+};
+
+static_assert(sizeof(std::atomic<uint64_t>) == sizeof(uint64_t), "unexpected atomic layout");
+
+PSAccountIndex::PSAccountIndex(const std::string& path, size_t max_accounts)
+{
+  map(path, true, max_accounts);
+}
+
+PSAccountIndex::PSAccountIndex(const std::string& path)
+{
+  map(path, false, 0);
+}
+
+PSAccountIndex::~PSAccountIndex()
+{
+  if (m_data != nullptr) {
+    munmap(m_data, m_size);
+  }
+  if (m_fd >= 0) {
+    close(m_fd);
+  }
+}
+
+void
+PSAccountIndex::map(const std::string& path, bool writable, size_t max_accounts)
+{
+  static_assert(sizeof(Header) == 64 && sizeof(Slot) == 40, "unexpected file layout");
+  auto fail = [this](const char* message) {
+    if (m_data != nullptr) {
+      munmap(m_data, m_size);
+    }
+    close(m_fd);
+    throw std::runtime_error(message);
+  };
+  m_writable = writable;
+  m_fd = open(path.c_str(), writable ? O_RDWR | O_CREAT : O_RDONLY, 0644);
+  if (m_fd < 0) {
+    throw std::runtime_error("cannot open account index");
+  }
+  // the lock goes with the file descriptor, so it is released however the writer ends
+  if (writable && flock(m_fd, LOCK_EX | LOCK_NB) != 0) {
+    fail("account index is open for writing elsewhere");
+  }
+  struct stat _stat;
+  if (fstat(m_fd, &_stat) != 0) {
+    fail("cannot open account index");
+  }
+  bool _create = writable && _stat.st_size == 0;
+  uint64_t _slot_num = 0;
+  if (_create) {
+    // at most 3/4 full, so that probe sequences stay short
+    _slot_num = 1;
+    while (_slot_num / 4 * 3 < std::max<uint64_t>(max_accounts, 1)) {
+      _slot_num *= 2;
+    }
+    // the slots are left as holes in the file, they are empty as long as they read as zeros
+    if (ftruncate(m_fd, sizeof(Header) + _slot_num * sizeof(Slot)) != 0) {
+      fail("cannot create account index");
+    }
+    m_size = sizeof(Header) + _slot_num * sizeof(Slot);
+  }
+  else {
+    m_size = _stat.st_size;
+    if (m_size < sizeof(Header)) {
+      fail("not an account index");
+    }
+  }
+  void* _data = mmap(nullptr, m_size, writable ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, m_fd, 0);
+  if (_data == MAP_FAILED) {
+    fail("cannot map account index");
+  }
+  m_data = static_cast<uint8_t*>(_data);
+  m_header = reinterpret_cast<Header*>(m_data);
+  m_slots = reinterpret_cast<Slot*>(m_data + sizeof(Header));
+  if (_create) {
+    m_header->version = PS_ACCOUNT_INDEX_VERSION;
+    m_header->slot_size = sizeof(Slot);
+    m_header->slot_num = _slot_num;
+    std::memcpy(m_header->magic, PS_ACCOUNT_INDEX_MAGIC, sizeof(m_header->magic));  // last, the header is complete
+  }
+  _slot_num = m_header->slot_num;
+  if (std::memcmp(m_header->magic, PS_ACCOUNT_INDEX_MAGIC, sizeof(m_header->magic)) != 0
+      || m_header->version != PS_ACCOUNT_INDEX_VERSION || m_header->slot_size != sizeof(Slot)
+      || _slot_num == 0 || (_slot_num & (_slot_num - 1)) != 0
+      || _slot_num > (m_size - sizeof(Header)) / sizeof(Slot)
+      || m_size != sizeof(Header) + _slot_num * sizeof(Slot)) {
+    fail("not an account index");
+  }
+  m_mask = _slot_num - 1;
+}
+
+bool
+PSAccountIndex::find(const PSAccountId& id, uint64_t& record) const
+{
+  uint64_t _record;
+  probe(id, _record);
+  if (_record == EMPTY || _record == ERASED) {
+    return false;
+  }
+  record = _record - 1;
+  return true;
+}
+
+void
+PSAccountIndex::insert(const PSAccountId& id, uint64_t record)
+{
+  if (!m_writable) {
+    throw std::runtime_error("account index is read-only");
+  }
+  if (record > MAX_RECORD) {
+    throw std::runtime_error("account record too large");
+  }
+  uint64_t _previous;
+  auto _slot = probe(id, _previous);
+  if (_slot == nullptr) {
+    throw std::runtime_error("corrupt account index");
+  }
+  if (_previous == EMPTY) {
+    if (m_header->used + 1 > (m_mask + 1) / 4 * 3) {
+      throw std::runtime_error("account index full");
+    }
+    // the id is written before the record is published, readers only compare ids of published slots
+    _slot->id = id;
+    m_header->used++;
+  }
+  _slot->record.store(record + 1, std::memory_order_release);
+  if (_previous == EMPTY || _previous == ERASED) {
+    m_header->size.fetch_add(1, std::memory_order_relaxed);
+  }
+}
+
+bool
+PSAccountIndex::erase(const PSAccountId& id)
+{
+  if (!m_writable) {
+    throw std::runtime_error("account index is read-only");
+  }
+  uint64_t _previous;
+  auto _slot = probe(id, _previous);
+  if (_slot == nullptr || _previous == EMPTY || _previous == ERASED) {
+    return false;
+  }
+  // the slot keeps its id, so that the probe sequences through it stay intact
+  _slot->record.store(ERASED, std::memory_order_release);
+  m_header->size.fetch_sub(1, std::memory_order_relaxed);
+  return true;
+}
+
+size_t
+PSAccountIndex::size() const
+{
+  return m_header->size.load(std::memory_order_relaxed);
+}
+
+size_t
+PSAccountIndex::capacity() const
+{
+  return (m_mask + 1) / 4 * 3;
+}
+
+void
+PSAccountIndex::sync()
+{
+  if (m_writable && msync(m_data, m_size, MS_SYNC) != 0) {
+    throw std::runtime_error("cannot sync account index");
+  }
+}
+
+PSAccountIndex::Slot*
+PSAccountIndex::probe(const PSAccountId& id, uint64_t& record) const
+{
+  // the id is a hash already, its first bytes pick the slot
+  uint64_t _hash;
+  std::memcpy(&_hash, id.data(), sizeof(_hash));
+  // a valid index always has an empty slot, a corrupt one may not
+  for (uint64_t n = 0, i = _hash & m_mask; n <= m_mask; n++, i = (i + 1) & m_mask) {
+    record = m_slots[i].record.load(std::memory_order_acquire);
+    if (record == EMPTY || m_slots[i].id == id) {
+      return &m_slots[i];
+    }
+  }
+  record = EMPTY;
+  return nullptr;
+}
@@ -0,0 +1,127 @@
+#ifndef PS_SRC_PS_ACCOUNT_INDEX_H_
+#define PS_SRC_PS_ACCOUNT_INDEX_H_
+
+#include <array>
+#include <cstdint>
+#include <string>
+
+/**
+ * @brief The binary identifier of a user at an RP: SHA-256 of the compressed encoding of phi.
+ *
+ * See PSVerifier::get_user_id_from_signon_request(). It is uniformly distributed, so PSAccountIndex
+ * uses its first bytes as the hash of the account.
+ */
+using PSAccountId = std::array<uint8_t, 32>;
+
+/**
+ * @brief A persistent hash index from PSAccountId to an account record, e.g., the row number of the
+ *        account in the RP's database.
+ *
+ * The index is an open addressing table with linear probing stored in a file and memory-mapped,
+ * so opening it only maps the file, whatever the number of accounts. The table never grows:
+ * create it with room for the expected accounts, insert() throws once it is 3/4 full.
+ *
+ * One writer, the object that created or opened the file for writing, may insert and erase
+ * accounts while any number of threads, or processes with a read-only index, call find().
+ * The writer holds an exclusive flock() on the file, so a second writer fails to open it.
+ * Readers never take a lock: a slot is published by an atomic store of its record after its id
+ * is written, and an id is never rewritten once published, so erased slots are not reused.
+ *
+ * The file uses the byte order of the host. After a crash, accounts inserted since the last sync()
+ * may be lost, and size() may be off, but a lost insertion never leaves a slot half written.
+ */
+class PSAccountIndex {
+public:
+  static const uint64_t MAX_RECORD = UINT64_MAX - 2;  // the largest record that can be stored
+
+  /**
+   * @brief Open the index at @p path for writing, creating it if the file is missing or empty.
+   *
+   * Throws std::runtime_error if the file cannot be opened or mapped, is not an account index,
+   * or is already open for writing, by this process or another one.
+   *
+   * @param path input The file of the index.
+   * @param max_accounts input The number of accounts the index must hold if it is created.
+   *        The file takes 54 to 107 bytes per account, as the table is rounded up to a power of two.
+   */
+  PSAccountIndex(const std::string& path, size_t max_accounts);
+
+  /**
+   * @brief Open an existing index at @p path for reading only.
+   *
+   * The index sees the accounts the writer inserts after it is opened.
+   */
+  explicit PSAccountIndex(const std::string& path);
+
+  ~PSAccountIndex();
+
+  PSAccountIndex(const PSAccountIndex&) = delete;
+  PSAccountIndex&
+  operator=(const PSAccountIndex&) = delete;
+
+  /**
+   * @brief Look up an account. Lock-free, may run concurrently with the writer.
+   *
+   * @return bool True with the record of the account in @p record if it is in the index.
+   */
+  bool
+  find(const PSAccountId& id, uint64_t& record) const;
+
+  /**
+   * @brief Insert an account, or replace the record of an existing one. Writer only.
+   *
+   * Throws std::runtime_error if the index is read-only, full or corrupt, or @p record exceeds
+   * MAX_RECORD.
+   */
+  void
+  insert(const PSAccountId& id, uint64_t record);
+
+  /**
+   * @brief Remove an account. Writer only; its slot stays used until the index is rebuilt.
+   *
+   * @return bool False if the account is not in the index.
+   */
+  bool
+  erase(const PSAccountId& id);
+
+  /**
+   * @brief The number of accounts in the index.
+   */
+  size_t
+  size() const;
+
+  /**
+   * @brief The number of accounts the index can hold.
+   */
+  size_t
+  capacity() const;
+
+  /**
+   * @brief Write the changes to the file. Writer only.
+   */
+  void
+  sync();
+
+private:
+  struct Header;
+  struct Slot;
+
+  void
+  map(const std::string& path, bool writable, size_t max_accounts);
+
+  // the slot holding @p id, or the empty slot ending its probe sequence, with its record as loaded;
+  // nullptr if a corrupt index has neither
+  Slot*
+  probe(const PSAccountId& id, uint64_t& record) const;
+
+private:
+  int m_fd = -1;
+  uint8_t* m_data = nullptr;
+  size_t m_size = 0;
+  bool m_writable = false;
+  Header* m_header = nullptr;
+  Slot* m_slots = nullptr;
+  uint64_t m_mask = 0;  // slot number - 1, a power of two minus one
+};
+
+#endif  // PS_SRC_PS_ACCOUNT_INDEX_H_
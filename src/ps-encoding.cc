@@ -1,6 +1,9 @@
 #include "ps-encoding.h"
 
-char buf[1024];
+#include <stdexcept>
+
+#include "ps-msm.h"
+#include "ps-pairing.h"
 
 static const std::string base64_chars = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
 
@@ -107,6 +110,377 @@ probeVarSize(size_t var)
   return 0;
 }
 
+// serialize an mcl element straight into the end of @p buffer, prefixed with its length
+template <class T>
+static void
+appendSerialized(PSBuffer& buffer, const T& item, size_t maxSize, int ioMode = mcl::IoSerialize)
+{
+  // elements are always shorter than 253 bytes, so the length takes one byte
+  size_t offset = buffer.size();
+  buffer.resize(offset + 1 + maxSize);
+  size_t size = item.serialize(buffer.data() + offset + 1, maxSize, ioMode);
+  if (size == 0 || size >= 253) {
+    buffer.resize(offset);
+    throw std::runtime_error("element serialization failed");
+  }
+  buffer[offset] = static_cast<uint8_t>(size);
+  buffer.resize(offset + 1 + size);
+}
+
+static size_t
+maxG1Size()
+{
+  return Fp::getByteSize() * 2;
+}
+
+static size_t
+maxG2Size()
+{
+  return Fp::getByteSize() * 4;
+}
+
+static int
+ioModeOf(PSPointFormat format)
+{
+  return format == PSPointFormat::Uncompressed ? mcl::IoEcAffineSerialize : mcl::IoSerialize;
+}
+
+const char*
+ps_decode_status_message(PSDecodeStatus status)
+{
+  switch (status) {
+  case PSDecodeStatus::Ok:
+    return "ok";
+  case PSDecodeStatus::Truncated:
+    return "truncated buffer";
+  case PSDecodeStatus::UnexpectedType:
+    return "unexpected element type";
+  case PSDecodeStatus::BadLength:
+    return "bad element length";
+  case PSDecodeStatus::UnsupportedVersion:
+    return "unsupported proof version";
+  case PSDecodeStatus::InvalidElement:
+    return "invalid point or scalar";
+  case PSDecodeStatus::TrailingBytes:
+    return "trailing bytes";
+  }
+  return "unknown decoding error";
+}
+
+// where an element sits in a buffer
+struct PSSlice {
+  size_t offset = 0;
+  size_t size = 0;
+  PSPointFormat format = PSPointFormat::Compressed;
+};
+
+/**
+ * Walks the layout of an encoded message without deserializing anything. Every length is checked
+ * against the element type and the end of the buffer before it is used. After the first failure
+ * all reads are no-ops, so callers check status() once at the end.
+ */
+class PSBufferReader {
+public:
+  PSBufferReader(const uint8_t* data, size_t size)
+      : m_data(data)
+      , m_size(size)
+  {
+  }
+
+  PSDecodeStatus
+  status() const
+  {
+    return m_status;
+  }
+
+  bool
+  atEnd() const
+  {
+    return m_offset >= m_size;
+  }
+
+  // the version is optional: without a version element the proof is a HexTranscript proof
+  void
+  readVersion(PSProofVersion& version)
+  {
+    version = PSProofVersion::HexTranscript;
+    if (m_status != PSDecodeStatus::Ok || atEnd() || m_data[m_offset] != static_cast<uint8_t>(PSEncodingType::Version)) {
+      return;
+    }
+    m_offset++;
+    size_t var = 0;
+    if (!readVar(var)) {
+      return;
+    }
+    if (var != static_cast<size_t>(PSProofVersion::BinaryTranscript)) {
+      fail(PSDecodeStatus::UnsupportedVersion);
+      return;
+    }
+    version = static_cast<PSProofVersion>(var);
+  }
+
+  template <class Slice>
+  void
+  readG1(Slice& slice)
+  {
+    readPoint(PSEncodingType::G1, PSEncodingType::G1Uncompressed, Fp::getByteSize(), slice);
+  }
+
+  template <class Slice>
+  void
+  readG2(Slice& slice)
+  {
+    readPoint(PSEncodingType::G2, PSEncodingType::G2Uncompressed, Fp::getByteSize() * 2, slice);
+  }
+
+  template <class Slice>
+  void
+  readFr(Slice& slice)
+  {
+    if (readType(PSEncodingType::Fr)) {
+      readBody(Fr::getByteSize(), slice);
+    }
+  }
+
+  template <class Slice>
+  void
+  readG1List(std::vector<Slice>& slices)
+  {
+    readPointList(PSEncodingType::G1List, PSEncodingType::G1ListUncompressed, Fp::getByteSize(), slices);
+  }
+
+  template <class Slice>
+  void
+  readG2List(std::vector<Slice>& slices)
+  {
+    readPointList(PSEncodingType::G2List, PSEncodingType::G2ListUncompressed, Fp::getByteSize() * 2, slices);
+  }
+
+  template <class Slice>
+  void
+  readFrList(std::vector<Slice>& slices)
+  {
+    size_t count = 0;
+    if (!readType(PSEncodingType::FrList) || !readCount(1 + Fr::getByteSize(), count)) {
+      return;
+    }
+    slices.resize(count);
+    for (auto& slice : slices) {
+      readBody(Fr::getByteSize(), slice);
+    }
+  }
+
+  // the bitmap is optional: @p slots is left empty if the next element is not a bitmap
+  void
+  readSlotBitmap(std::vector<bool>& slots)
+  {
+    if (m_status != PSDecodeStatus::Ok || atEnd() || m_data[m_offset] != static_cast<uint8_t>(PSEncodingType::SlotBitmap)) {
+      return;
+    }
+    m_offset++;
+    size_t bitNum = 0;
+    if (!readVar(bitNum)) {
+      return;
+    }
+    size_t byteNum = (bitNum + 7) / 8;
+    if (byteNum > m_size - m_offset) {
+      fail(PSDecodeStatus::Truncated);
+      return;
+    }
+    // padding bits must be zero, so that a bitmap has a single encoding
+    if (bitNum % 8 != 0 && (m_data[m_offset + byteNum - 1] >> (bitNum % 8)) != 0) {
+      fail(PSDecodeStatus::BadLength);
+      return;
+    }
+    slots.resize(bitNum);
+    for (size_t i = 0; i < bitNum; i++) {
+      slots[i] = (m_data[m_offset + i / 8] >> (i % 8)) & 1;
+    }
+    m_offset += byteNum;
+  }
+
+  void
+  readStrList(std::vector<std::string_view>& strs)
+  {
+    size_t count = 0;
+    if (!readType(PSEncodingType::StrList) || !readCount(1, count)) {
+      return;
+    }
+    strs.reserve(count);
+    PSSlice slice;
+    for (size_t i = 0; i < count && readBody(0, slice); i++) {
+      strs.emplace_back(reinterpret_cast<const char*>(m_data + slice.offset), slice.size);
+    }
+  }
+
+  // fail with TrailingBytes unless the whole buffer has been read
+  PSDecodeStatus
+  finish()
+  {
+    if (m_status == PSDecodeStatus::Ok && m_offset != m_size) {
+      fail(PSDecodeStatus::TrailingBytes);
+    }
+    return m_status;
+  }
+
+private:
+  bool
+  fail(PSDecodeStatus status)
+  {
+    if (m_status == PSDecodeStatus::Ok) {
+      m_status = status;
+    }
+    return false;
+  }
+
+  bool
+  readType(PSEncodingType type)
+  {
+    if (m_status != PSDecodeStatus::Ok) {
+      return false;
+    }
+    if (atEnd()) {
+      return fail(PSDecodeStatus::Truncated);
+    }
+    if (m_data[m_offset] != static_cast<uint8_t>(type)) {
+      return fail(PSDecodeStatus::UnexpectedType);
+    }
+    m_offset++;
+    return true;
+  }
+
+  bool
+  readVar(size_t& var)
+  {
+    if (m_status != PSDecodeStatus::Ok) {
+      return false;
+    }
+    if (atEnd()) {
+      return fail(PSDecodeStatus::Truncated);
+    }
+    if (m_data[m_offset] < 253) {
+      var = m_data[m_offset];
+      m_offset += 1;
+      return true;
+    }
+    if (m_data[m_offset] != 253) {
+      return fail(PSDecodeStatus::BadLength);
+    }
+    if (m_size - m_offset < 3) {
+      return fail(PSDecodeStatus::Truncated);
+    }
+    var = (m_data[m_offset + 1] << 8) | m_data[m_offset + 2];
+    m_offset += 3;
+    return true;
+  }
+
+  // read a list count and check that @p count items of at least @p minItemSize bytes can fit
+  bool
+  readCount(size_t minItemSize, size_t& count)
+  {
+    if (!readVar(count)) {
+      return false;
+    }
+    if (count > (m_size - m_offset) / minItemSize) {
+      return fail(PSDecodeStatus::Truncated);
+    }
+    return true;
+  }
+
+  // read a length-prefixed body of @p expectedSize bytes, or of any size if @p expectedSize is 0
+  template <class Slice>
+  bool
+  readBody(size_t expectedSize, Slice& slice)
+  {
+    size_t size = 0;
+    if (!readVar(size)) {
+      return false;
+    }
+    if (expectedSize != 0 && size != expectedSize) {
+      return fail(PSDecodeStatus::BadLength);
+    }
+    if (size > m_size - m_offset) {
+      return fail(PSDecodeStatus::Truncated);
+    }
+    slice.offset = m_offset;
+    slice.size = size;
+    m_offset += size;
+    return true;
+  }
+
+  // an uncompressed point is twice the size of a compressed one
+  template <class Slice>
+  void
+  readPoint(PSEncodingType type, PSEncodingType uncompressedType, size_t compressedSize, Slice& slice)
+  {
+    slice.format = PSPointFormat::Compressed;
+    if (m_status == PSDecodeStatus::Ok && !atEnd() && m_data[m_offset] == static_cast<uint8_t>(uncompressedType)) {
+      type = uncompressedType;
+      slice.format = PSPointFormat::Uncompressed;
+    }
+    if (readType(type)) {
+      readBody(slice.format == PSPointFormat::Uncompressed ? compressedSize * 2 : compressedSize, slice);
+    }
+  }
+
+  template <class Slice>
+  void
+  readPointList(PSEncodingType type, PSEncodingType uncompressedType, size_t compressedSize,
+                std::vector<Slice>& slices)
+  {
+    auto format = PSPointFormat::Compressed;
+    if (m_status == PSDecodeStatus::Ok && !atEnd() && m_data[m_offset] == static_cast<uint8_t>(uncompressedType)) {
+      type = uncompressedType;
+      format = PSPointFormat::Uncompressed;
+    }
+    size_t itemSize = format == PSPointFormat::Uncompressed ? compressedSize * 2 : compressedSize;
+    size_t count = 0;
+    if (!readType(type) || !readCount(1 + itemSize, count)) {
+      return;
+    }
+    slices.resize(count);
+    for (auto& slice : slices) {
+      slice.format = format;
+      readBody(itemSize, slice);
+    }
+  }
+
+private:
+  const uint8_t* m_data;
+  size_t m_size;
+  size_t m_offset = 0;
+  PSDecodeStatus m_status = PSDecodeStatus::Ok;
+};
+
+// deserialize the element at @p slice, which the reader has already checked to be within the buffer
+template <class T, class Slice>
+static bool
+deserializeSlice(const uint8_t* data, const Slice& slice, T& item)
+{
+  return item.deserialize(data + slice.offset, slice.size, ioModeOf(slice.format)) == slice.size;
+}
+
+template <class T>
+static bool
+deserializeSlices(const uint8_t* data, const std::vector<PSSlice>& slices, std::vector<T>& items)
+{
+  items.resize(slices.size());
+  for (size_t i = 0; i < slices.size(); i++) {
+    if (!deserializeSlice(data, slices[i], items[i])) {
+      return false;
+    }
+  }
+  return true;
+}
+
+static void
+throwIfFailed(PSDecodeStatus status)
+{
+  if (status != PSDecodeStatus::Ok) {
+    throw std::runtime_error(ps_decode_status_message(status));
+  }
+}
+
 PSBuffer
 PSBuffer::fromBase64(const std::string& base64Str) {
   auto vec = base64_decode(base64Str);
@@ -162,82 +536,79 @@ PSBuffer::parseVar(size_t offset, size_t& var) const
 }
 
 void
-PSBuffer::appendG1Element(const G1& g, bool withType)
+PSBuffer::appendG1Element(const G1& g, bool withType, PSPointFormat format)
 {
-  size_t size = g.serialize(buf, sizeof(buf));
   if (withType) {
-    this->reserve(this->size() + probeVarSize(size) + size + 1);
-    this->appendType(PSEncodingType::G1);
-  }
-  else {
-    this->reserve(this->size() + probeVarSize(size) + size);
+    this->reserve(this->size() + 2 + maxG1Size());
+    this->appendType(format == PSPointFormat::Uncompressed ? PSEncodingType::G1Uncompressed : PSEncodingType::G1);
   }
-  this->appendVar(size);
-  this->insert(this->end(), buf, buf + size);
+  appendSerialized(*this, g, maxG1Size(), ioModeOf(format));
 }
 
 size_t
-PSBuffer::parseG1Element(size_t offset, G1& g, bool withType) const
+PSBuffer::parseG1Element(size_t offset, G1& g, bool withType, PSPointFormat format) const
 {
   size_t step = 0;
   if (withType) {
     PSEncodingType type;
     step += this->parseType(offset, type);
-    if (type != PSEncodingType::G1) {
+    if (type == PSEncodingType::G1) {
+      format = PSPointFormat::Compressed;
+    }
+    else if (type == PSEncodingType::G1Uncompressed) {
+      format = PSPointFormat::Uncompressed;
+    }
+    else {
       return 0;
     }
   }
   size_t size = 0;
   step += this->parseVar(offset + step, size);
-  g.deserialize(this->data() + offset + step, size);
+  g.deserialize(this->data() + offset + step, size, ioModeOf(format));
   return step + size;
 }
 
 void
-PSBuffer::appendG2Element(const G2& g, bool withType)
+PSBuffer::appendG2Element(const G2& g, bool withType, PSPointFormat format)
 {
-  size_t size = g.serialize(buf, sizeof(buf));
   if (withType) {
-    this->reserve(this->size() + probeVarSize(size) + size + 1);
-    this->appendType(PSEncodingType::G2);
-  }
-  else {
-    this->reserve(this->size() + probeVarSize(size) + size);
+    this->reserve(this->size() + 2 + maxG2Size());
+    this->appendType(format == PSPointFormat::Uncompressed ? PSEncodingType::G2Uncompressed : PSEncodingType::G2);
   }
-  this->appendVar(size);
-  this->insert(this->end(), buf, buf + size);
+  appendSerialized(*this, g, maxG2Size(), ioModeOf(format));
 }
 
 size_t
-PSBuffer::parseG2Element(size_t offset, G2& g, bool withType) const
+PSBuffer::parseG2Element(size_t offset, G2& g, bool withType, PSPointFormat format) const
 {
   size_t step = 0;
   if (withType) {
     PSEncodingType type;
     step += this->parseType(offset, type);
-    if (type != PSEncodingType::G2) {
+    if (type == PSEncodingType::G2) {
+      format = PSPointFormat::Compressed;
+    }
+    else if (type == PSEncodingType::G2Uncompressed) {
+      format = PSPointFormat::Uncompressed;
+    }
+    else {
       return 0;
     }
   }
   size_t size = 0;
   step += this->parseVar(offset + step, size);
-  g.deserialize(this->data() + offset + step, size);
+  g.deserialize(this->data() + offset + step, size, ioModeOf(format));
   return step + size;
 }
 
 void
 PSBuffer::appendFrElement(const Fr& f, bool withType)
 {
-  size_t size = f.serialize(buf, sizeof(buf));
   if (withType) {
-    this->reserve(this->size() + probeVarSize(size) + size + 1);
+    this->reserve(this->size() + 2 + Fr::getByteSize());
     this->appendType(PSEncodingType::Fr);
   }
-  else {
-    this->reserve(this->size() + probeVarSize(size) + size);
-  }
-  this->appendVar(size);
-  this->insert(this->end(), buf, buf + size);
+  appendSerialized(*this, f, Fr::getByteSize());
 }
 
 size_t
@@ -258,13 +629,13 @@ PSBuffer::parseFrElement(size_t offset, Fr& f, bool withType) const
 }
 
 void
-PSBuffer::appendG1List(const std::vector<G1>& gs)
+PSBuffer::appendG1List(const std::vector<G1>& gs, PSPointFormat format)
 {
-  this->reserve(this->size() + 1 + probeVarSize(gs.size()));
-  this->appendType(PSEncodingType::G1List);
+  this->reserve(this->size() + 1 + probeVarSize(gs.size()) + gs.size() * (1 + maxG1Size()));
+  this->appendType(format == PSPointFormat::Uncompressed ? PSEncodingType::G1ListUncompressed : PSEncodingType::G1List);
   this->appendVar(gs.size());
   for (const auto& item : gs) {
-    this->appendG1Element(item, false);
+    this->appendG1Element(item, false, format);
   }
 }
 
@@ -274,27 +645,34 @@ PSBuffer::parseG1List(size_t offset, std::vector<G1>& gs) const
   size_t step = 0;
   PSEncodingType type;
   step += this->parseType(offset, type);
-  if (type != PSEncodingType::G1List) {
+  PSPointFormat format;
+  if (type == PSEncodingType::G1List) {
+    format = PSPointFormat::Compressed;
+  }
+  else if (type == PSEncodingType::G1ListUncompressed) {
+    format = PSPointFormat::Uncompressed;
+  }
+  else {
     return 0;
   }
   size_t size = 0;
   step += this->parseVar(offset + step, size);
   G1 temp;
   for (size_t i = 0; i < size; i++) {
-    step += this->parseG1Element(offset + step, temp, false);
+    step += this->parseG1Element(offset + step, temp, false, format);
     gs.push_back(temp);
   }
   return step;
 }
 
 void
-PSBuffer::appendG2List(const std::vector<G2>& gs)
+PSBuffer::appendG2List(const std::vector<G2>& gs, PSPointFormat format)
 {
-  this->reserve(this->size() + 1 + probeVarSize(gs.size()));
-  this->appendType(PSEncodingType::G2List);
+  this->reserve(this->size() + 1 + probeVarSize(gs.size()) + gs.size() * (1 + maxG2Size()));
+  this->appendType(format == PSPointFormat::Uncompressed ? PSEncodingType::G2ListUncompressed : PSEncodingType::G2List);
   this->appendVar(gs.size());
   for (const auto& item : gs) {
-    this->appendG2Element(item, false);
+    this->appendG2Element(item, false, format);
   }
 }
 
@@ -304,14 +682,21 @@ PSBuffer::parseG2List(size_t offset, std::vector<G2>& gs) const
   size_t step = 0;
   PSEncodingType type;
   step += this->parseType(offset, type);
-  if (type != PSEncodingType::G2List) {
+  PSPointFormat format;
+  if (type == PSEncodingType::G2List) {
+    format = PSPointFormat::Compressed;
+  }
+  else if (type == PSEncodingType::G2ListUncompressed) {
+    format = PSPointFormat::Uncompressed;
+  }
+  else {
     return 0;
   }
   size_t size = 0;
   step += this->parseVar(offset + step, size);
   G2 temp;
   for (size_t i = 0; i < size; i++) {
-    step += this->parseG2Element(offset + step, temp, false);
+    step += this->parseG2Element(offset + step, temp, false, format);
     gs.push_back(temp);
   }
   return step;
@@ -320,7 +705,7 @@ PSBuffer::parseG2List(size_t offset, std::vector<G2>& gs) const
 void
 PSBuffer::appendFrList(const std::vector<Fr>& fs)
 {
-  this->reserve(this->size() + 1 + probeVarSize(fs.size()));
+  this->reserve(this->size() + 1 + probeVarSize(fs.size()) + fs.size() * (1 + Fr::getByteSize()));
   this->appendType(PSEncodingType::FrList);
   this->appendVar(fs.size());
   for (const auto& item : fs) {
@@ -381,109 +766,573 @@ PSBuffer::parseStrList(size_t offset, std::vector<std::string>& strs) const
   return step;
 }
 
-PSBuffer
-PSCredential::toBufferString()
+void
+PSBuffer::appendVersion(PSProofVersion version)
+{
+  // HexTranscript proofs are encoded without a version so that older decoders still accept them
+  if (version == PSProofVersion::HexTranscript) {
+    return;
+  }
+  this->appendType(PSEncodingType::Version);
+  this->appendVar(static_cast<size_t>(version));
+}
+
+size_t
+PSBuffer::parseVersion(size_t offset, PSProofVersion& version) const
+{
+  PSEncodingType type;
+  size_t step = this->parseType(offset, type);
+  if (type != PSEncodingType::Version) {
+    version = PSProofVersion::HexTranscript;
+    return 0;
+  }
+  size_t var = 0;
+  step += this->parseVar(offset + step, var);
+  if (var != static_cast<size_t>(PSProofVersion::BinaryTranscript)) {
+    throw std::runtime_error("unsupported proof version");
+  }
+  version = static_cast<PSProofVersion>(var);
+  return step;
+}
+
+void
+PSBuffer::appendSlotBitmap(const std::vector<bool>& slots)
+{
+  // bit i of the bitmap is bit i % 8 of byte i / 8
+  this->appendType(PSEncodingType::SlotBitmap);
+  this->appendVar(slots.size());
+  size_t offset = this->size();
+  this->resize(offset + (slots.size() + 7) / 8, 0);
+  for (size_t i = 0; i < slots.size(); i++) {
+    if (slots[i]) {
+      (*this)[offset + i / 8] |= 1 << (i % 8);
+    }
+  }
+}
+
+size_t
+PSBuffer::parseSlotBitmap(size_t offset, std::vector<bool>& slots) const
+{
+  slots.clear();
+  PSEncodingType type;
+  size_t step = this->parseType(offset, type);
+  if (type != PSEncodingType::SlotBitmap) {
+    return 0;
+  }
+  size_t bitNum = 0;
+  step += this->parseVar(offset + step, bitNum);
+  slots.resize(bitNum);
+  for (size_t i = 0; i < bitNum; i++) {
+    slots[i] = (this->at(offset + step + i / 8) >> (i % 8)) & 1;
+  }
+  return step + (bitNum + 7) / 8;
+}
+
+bool
+ps_slot_indexes(const std::vector<bool>& used_slots, size_t attribute_num, size_t key_size,
+                std::vector<size_t>& slots)
+{
+  slots.clear();
+  if (used_slots.empty()) {
+    if (attribute_num != key_size) {
+      return false;
+    }
+    slots.reserve(attribute_num);
+    for (size_t i = 0; i < attribute_num; i++) {
+      slots.push_back(i);
+    }
+    return true;
+  }
+  if (used_slots.size() != key_size) {
+    return false;
+  }
+  slots.reserve(attribute_num);
+  for (size_t i = 0; i < used_slots.size(); i++) {
+    if (used_slots[i]) {
+      slots.push_back(i);
+    }
+  }
+  return slots.size() == attribute_num;
+}
+
+// encode @p item with points in @p format
+static PSBuffer
+encode(const PSCredential& item, PSPointFormat format)
 {
   PSBuffer buffer;
-  buffer.appendG1Element(sig1);
-  buffer.appendG1Element(sig2);
+  buffer.appendG1Element(item.sig1, true, format);
+  buffer.appendG1Element(item.sig2, true, format);
   return buffer;
 }
 
+PSBuffer
+PSCredential::toBufferString()
+{
+  return encode(*this, PSPointFormat::Compressed);
+}
+
+PSBuffer
+PSCredential::toUncompressedBufferString()
+{
+  return encode(*this, PSPointFormat::Uncompressed);
+}
+
 PSCredential
 PSCredential::fromBufferString(const PSBuffer& buf)
 {
   PSCredential credential;
-  size_t step = 0;
-  step += buf.parseG1Element(step, credential.sig1);
-  step += buf.parseG1Element(step, credential.sig2);
+  throwIfFailed(tryFromBufferString(buf, credential));
   return credential;
 }
 
-PSBuffer
-PSPubKey::toBufferString()
+PSDecodeStatus
+PSCredential::tryFromBufferString(const PSBuffer& buf, PSCredential& credential)
+{
+  PSBufferReader reader(buf.data(), buf.size());
+  PSSlice sig1, sig2;
+  reader.readG1(sig1);
+  reader.readG1(sig2);
+  if (reader.finish() != PSDecodeStatus::Ok) {
+    return reader.status();
+  }
+  PSCredential result;
+  if (!deserializeSlice(buf.data(), sig1, result.sig1) || !deserializeSlice(buf.data(), sig2, result.sig2)) {
+    return PSDecodeStatus::InvalidElement;
+  }
+  credential = result;
+  return PSDecodeStatus::Ok;
+}
+
+// encode @p item with points in @p format
+static PSBuffer
+encode(const PSPubKey& item, PSPointFormat format)
 {
   PSBuffer buffer;
-  buffer.appendG1Element(g);
-  buffer.appendG2Element(gg);
-  buffer.appendG2Element(XX);
-  buffer.appendG1List(Yi);
-  buffer.appendG2List(YYi);
+  buffer.appendG1Element(item.g, true, format);
+  buffer.appendG2Element(item.gg, true, format);
+  buffer.appendG2Element(item.XX, true, format);
+  buffer.appendG1List(item.Yi, format);
+  buffer.appendG2List(item.YYi, format);
   return buffer;
 }
 
+PSBuffer
+PSPubKey::toBufferString()
+{
+  return encode(*this, PSPointFormat::Compressed);
+}
+
+PSBuffer
+PSPubKey::toUncompressedBufferString()
+{
+  return encode(*this, PSPointFormat::Uncompressed);
+}
+
 PSPubKey
 PSPubKey::fromBufferString(const PSBuffer& buf)
 {
   PSPubKey pubKey;
-  size_t step = 0;
-  step += buf.parseG1Element(step, pubKey.g);
-  step += buf.parseG2Element(step, pubKey.gg);
-  step += buf.parseG2Element(step, pubKey.XX);
-  step += buf.parseG1List(step, pubKey.Yi);
-  step += buf.parseG2List(step, pubKey.YYi);
+  throwIfFailed(tryFromBufferString(buf, pubKey));
   return pubKey;
 }
 
+PSDecodeStatus
+PSPubKey::tryFromBufferString(const PSBuffer& buf, PSPubKey& pubKey)
+{
+  PSBufferReader reader(buf.data(), buf.size());
+  PSSlice g, gg, XX;
+  std::vector<PSSlice> Yi, YYi;
+  reader.readG1(g);
+  reader.readG2(gg);
+  reader.readG2(XX);
+  reader.readG1List(Yi);
+  reader.readG2List(YYi);
+  if (reader.finish() != PSDecodeStatus::Ok) {
+    return reader.status();
+  }
+  PSPubKey result;
+  if (!deserializeSlice(buf.data(), g, result.g) || !deserializeSlice(buf.data(), gg, result.gg)
+      || !deserializeSlice(buf.data(), XX, result.XX)
+      || !deserializeSlices(buf.data(), Yi, result.Yi) || !deserializeSlices(buf.data(), YYi, result.YYi)) {
+    return PSDecodeStatus::InvalidElement;
+  }
+  pubKey = std::move(result);
+  return PSDecodeStatus::Ok;
+}
+
+bool
+PSPubKey::validate()
+{
+  if (m_validated) {
+    return true;
+  }
+  if (Yi.size() != YYi.size() || Yi.empty()) {
+    return false;
+  }
+  if (g.isZero() || !g.isValid() || !g.isValidOrder()
+      || gg.isZero() || !gg.isValid() || !gg.isValidOrder()
+      || XX.isZero() || !XX.isValid() || !XX.isValidOrder()) {
+    return false;
+  }
+  for (size_t i = 0; i < Yi.size(); i++) {
+    if (Yi[i].isZero() || !Yi[i].isValid() || !Yi[i].isValidOrder()
+        || YYi[i].isZero() || !YYi[i].isValid() || !YYi[i].isValidOrder()) {
+      return false;
+    }
+  }
+  // e(SUM{ rho_i * Yi }, gg) == e(g, SUM{ rho_i * YYi })
+  std::vector<Fr> _rhos;
+  _rhos.reserve(Yi.size());
+  for (size_t i = 0; i < Yi.size(); i++) {
+    _rhos.push_back(ps_random_small_exponent());
+  }
+  G1 _y_sum;
+  G2 _yy_sum;
+  ps_multi_mul(_y_sum, Yi, _rhos);
+  ps_multi_mul(_yy_sum, YYi, _rhos);
+  m_validated = ps_pairing_equal(_y_sum, gg, g, _yy_sum);
+  return m_validated;
+}
+
+bool
+PSPubKey::is_validated() const
+{
+  return m_validated;
+}
+
 PSBuffer
-PSCredRequest::toBufferString()
+PSSecretKey::toBufferString()
 {
   PSBuffer buffer;
-  buffer.appendG1Element(A);
-  buffer.appendFrElement(c);
-  buffer.appendFrList(rs);
-  buffer.appendStrList(attributes);
+  buffer.appendG1Element(X, true, PSPointFormat::Compressed);
+  auto pkBuffer = encode(pk, PSPointFormat::Compressed);
+  buffer.insert(buffer.end(), pkBuffer.begin(), pkBuffer.end());
   return buffer;
 }
 
+PSSecretKey
+PSSecretKey::fromBufferString(const PSBuffer& buf)
+{
+  PSSecretKey secretKey;
+  throwIfFailed(tryFromBufferString(buf, secretKey));
+  return secretKey;
+}
+
+PSDecodeStatus
+PSSecretKey::tryFromBufferString(const PSBuffer& buf, PSSecretKey& secretKey)
+{
+  PSBufferReader reader(buf.data(), buf.size());
+  PSSlice X, g, gg, XX;
+  std::vector<PSSlice> Yi, YYi;
+  reader.readG1(X);
+  reader.readG1(g);
+  reader.readG2(gg);
+  reader.readG2(XX);
+  reader.readG1List(Yi);
+  reader.readG2List(YYi);
+  if (reader.finish() != PSDecodeStatus::Ok) {
+    return reader.status();
+  }
+  PSSecretKey result;
+  if (!deserializeSlice(buf.data(), X, result.X)
+      || !deserializeSlice(buf.data(), g, result.pk.g) || !deserializeSlice(buf.data(), gg, result.pk.gg)
+      || !deserializeSlice(buf.data(), XX, result.pk.XX)
+      || !deserializeSlices(buf.data(), Yi, result.pk.Yi) || !deserializeSlices(buf.data(), YYi, result.pk.YYi)) {
+    return PSDecodeStatus::InvalidElement;
+  }
+  secretKey = std::move(result);
+  return PSDecodeStatus::Ok;
+}
+
+// encode @p item with points in @p format
+static PSBuffer
+encode(const PSCredRequest& item, PSPointFormat format)
+{
+  PSBuffer buffer;
+  buffer.appendVersion(item.version);
+  buffer.appendG1Element(item.A, true, format);
+  buffer.appendFrElement(item.c);
+  buffer.appendFrList(item.rs);
+  if (!item.used_slots.empty()) {
+    buffer.appendSlotBitmap(item.used_slots);
+  }
+  buffer.appendStrList(item.attributes);
+  return buffer;
+}
+
+PSBuffer
+PSCredRequest::toBufferString()
+{
+  return encode(*this, PSPointFormat::Compressed);
+}
+
+PSBuffer
+PSCredRequest::toUncompressedBufferString()
+{
+  return encode(*this, PSPointFormat::Uncompressed);
+}
+
 PSCredRequest
 PSCredRequest::fromBufferString(const PSBuffer& buf)
 {
   PSCredRequest request;
-  size_t step = 0;
-  step += buf.parseG1Element(step, request.A);
-  step += buf.parseFrElement(step, request.c);
-  step += buf.parseFrList(step, request.rs);
-  step += buf.parseStrList(step, request.attributes);
+  throwIfFailed(tryFromBufferString(buf, request));
   return request;
 }
 
-PSBuffer
-IdProof::toBufferString()
+PSDecodeStatus
+PSCredRequest::tryFromBufferString(const PSBuffer& buf, PSCredRequest& request)
+{
+  PSBufferReader reader(buf.data(), buf.size());
+  PSCredRequest result;
+  PSSlice A, c;
+  std::vector<PSSlice> rs;
+  std::vector<std::string_view> attributes;
+  reader.readVersion(result.version);
+  reader.readG1(A);
+  reader.readFr(c);
+  reader.readFrList(rs);
+  reader.readSlotBitmap(result.used_slots);
+  reader.readStrList(attributes);
+  if (reader.finish() != PSDecodeStatus::Ok) {
+    return reader.status();
+  }
+  if (!deserializeSlice(buf.data(), A, result.A) || !deserializeSlice(buf.data(), c, result.c)
+      || !deserializeSlices(buf.data(), rs, result.rs)) {
+    return PSDecodeStatus::InvalidElement;
+  }
+  result.attributes.assign(attributes.begin(), attributes.end());
+  request = std::move(result);
+  return PSDecodeStatus::Ok;
+}
+
+// encode @p item with points in @p format
+static PSBuffer
+encode(const IdProof& item, PSPointFormat format)
 {
   PSBuffer buffer;
-  buffer.appendG1Element(sig1);
-  buffer.appendG1Element(sig2);
-  buffer.appendG2Element(k);
-  buffer.appendG1Element(phi);
-  buffer.appendFrElement(c);
-  buffer.appendFrList(rs);
-  buffer.appendStrList(attributes);
-  if (E1.has_value() && E2.has_value()) {
-    buffer.appendG1Element(E1.value());
-    buffer.appendG1Element(E2.value());
+  buffer.appendVersion(item.version);
+  buffer.appendG1Element(item.sig1, true, format);
+  buffer.appendG1Element(item.sig2, true, format);
+  buffer.appendG2Element(item.k, true, format);
+  buffer.appendG1Element(item.phi, true, format);
+  buffer.appendFrElement(item.c);
+  buffer.appendFrList(item.rs);
+  if (!item.used_slots.empty()) {
+    buffer.appendSlotBitmap(item.used_slots);
+  }
+  buffer.appendStrList(item.attributes);
+  if (item.E1.has_value() && item.E2.has_value()) {
+    buffer.appendG1Element(item.E1.value(), true, format);
+    buffer.appendG1Element(item.E2.value(), true, format);
   }
   return buffer;
 }
 
+PSBuffer
+IdProof::toBufferString()
+{
+  return encode(*this, PSPointFormat::Compressed);
+}
+
+PSBuffer
+IdProof::toUncompressedBufferString()
+{
+  return encode(*this, PSPointFormat::Uncompressed);
+}
+
 IdProof
 IdProof::fromBufferString(const PSBuffer& buf)
 {
   IdProof proof;
-  size_t step = 0;
-  step += buf.parseG1Element(step, proof.sig1);
-  step += buf.parseG1Element(step, proof.sig2);
-  step += buf.parseG2Element(step, proof.k);
-  step += buf.parseG1Element(step, proof.phi);
-  step += buf.parseFrElement(step, proof.c);
-  step += buf.parseFrList(step, proof.rs);
-  step += buf.parseStrList(step, proof.attributes);
-  if (step < buf.size()) {
+  throwIfFailed(tryFromBufferString(buf, proof));
+  return proof;
+}
+
+// deserialize all elements of @p view into @p proof
+static bool
+decodeView(const IdProofView& view, IdProof& proof)
+{
+  proof.version = view.version();
+  if (!view.decode_sig1(proof.sig1) || !view.decode_sig2(proof.sig2) || !view.decode_k(proof.k)
+      || !view.decode_phi(proof.phi) || !view.decode_c(proof.c) || !view.decode_rs(proof.rs)) {
+    return false;
+  }
+  proof.attributes.assign(view.attributes().begin(), view.attributes().end());
+  proof.used_slots = view.used_slots();
+  if (view.has_id_retrieval()) {
     G1 e1, e2;
-    step += buf.parseG1Element(step, e1);
-    step += buf.parseG1Element(step, e2);
+    if (!view.decode_E1(e1) || !view.decode_E2(e2)) {
+      return false;
+    }
     proof.E1 = e1;
     proof.E2 = e2;
   }
+  return true;
+}
+
+PSDecodeStatus
+IdProof::tryFromBufferString(const PSBuffer& buf, IdProof& proof)
+{
+  IdProofView view;
+  auto status = IdProofView::parse(buf.data(), buf.size(), view);
+  if (status != PSDecodeStatus::Ok) {
+    return status;
+  }
+  IdProof result;
+  if (!decodeView(view, result)) {
+    return PSDecodeStatus::InvalidElement;
+  }
+  proof = std::move(result);
+  return PSDecodeStatus::Ok;
+}
+IdProofView::IdProofView(const PSBuffer& buf)
+    : IdProofView(buf.data(), buf.size())
+{
+}
+
+IdProofView::IdProofView(const uint8_t* data, size_t size)
+{
+  throwIfFailed(parse(data, size, *this));
+}
+
+PSDecodeStatus
+IdProofView::parse(const uint8_t* data, size_t size, IdProofView& view)
+{
+  PSBufferReader reader(data, size);
+  IdProofView result;
+  result.m_data = data;
+  result.m_size = size;
+  reader.readVersion(result.m_version);
+  reader.readG1(result.m_sig1);
+  reader.readG1(result.m_sig2);
+  reader.readG2(result.m_k);
+  reader.readG1(result.m_phi);
+  reader.readFr(result.m_c);
+  reader.readFrList(result.m_rs);
+  reader.readSlotBitmap(result.m_used_slots);
+  reader.readStrList(result.m_attributes);
+  if (reader.status() == PSDecodeStatus::Ok && !reader.atEnd()) {
+    reader.readG1(result.m_E1);
+    reader.readG1(result.m_E2);
+    result.m_has_id_retrieval = true;
+  }
+  if (reader.finish() != PSDecodeStatus::Ok) {
+    return reader.status();
+  }
+  view = std::move(result);
+  return PSDecodeStatus::Ok;
+}
+
+const uint8_t*
+IdProofView::data() const
+{
+  return m_data;
+}
+
+size_t
+IdProofView::size() const
+{
+  return m_size;
+}
+
+PSProofVersion
+IdProofView::version() const
+{
+  return m_version;
+}
+
+const std::vector<std::string_view>&
+IdProofView::attributes() const
+{
+  return m_attributes;
+}
+
+const std::vector<bool>&
+IdProofView::used_slots() const
+{
+  return m_used_slots;
+}
+
+bool
+IdProofView::has_id_retrieval() const
+{
+  return m_has_id_retrieval;
+}
+
+size_t
+IdProofView::rs_size() const
+{
+  return m_rs.size();
+}
+
+template <class T>
+bool
+IdProofView::decode(const Slice& slice, T& item) const
+{
+  return slice.size > 0 && deserializeSlice(m_data, slice, item);
+}
+
+bool
+IdProofView::decode_sig1(G1& sig1) const
+{
+  return decode(m_sig1, sig1);
+}
+
+bool
+IdProofView::decode_sig2(G1& sig2) const
+{
+  return decode(m_sig2, sig2);
+}
+
+bool
+IdProofView::decode_k(G2& k) const
+{
+  return decode(m_k, k);
+}
+
+bool
+IdProofView::decode_phi(G1& phi) const
+{
+  return decode(m_phi, phi);
+}
+
+bool
+IdProofView::decode_c(Fr& c) const
+{
+  return decode(m_c, c);
+}
+
+bool
+IdProofView::decode_rs(std::vector<Fr>& rs) const
+{
+  rs.resize(m_rs.size());
+  for (size_t i = 0; i < m_rs.size(); i++) {
+    if (!decode(m_rs[i], rs[i])) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool
+IdProofView::decode_E1(G1& E1) const
+{
+  return m_has_id_retrieval && decode(m_E1, E1);
+}
+
+bool
+IdProofView::decode_E2(G1& E2) const
+{
+  return m_has_id_retrieval && decode(m_E2, E2);
+}
+
+IdProof
+IdProofView::to_id_proof() const
+{
+  IdProof proof;
+  if (!decodeView(*this, proof)) {
+    throw std::runtime_error(ps_decode_status_message(PSDecodeStatus::InvalidElement));
+  }
   return proof;
-}
\ No newline at end of file
+}
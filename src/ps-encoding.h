@@ -5,6 +5,7 @@
 #include <mcl/bls12_381.hpp>
 #include <optional>
 #include <string>
+#include <string_view>
 #include <vector>
 
 using namespace mcl::bls12;
@@ -16,9 +17,74 @@ enum class PSEncodingType : uint8_t {
   G1List = 4,
   G2List = 5,
   FrList = 6,
-  StrList = 7
+  StrList = 7,
+  Version = 8,
+  G1Uncompressed = 9,      // affine x || y, decoded without a square root
+  G2Uncompressed = 10,
+  G1ListUncompressed = 11,
+  G2ListUncompressed = 12,
+  SlotBitmap = 13          // the key slots used by a sparse credential, see ps_slot_indexes()
 };
 
+/**
+ * @brief How points are written by the append functions of PSBuffer.
+ *
+ * Compressed points are half the size, but decoding one costs a square root (in Fp2 for G2).
+ * Uncompressed points skip the square root, for links where bytes are cheaper than CPU.
+ * The type of each element tells the decoder which form follows, so decoders accept both.
+ */
+enum class PSPointFormat : uint8_t {
+  Compressed = 0,
+  Uncompressed = 1
+};
+
+/**
+ * @brief How the Fiat-Shamir challenge of a NIZK proof is derived.
+ *
+ * Proofs without a version element on the wire are HexTranscript proofs.
+ */
+enum class PSProofVersion : uint8_t {
+  HexTranscript = 0,     // SHA-256 over the hex strings of the points
+  BinaryTranscript = 1,  // SHA-256 over the binary encodings of the points, see PSTranscript
+  Current = BinaryTranscript
+};
+
+/**
+ * @brief Why a buffer was rejected by a tryFromBufferString() decoder.
+ */
+enum class PSDecodeStatus : uint8_t {
+  Ok = 0,
+  Truncated = 1,           // the buffer ends in the middle of an element
+  UnexpectedType = 2,      // an element of another type than the one expected at this position
+  BadLength = 3,           // an element whose length does not match its type
+  UnsupportedVersion = 4,  // a proof version this build does not know
+  InvalidElement = 5,      // the bytes of a point or scalar do not decode to a valid one
+  TrailingBytes = 6        // bytes left after the last element
+};
+
+/**
+ * @brief A human-readable description of @p status, used as the message of decoding exceptions.
+ */
+const char*
+ps_decode_status_message(PSDecodeStatus status);
+
+/**
+ * @brief Map the attributes of a credential to the slots of a public key with @p key_size slots.
+ *
+ * A dense credential (empty @p used_slots) has one attribute per slot. A sparse credential has
+ * one attribute per set bit of @p used_slots, which has one bit per slot. Unused slots are signed
+ * as m_i = 0, so they cost no scalar multiplication anywhere.
+ *
+ * @param used_slots input Empty, or one bit per slot of the key.
+ * @param attribute_num input The number of attributes of the credential.
+ * @param key_size input The number of slots of the public key.
+ * @param slots output The slot of each attribute.
+ * @return false if @p used_slots and @p attribute_num do not match the key.
+ */
+bool
+ps_slot_indexes(const std::vector<bool>& used_slots, size_t attribute_num, size_t key_size,
+                std::vector<size_t>& slots);
+
 class PSBuffer : public std::vector<uint8_t> {
 public:  // used for base64 encoding and decoding
   static PSBuffer
@@ -40,17 +106,18 @@ public:  // used for TLV encoding and decoding
   size_t
   parseVar(size_t offset, size_t& var) const;
 
+  // with @p withType, parse functions take the point format from the element type instead of @p format
   void
-  appendG1Element(const G1& g, bool withType = true);
+  appendG1Element(const G1& g, bool withType = true, PSPointFormat format = PSPointFormat::Compressed);
 
   size_t
-  parseG1Element(size_t offset, G1& g, bool withType = true) const;
+  parseG1Element(size_t offset, G1& g, bool withType = true, PSPointFormat format = PSPointFormat::Compressed) const;
 
   void
-  appendG2Element(const G2& g, bool withType = true);
+  appendG2Element(const G2& g, bool withType = true, PSPointFormat format = PSPointFormat::Compressed);
 
   size_t
-  parseG2Element(size_t offset, G2& g, bool withType = true) const;
+  parseG2Element(size_t offset, G2& g, bool withType = true, PSPointFormat format = PSPointFormat::Compressed) const;
 
   void
   appendFrElement(const Fr& f, bool withType = true);
@@ -59,13 +126,13 @@ public:  // used for TLV encoding and decoding
   parseFrElement(size_t offset, Fr& f, bool withType = true) const;
 
   void
-  appendG1List(const std::vector<G1>& gs);
+  appendG1List(const std::vector<G1>& gs, PSPointFormat format = PSPointFormat::Compressed);
 
   size_t
   parseG1List(size_t offset, std::vector<G1>& gs) const;
 
   void
-  appendG2List(const std::vector<G2>& gs);
+  appendG2List(const std::vector<G2>& gs, PSPointFormat format = PSPointFormat::Compressed);
 
   size_t
   parseG2List(size_t offset, std::vector<G2>& gs) const;
@@ -81,6 +148,19 @@ public:  // used for TLV encoding and decoding
 
   size_t
   parseStrList(size_t offset, std::vector<std::string>& strs) const;
+
+  void
+  appendVersion(PSProofVersion version);
+
+  size_t
+  parseVersion(size_t offset, PSProofVersion& version) const;
+
+  // the bitmap is optional: parse returns 0 and an empty @p slots if the element is absent
+  void
+  appendSlotBitmap(const std::vector<bool>& slots);
+
+  size_t
+  parseSlotBitmap(size_t offset, std::vector<bool>& slots) const;
 };
 
 /**
@@ -101,8 +181,28 @@ public:
   PSBuffer
   toBufferString();
 
+  /**
+   * @brief Encode with uncompressed points, see PSPointFormat. Decoded by fromBufferString() as well.
+   */
+  PSBuffer
+  toUncompressedBufferString();
+
+  /**
+   * @brief Decode @p buf. Throws std::runtime_error if @p buf is malformed.
+   */
   static PSCredential
   fromBufferString(const PSBuffer& buf);
+
+  /**
+   * @brief Decode @p buf without throwing.
+   *
+   * The layout and the length of every element are checked before any element is deserialized.
+   *
+   * @return PSDecodeStatus::Ok with the result in @p credential, or the reason @p buf was rejected,
+   *         in which case @p credential is left untouched.
+   */
+  static PSDecodeStatus
+  tryFromBufferString(const PSBuffer& buf, PSCredential& credential);
 };
 
 /**
@@ -135,8 +235,89 @@ public:
   PSBuffer
   toBufferString();
 
+  /**
+   * @brief Encode with uncompressed points, see PSPointFormat. Decoded by fromBufferString() as well.
+   */
+  PSBuffer
+  toUncompressedBufferString();
+
+  /**
+   * @brief Decode @p buf. Throws std::runtime_error if @p buf is malformed.
+   */
   static PSPubKey
   fromBufferString(const PSBuffer& buf);
+
+  /**
+   * @brief Decode @p buf without throwing.
+   *
+   * The layout and the length of every element are checked before any element is deserialized.
+   *
+   * @return PSDecodeStatus::Ok with the result in @p pubKey, or the reason @p buf was rejected,
+   *         in which case @p pubKey is left untouched.
+   */
+  static PSDecodeStatus
+  tryFromBufferString(const PSBuffer& buf, PSPubKey& pubKey);
+
+  /**
+   * @brief Check that the key is well formed.
+   *
+   * Checks that all points are non-zero and in the prime-order subgroups, and that Yi[i] and YYi[i]
+   * share the same exponent for every i. The latter is checked for all i at once with
+   * e(SUM{ rho_i * Yi }, gg) == e(g, SUM{ rho_i * YYi }) for random small rho_i, which costs two
+   * pairings whatever the number of attributes.
+   *
+   * The result is cached: once a key passes, later calls (also on copies of the key) return true
+   * right away. Do not modify the points of a validated key.
+   *
+   * @return true if the key is valid.
+   */
+  bool
+  validate();
+
+  /**
+   * @brief Whether validate() has succeeded on this key or the key it was copied from.
+   */
+  bool
+  is_validated() const;
+
+private:
+  bool m_validated = false;
+};
+
+/**
+ * @brief Private key of a PSSigner together with its public key, see PSSigner::get_secret_key().
+ *
+ * Whoever holds the encoding can issue credentials, so store it as a secret.
+ */
+class PSSecretKey {
+public:
+  /**
+   * @brief g^x, a point in G1.
+   */
+  G1 X;
+  /**
+   * @brief The public key matching X.
+   */
+  PSPubKey pk;
+
+public:
+  PSBuffer
+  toBufferString();
+
+  /**
+   * @brief Decode @p buf. Throws std::runtime_error if @p buf is malformed.
+   */
+  static PSSecretKey
+  fromBufferString(const PSBuffer& buf);
+
+  /**
+   * @brief Decode @p buf without throwing.
+   *
+   * @return PSDecodeStatus::Ok with the result in @p secretKey, or the reason @p buf was rejected,
+   *         in which case @p secretKey is left untouched.
+   */
+  static PSDecodeStatus
+  tryFromBufferString(const PSBuffer& buf, PSSecretKey& secretKey);
 };
 
 /**
@@ -160,13 +341,41 @@ public:
    * @brief A list of plaintext attributes. Empty strings are placeholders for committed attributes.
    */
   std::vector<std::string> attributes;
+  /**
+   * @brief The proof format, which decides how c is derived.
+   */
+  PSProofVersion version = PSProofVersion::Current;
+  /**
+   * @brief The key slots used by a sparse credential, one bit per slot. Empty if every slot is used.
+   */
+  std::vector<bool> used_slots;
 
 public:
   PSBuffer
   toBufferString();
 
+  /**
+   * @brief Encode with uncompressed points, see PSPointFormat. Decoded by fromBufferString() as well.
+   */
+  PSBuffer
+  toUncompressedBufferString();
+
+  /**
+   * @brief Decode @p buf. Throws std::runtime_error if @p buf is malformed.
+   */
   static PSCredRequest
   fromBufferString(const PSBuffer& buf);
+
+  /**
+   * @brief Decode @p buf without throwing.
+   *
+   * The layout and the length of every element are checked before any element is deserialized.
+   *
+   * @return PSDecodeStatus::Ok with the result in @p request, or the reason @p buf was rejected,
+   *         in which case @p request is left untouched.
+   */
+  static PSDecodeStatus
+  tryFromBufferString(const PSBuffer& buf, PSCredRequest& request);
 };
 
 /**
@@ -210,13 +419,172 @@ public:
    * @brief El Gamal ciphertext as the identity retrieval token, first part.
    */
   std::optional<G1> E2;
+  /**
+   * @brief The proof format, which decides how c is derived.
+   */
+  PSProofVersion version = PSProofVersion::Current;
+  /**
+   * @brief The key slots used by a sparse credential, one bit per slot. Empty if every slot is used.
+   */
+  std::vector<bool> used_slots;
 
 public:
   PSBuffer
   toBufferString();
 
+  /**
+   * @brief Encode with uncompressed points, see PSPointFormat. Decoded by fromBufferString() as well.
+   */
+  PSBuffer
+  toUncompressedBufferString();
+
+  /**
+   * @brief Decode @p buf. Throws std::runtime_error if @p buf is malformed.
+   */
   static IdProof
   fromBufferString(const PSBuffer& buf);
+
+  /**
+   * @brief Decode @p buf without throwing.
+   *
+   * The layout and the length of every element are checked before any element is deserialized.
+   *
+   * @return PSDecodeStatus::Ok with the result in @p proof, or the reason @p buf was rejected,
+   *         in which case @p proof is left untouched.
+   */
+  static PSDecodeStatus
+  tryFromBufferString(const PSBuffer& buf, IdProof& proof);
+};
+
+/**
+ * @brief A read-only view of an encoded IdProof that is parsed in place.
+ *
+ * The constructor only walks the buffer and records where each element starts. Attributes are
+ * exposed as std::string_view into the buffer, and points and scalars are deserialized only when
+ * one of the decode_*() functions is called, so a proof that is rejected early never pays for
+ * the rest of its elements.
+ *
+ * The buffer must outlive the view and must not be modified while the view is in use.
+ */
+class IdProofView {
+public:
+  /**
+   * @brief An empty view, to be filled by parse().
+   */
+  IdProofView() = default;
+
+  /**
+   * @brief Parse @p buf in place. Throws std::runtime_error if the layout is malformed.
+   */
+  explicit IdProofView(const PSBuffer& buf);
+
+  /**
+   * @brief Parse @p size bytes at @p data in place. Throws std::runtime_error if the layout is malformed.
+   */
+  IdProofView(const uint8_t* data, size_t size);
+
+  /**
+   * @brief Parse @p size bytes at @p data in place without throwing.
+   *
+   * Only the layout is checked, so rejecting a malformed buffer costs no curve operation.
+   *
+   * @return PSDecodeStatus::Ok with the view in @p view, or the reason the buffer was rejected.
+   */
+  static PSDecodeStatus
+  parse(const uint8_t* data, size_t size, IdProofView& view);
+
+  /**
+   * @brief The encoded proof the view points to.
+   */
+  const uint8_t*
+  data() const;
+
+  size_t
+  size() const;
+
+  PSProofVersion
+  version() const;
+
+  /**
+   * @brief Plaintext attributes, with empty views as placeholders for committed attributes.
+   */
+  const std::vector<std::string_view>&
+  attributes() const;
+
+  /**
+   * @brief The key slots used by a sparse credential, empty if every slot is used.
+   */
+  const std::vector<bool>&
+  used_slots() const;
+
+  /**
+   * @brief Whether the proof carries the identity retrieval token E1, E2.
+   */
+  bool
+  has_id_retrieval() const;
+
+  size_t
+  rs_size() const;
+
+  /**
+   * @brief Deserialize an element. Return false if the element is not a valid encoding.
+   */
+  bool
+  decode_sig1(G1& sig1) const;
+
+  bool
+  decode_sig2(G1& sig2) const;
+
+  bool
+  decode_k(G2& k) const;
+
+  bool
+  decode_phi(G1& phi) const;
+
+  bool
+  decode_c(Fr& c) const;
+
+  bool
+  decode_rs(std::vector<Fr>& rs) const;
+
+  bool
+  decode_E1(G1& E1) const;
+
+  bool
+  decode_E2(G1& E2) const;
+
+  /**
+   * @brief Decode everything into an owning IdProof.
+   */
+  IdProof
+  to_id_proof() const;
+
+private:
+  struct Slice {
+    size_t offset = 0;
+    size_t size = 0;
+    PSPointFormat format = PSPointFormat::Compressed;
+  };
+
+  template <class T>
+  bool
+  decode(const Slice& slice, T& item) const;
+
+private:
+  const uint8_t* m_data = nullptr;
+  size_t m_size = 0;
+  PSProofVersion m_version = PSProofVersion::HexTranscript;
+  Slice m_sig1;
+  Slice m_sig2;
+  Slice m_k;
+  Slice m_phi;
+  Slice m_c;
+  std::vector<Slice> m_rs;
+  std::vector<std::string_view> m_attributes;
+  std::vector<bool> m_used_slots;
+  bool m_has_id_retrieval = false;
+  Slice m_E1;
+  Slice m_E2;
 };
 
 #endif  // PS_SRC_ENCODING_H_
\ No newline at end of file
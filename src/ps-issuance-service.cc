@@ -0,0 +1,168 @@
+#include "ps-issuance-service.h"
+
+#include <algorithm>
+#include <memory>
+#include <stdexcept>
+
+using namespace mcl::bls12;
+
+PSIssuanceService::PSIssuanceService(const PSSigner& signer, size_t thread_num, size_t queue_capacity,
+                                     size_t max_batch, std::chrono::microseconds window)
+    : m_signer(signer)
+    , m_thread_num(thread_num)
+    , m_capacity(std::max<size_t>(queue_capacity, 1))
+    , m_max_batch(std::max<size_t>(max_batch, 1))
+    , m_window(window)
+    , m_dispatcher(&PSIssuanceService::dispatch, this)
+{
+}
+
+PSIssuanceService::~PSIssuanceService()
+{
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stopped = true;
+  }
+  m_work_cv.notify_all();
+  m_space_cv.notify_all();
+  m_dispatcher.join();
+}
+
+std::future<std::optional<PSCredential>>
+PSIssuanceService::submit(PSCredRequest request, std::string associated_data)
+{
+  auto promise = std::make_shared<std::promise<std::optional<PSCredential>>>();
+  auto result = promise->get_future();
+  submit(std::move(request), std::move(associated_data),
+         [promise](const std::optional<PSCredential>& sig) { promise->set_value(sig); });
+  return result;
+}
+
+void
+PSIssuanceService::submit(PSCredRequest request, std::string associated_data, Callback done)
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  m_space_cv.wait(lock, [this] { return m_stopped || m_in_flight < m_capacity; });
+  enqueue(lock, std::move(request), std::move(associated_data), std::move(done));
+}
+
+bool
+PSIssuanceService::try_submit(PSCredRequest request, std::string associated_data, Callback done)
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  if (!m_stopped && m_in_flight >= m_capacity) {
+    return false;
+  }
+  enqueue(lock, std::move(request), std::move(associated_data), std::move(done));
+  return true;
+}
+
+PSIssuanceStats
+PSIssuanceService::stats() const
+{
+  PSIssuanceStats _stats;
+  std::vector<double> _latencies;
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    _stats.queue_depth = m_queue.size();
+    _stats.in_flight = m_in_flight;
+    _stats.issued = m_issued;
+    _stats.rejected = m_rejected;
+    _stats.batches = m_batches;
+    _latencies = m_latencies;
+  }
+  if (_stats.batches > 0) {
+    _stats.mean_batch_size = double(_stats.issued + _stats.rejected) / _stats.batches;
+  }
+  if (!_latencies.empty()) {
+    // nearest-rank percentiles
+    std::sort(_latencies.begin(), _latencies.end());
+    auto percentile = [&](double p) {
+      size_t rank = static_cast<size_t>(p * _latencies.size() + 0.999999);
+      return _latencies[std::min(std::max<size_t>(rank, 1), _latencies.size()) - 1];
+    };
+    _stats.p50_latency_us = percentile(0.50);
+    _stats.p99_latency_us = percentile(0.99);
+  }
+  return _stats;
+}
+
+void
+PSIssuanceService::enqueue(std::unique_lock<std::mutex>& lock, PSCredRequest&& request,
+                           std::string&& associated_data, Callback&& done)
+{
+  if (m_stopped) {
+    throw std::runtime_error("issuance service stopped");
+  }
+  m_queue.push_back(Job{std::move(request), std::move(associated_data), std::move(done),
+                        std::chrono::steady_clock::now()});
+  m_in_flight++;
+  lock.unlock();
+  m_work_cv.notify_one();
+}
+
+void
+PSIssuanceService::dispatch()
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  while (true) {
+    m_work_cv.wait(lock, [this] { return m_stopped || !m_queue.empty(); });
+    if (m_queue.empty()) {
+      return;  // stopped and drained
+    }
+    // coalesce until the batch is full or the first request has waited a window
+    auto _deadline = m_queue.front().submitted + m_window;
+    m_work_cv.wait_until(lock, _deadline, [this] { return m_stopped || m_queue.size() >= m_max_batch; });
+    size_t _size = std::min(m_queue.size(), m_max_batch);
+    std::vector<Job> _jobs;
+    _jobs.reserve(_size);
+    for (size_t i = 0; i < _size; i++) {
+      _jobs.push_back(std::move(m_queue.front()));
+      m_queue.pop_front();
+    }
+    lock.unlock();
+    sign_batch(_jobs);
+    lock.lock();
+    m_in_flight -= _size;
+    m_space_cv.notify_all();
+  }
+}
+
+void
+PSIssuanceService::sign_batch(std::vector<Job>& jobs)
+{
+  std::vector<PSCredRequest> _requests;
+  std::vector<std::string> _associated_data;
+  _requests.reserve(jobs.size());
+  _associated_data.reserve(jobs.size());
+  for (auto& job : jobs) {
+    _requests.push_back(std::move(job.request));
+    _associated_data.push_back(std::move(job.associated_data));
+  }
+  std::vector<PSCredential> _sigs;
+  auto _accepted = m_signer.provide_id_batch(_requests, _associated_data, _sigs, m_thread_num);
+
+  auto _now = std::chrono::steady_clock::now();
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    size_t _issued = std::count(_accepted.begin(), _accepted.end(), true);
+    m_issued += _issued;
+    m_rejected += jobs.size() - _issued;
+    m_batches++;
+    for (const auto& job : jobs) {
+      double _latency = std::chrono::duration<double, std::micro>(_now - job.submitted).count();
+      if (m_latencies.size() < LATENCY_SAMPLES) {
+        m_latencies.push_back(_latency);
+      }
+      else {
+        m_latencies[m_next_latency] = _latency;
+        m_next_latency = (m_next_latency + 1) % LATENCY_SAMPLES;
+      }
+    }
+  }
+  for (size_t i = 0; i < jobs.size(); i++) {
+    if (jobs[i].done) {
+      jobs[i].done(_accepted[i] ? std::optional<PSCredential>(_sigs[i]) : std::nullopt);
+    }
+  }
+}
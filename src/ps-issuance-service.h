@@ -0,0 +1,139 @@
+#ifndef PS_SRC_PS_ISSUANCE_SERVICE_H_
+#define PS_SRC_PS_ISSUANCE_SERVICE_H_
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+
+#include "ps-signer.h"
+
+using namespace mcl::bls12;
+
+/**
+ * @brief Counters and latencies of a PSIssuanceService, see PSIssuanceService::stats().
+ */
+struct PSIssuanceStats {
+  size_t queue_depth = 0;        // requests waiting for a batch
+  size_t in_flight = 0;          // requests submitted and not answered yet
+  uint64_t issued = 0;           // requests accepted and signed
+  uint64_t rejected = 0;         // requests whose NIZK proof failed
+  uint64_t batches = 0;          // batches signed
+  double mean_batch_size = 0;    // requests per batch
+  double p50_latency_us = 0;     // from submission to answer, over the recent requests
+  double p99_latency_us = 0;
+};
+
+/**
+ * @brief An issuer of credentials that coalesces requests into batches of PSSigner::provide_id_batch().
+ *
+ * A batch starts with the first request waiting and closes once it holds a batch size of
+ * requests or a coalescing window has passed, whichever comes first. Requests arriving while a
+ * batch is signed wait for the next one, so the batches grow with the load while a lone request
+ * waits at most one window. Each batch is verified and signed on a pool of worker threads, and
+ * its plaintext attributes shared by several requests are hashed and multiplied once.
+ */
+class PSIssuanceService {
+public:
+  /**
+   * @brief Called once on a worker thread, with the credential if the request is accepted. Must not throw.
+   */
+  using Callback = std::function<void(const std::optional<PSCredential>& sig)>;
+
+  /**
+   * @brief Start a service.
+   *
+   * @param signer input The signer, must outlive the service.
+   * @param thread_num input The number of workers signing a batch, 0 for std::thread::hardware_concurrency().
+   * @param queue_capacity input The maximum number of requests in flight.
+   * @param max_batch input The maximum number of requests in one batch.
+   * @param window input How long the first request of a batch waits for others.
+   */
+  PSIssuanceService(const PSSigner& signer, size_t thread_num = 0, size_t queue_capacity = 1024,
+                    size_t max_batch = 64, std::chrono::microseconds window = std::chrono::microseconds(2000));
+
+  PSIssuanceService(const PSIssuanceService&) = delete;
+  PSIssuanceService&
+  operator=(const PSIssuanceService&) = delete;
+
+  /**
+   * @brief Sign the requests already submitted, then stop.
+   */
+  ~PSIssuanceService();
+
+  /**
+   * @brief Submit a request, waiting while the service is full.
+   *
+   * @param request input The ID request generated by a PSRequester.
+   * @param associated_data input The associated data of the request.
+   * @return std::future The credential, or nothing if the request is rejected.
+   */
+  std::future<std::optional<PSCredential>>
+  submit(PSCredRequest request, std::string associated_data);
+
+  /**
+   * @brief Submit a request, waiting while the service is full.
+   *
+   * @param done input Called with the result once the request is handled.
+   */
+  void
+  submit(PSCredRequest request, std::string associated_data, Callback done);
+
+  /**
+   * @brief Submit a request unless the service is full.
+   *
+   * @return bool False if the service is full, in which case @p done is never called.
+   */
+  bool
+  try_submit(PSCredRequest request, std::string associated_data, Callback done);
+
+  PSIssuanceStats
+  stats() const;
+
+private:
+  struct Job {
+    PSCredRequest request;
+    std::string associated_data;
+    Callback done;
+    std::chrono::steady_clock::time_point submitted;
+  };
+
+  static constexpr size_t LATENCY_SAMPLES = 1024;  // latencies kept for stats()
+
+  void
+  enqueue(std::unique_lock<std::mutex>& lock, PSCredRequest&& request, std::string&& associated_data,
+          Callback&& done);
+
+  void
+  dispatch();
+
+  void
+  sign_batch(std::vector<Job>& jobs);
+
+private:
+  const PSSigner& m_signer;
+  size_t m_thread_num;
+  size_t m_capacity;
+  size_t m_max_batch;
+  std::chrono::microseconds m_window;
+
+  mutable std::mutex m_mutex;
+  std::condition_variable m_work_cv;   // signaled when a request is queued or the service stops
+  std::condition_variable m_space_cv;  // signaled when a batch is answered
+  std::deque<Job> m_queue;
+  size_t m_in_flight = 0;
+  bool m_stopped = false;
+  uint64_t m_issued = 0;
+  uint64_t m_rejected = 0;
+  uint64_t m_batches = 0;
+  std::vector<double> m_latencies;     // ring buffer of the latest latencies, in microseconds
+  size_t m_next_latency = 0;
+  std::thread m_dispatcher;            // started last, after all the members above
+};
+
+#endif  // PS_SRC_PS_ISSUANCE_SERVICE_H_
@@ -0,0 +1,97 @@
+#include "ps-issuance-socket.h"
+
+#include <cctype>
+#include <sstream>
+
+namespace {
+
+std::string
+stats_text(const PSIssuanceStats& stats)
+{
+  std::ostringstream _text;
+  _text << "queue_depth=" << stats.queue_depth << "\n"
+        << "in_flight=" << stats.in_flight << "\n"
+        << "issued=" << stats.issued << "\n"
+        << "rejected=" << stats.rejected << "\n"
+        << "batches=" << stats.batches << "\n"
+        << "mean_batch_size=" << stats.mean_batch_size << "\n"
+        << "p50_latency_us=" << stats.p50_latency_us << "\n"
+        << "p99_latency_us=" << stats.p99_latency_us << "\n";
+  return _text.str();
+}
+
+// an encoded message starts with a type byte, never with a character of the base64 alphabet
+bool
+is_base64(const PSBuffer& payload)
+{
+  return std::isalnum(payload[0]) || payload[0] == '+' || payload[0] == '/';
+}
+
+}  // namespace
+
+PSIssuanceSocketServer::PSIssuanceSocketServer(PSIssuanceService& service, const std::string& path)
+    : m_server(path, [&service](PSBuffer payload, std::string associated_data, PSSocketServer::Respond respond) {
+      if (payload.empty()) {
+        auto _text = stats_text(service.stats());
+        PSBuffer _response;
+        _response.insert(_response.end(), _text.begin(), _text.end());
+        respond(_response);
+        return;
+      }
+      bool _base64 = is_base64(payload);
+      if (_base64) {
+        payload = PSBuffer::fromBase64(std::string(payload.begin(), payload.end()));
+      }
+      PSCredRequest _request;
+      if (PSCredRequest::tryFromBufferString(payload, _request) != PSDecodeStatus::Ok) {
+        respond(PSBuffer());
+        return;
+      }
+      // waits while the service is full, so a fast client is slowed down to the pace of the signer
+      service.submit(std::move(_request), std::move(associated_data),
+                     [respond, _base64](const std::optional<PSCredential>& sig) {
+                       if (!sig) {
+                         respond(PSBuffer());
+                         return;
+                       }
+                       auto _response = PSCredential(*sig).toBufferString();
+                       if (_base64) {
+                         auto _text = _response.toBase64();
+                         _response.assign(_text.begin(), _text.end());
+                       }
+                       respond(_response);
+                     });
+    })
+{
+}
+
+PSIssuanceSocketClient::PSIssuanceSocketClient(const std::string& path)
+    : m_client(path)
+{
+}
+
+bool
+PSIssuanceSocketClient::request_id(PSCredRequest request, const std::string& associated_data, PSCredential& sig)
+{
+  auto _response = m_client.request(request.toBufferString(), associated_data);
+  return !_response.empty() && PSCredential::tryFromBufferString(_response, sig) == PSDecodeStatus::Ok;
+}
+
+std::string
+PSIssuanceSocketClient::request_id(const std::string& request, const std::string& associated_data)
+{
+  if (request.empty()) {
+    return "";  // an empty payload asks for the stats
+  }
+  PSBuffer _payload;
+  _payload.insert(_payload.end(), request.begin(), request.end());
+  auto _response = m_client.request(_payload, associated_data);
+  return std::string(_response.begin(), _response.end());
+}
+
+std::string
+PSIssuanceSocketClient::stats()
+{
+  auto _response = m_client.request(PSBuffer(), "");
+  return std::string(_response.begin(), _response.end());
+}
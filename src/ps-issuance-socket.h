@@ -0,0 +1,70 @@
+#ifndef PS_SRC_PS_ISSUANCE_SOCKET_H_
+#define PS_SRC_PS_ISSUANCE_SOCKET_H_
+
+#include "ps-issuance-service.h"
+#include "ps-socket.h"
+
+/**
+ * @brief A Unix domain socket front end of a PSIssuanceService.
+ *
+ * Requests and responses are framed as described in PSSocketServer.
+ *  - request payload: the output of PSCredRequest::toBufferString(), either binary or in base64
+ *    as taken by el_passo_prove_id() of the IdP wasm module, with the associated data of the request.
+ *  - response payload: the output of PSCredential::toBufferString() in the form of the request,
+ *    empty if the request is rejected or cannot be decoded.
+ *
+ * A request with an empty payload is answered with the PSIssuanceStats of the service, as text
+ * lines of "name=value".
+ */
+class PSIssuanceSocketServer {
+public:
+  /**
+   * @brief Listen on @p path and start accepting connections.
+   *
+   * @param service input The service signing the requests, must outlive the server.
+   * @param path input The same as PSSocketServer::PSSocketServer().
+   */
+  PSIssuanceSocketServer(PSIssuanceService& service, const std::string& path);
+
+private:
+  PSSocketServer m_server;
+};
+
+/**
+ * @brief A blocking client of a PSIssuanceSocketServer, one request at a time.
+ */
+class PSIssuanceSocketClient {
+public:
+  /**
+   * @brief Connect to the server at @p path. Throws std::runtime_error on failure.
+   */
+  explicit PSIssuanceSocketClient(const std::string& path);
+
+  /**
+   * @brief Send an ID request and wait for the credential.
+   *
+   * @param request input The ID request generated by a PSRequester.
+   * @param associated_data input The associated data of the request.
+   * @param sig output The PS signature, set if the request is accepted.
+   * @return bool True if the request is accepted. Throws std::runtime_error if the connection fails.
+   */
+  bool
+  request_id(PSCredRequest request, const std::string& associated_data, PSCredential& sig);
+
+  /**
+   * @brief Send a base64 ID request and wait for the base64 credential, empty if rejected.
+   */
+  std::string
+  request_id(const std::string& request, const std::string& associated_data);
+
+  /**
+   * @brief The PSIssuanceStats of the service, as text lines of "name=value".
+   */
+  std::string
+  stats();
+
+private:
+  PSSocketClient m_client;
+};
+
+#endif  // PS_SRC_PS_ISSUANCE_SOCKET_H_
@@ -0,0 +1,127 @@
+#include "ps-msm.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <stdexcept>
+
+using namespace mcl::bls12;
+
+static const size_t MAX_WINDOW_BITS = 12;
+
+size_t
+ps_scalar_bytes(const Fr& f, uint8_t* bytes)
+{
+  // Fr is serialized as a little-endian byte array
+  return f.serialize(bytes, 64);
+}
+
+uint32_t
+ps_scalar_digit(const uint8_t* bytes, size_t byte_size, size_t bit_offset, size_t bits)
+{
+  uint32_t digit = 0;
+  for (size_t b = 0; b < bits; b++) {
+    size_t pos = bit_offset + b;
+    if (pos / 8 >= byte_size) {
+      break;
+    }
+    digit |= static_cast<uint32_t>((bytes[pos / 8] >> (pos % 8)) & 1) << b;
+  }
+  return digit;
+}
+
+template <class G>
+void
+ps_bucket_sum(G& z, const std::vector<const G*>& points, const std::vector<uint32_t>& digits,
+              size_t window_bits)
+{
+  z.clear();
+  if (points.empty()) {
+    return;
+  }
+  // bucket d collects every point whose digit is d + 1
+  size_t _bucket_num = (size_t(1) << window_bits) - 1;
+  std::vector<G> _buckets(_bucket_num);
+  std::vector<bool> _used(_bucket_num, false);
+  size_t _top = 0;
+  for (size_t i = 0; i < points.size(); i++) {
+    size_t d = digits[i] - 1;
+    if (_used[d]) {
+      G::add(_buckets[d], _buckets[d], *points[i]);
+    }
+    else {
+      _buckets[d] = *points[i];
+      _used[d] = true;
+    }
+    _top = std::max(_top, d + 1);
+  }
+  // SUM{ d * bucket_d } = SUM{ running sum of buckets from the top }
+  G _running;
+  _running.clear();
+  for (size_t d = _top; d > 0; d--) {
+    if (_used[d - 1]) {
+      G::add(_running, _running, _buckets[d - 1]);
+    }
+    G::add(z, z, _running);
+  }
+}
+
+template <class G>
+void
+ps_multi_mul(G& z, const std::vector<G>& bases, const std::vector<Fr>& scalars)
+{
+  if (bases.size() != scalars.size()) {
+    throw std::runtime_error("base size does not match scalar size");
+  }
+  z.clear();
+  if (bases.empty()) {
+    return;
+  }
+  if (bases.size() == 1) {
+    G::mul(z, bases[0], scalars[0]);
+    return;
+  }
+  size_t _n = bases.size();
+  size_t _bit_size = Fr::getBitSize();
+  // window c minimizing (bit_size / c) * (n + 2^(c+1)) additions
+  size_t _c = 1;
+  size_t _best_cost = SIZE_MAX;
+  for (size_t c = 1; c <= MAX_WINDOW_BITS; c++) {
+    size_t cost = (_bit_size + c - 1) / c * (_n + (size_t(1) << (c + 1)));
+    if (cost < _best_cost) {
+      _best_cost = cost;
+      _c = c;
+    }
+  }
+  std::vector<uint8_t> _bytes(_n * 64);
+  std::vector<size_t> _byte_sizes(_n);
+  for (size_t i = 0; i < _n; i++) {
+    _byte_sizes[i] = ps_scalar_bytes(scalars[i], _bytes.data() + i * 64);
+  }
+  size_t _window_num = (_bit_size + _c - 1) / _c;
+  std::vector<const G*> _points;
+  std::vector<uint32_t> _digits;
+  _points.reserve(_n);
+  _digits.reserve(_n);
+  G _window_sum;
+  for (size_t w = _window_num; w > 0; w--) {
+    for (size_t j = 0; j < _c; j++) {
+      G::dbl(z, z);
+    }
+    _points.clear();
+    _digits.clear();
+    for (size_t i = 0; i < _n; i++) {
+      uint32_t digit = ps_scalar_digit(_bytes.data() + i * 64, _byte_sizes[i], (w - 1) * _c, _c);
+      if (digit != 0) {
+        _points.push_back(&bases[i]);
+        _digits.push_back(digit);
+      }
+    }
+    ps_bucket_sum(_window_sum, _points, _digits, _c);
+    G::add(z, z, _window_sum);
+  }
+}
+
+template void ps_bucket_sum<G1>(G1&, const std::vector<const G1*>&, const std::vector<uint32_t>&, size_t);
+template void ps_bucket_sum<G2>(G2&, const std::vector<const G2*>&, const std::vector<uint32_t>&, size_t);
+template void ps_multi_mul<G1>(G1&, const std::vector<G1>&, const std::vector<Fr>&);
+template void ps_multi_mul<G2>(G2&, const std::vector<G2>&, const std::vector<Fr>&);
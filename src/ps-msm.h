@@ -0,0 +1,52 @@
+#ifndef PS_SRC_PS_MSM_H_
+#define PS_SRC_PS_MSM_H_
+
+#include <mcl/bls12_381.hpp>
+#include <vector>
+
+using namespace mcl::bls12;
+
+/**
+ * @brief Serialize @p f into a little-endian byte array for digit extraction.
+ *
+ * @param f input The scalar.
+ * @param bytes output The buffer, at least 64 bytes.
+ * @return size_t The number of bytes written.
+ */
+size_t
+ps_scalar_bytes(const Fr& f, uint8_t* bytes);
+
+/**
+ * @brief Read @p bits bits starting from @p bit_offset out of a little-endian byte array.
+ */
+uint32_t
+ps_scalar_digit(const uint8_t* bytes, size_t byte_size, size_t bit_offset, size_t bits);
+
+/**
+ * @brief z = SUM{ digits[i] * points[i] } with the bucket method.
+ *
+ * @param z output The sum.
+ * @param points input The points. Zero digits should be skipped by the caller.
+ * @param digits input The digits, each in [1, 2^window_bits - 1].
+ * @param window_bits input The digit size in bits.
+ *
+ * Instantiated for G1 and G2.
+ */
+template <class G>
+void
+ps_bucket_sum(G& z, const std::vector<const G*>& points, const std::vector<uint32_t>& digits,
+              size_t window_bits);
+
+/**
+ * @brief Multi-scalar multiplication z = SUM{ bases[i]^scalars[i] } with Pippenger's bucket method.
+ *
+ * The window size is selected from the number of bases, so the cost per base shrinks as
+ * the number of bases grows.
+ *
+ * Instantiated for G1 and G2.
+ */
+template <class G>
+void
+ps_multi_mul(G& z, const std::vector<G>& bases, const std::vector<Fr>& scalars);
+
+#endif  // PS_SRC_PS_MSM_H_
@@ -0,0 +1,102 @@
+#include "ps-pairing.h"
+
+#include <cstdint>
+
+using namespace mcl::bls12;
+
+PSPrecomputedG2::PSPrecomputedG2(const G2& q)
+    : m_q(q)
+{
+  precomputeG2(m_coefficients, m_q);
+}
+
+const G2&
+PSPrecomputedG2::point() const
+{
+  return m_q;
+}
+
+const std::vector<Fp6>&
+PSPrecomputedG2::coefficients() const
+{
+  return m_coefficients;
+}
+
+bool
+ps_pairing_equal(const G1& a1, const G2& b1, const G1& a2, const G2& b2)
+{
+  // e(a1, b1) == e(a2, b2) <=> e(a1, b1) * e(-a2, b2) == 1
+  G1 _ps[2];
+  G2 _qs[2];
+  _ps[0] = a1;
+  G1::neg(_ps[1], a2);
+  _qs[0] = b1;
+  _qs[1] = b2;
+  GT _f;
+  millerLoopVec(_f, _ps, _qs, 2);
+  finalExp(_f, _f);
+  return _f.isOne();
+}
+
+bool
+ps_pairing_product_is_one(const std::vector<G1>& ps, const std::vector<G2>& qs)
+{
+  if (ps.size() != qs.size()) {
+    return false;
+  }
+  if (ps.empty()) {
+    return true;
+  }
+  GT _f;
+  millerLoopVec(_f, ps.data(), qs.data(), ps.size());
+  finalExp(_f, _f);
+  return _f.isOne();
+}
+
+bool
+ps_pairing_equal(const G1& a1, const G2& b1, const G1& a2, const PSPrecomputedG2& b2)
+{
+  // e(a1, b1) * e(-a2, b2) == 1, the lines of b2 are precomputed
+  G1 _neg_a2;
+  G1::neg(_neg_a2, a2);
+  GT _f;
+  precomputedMillerLoop2mixed(_f, a1, b1, _neg_a2, b2.coefficients());
+  finalExp(_f, _f);
+  return _f.isOne();
+}
+
+bool
+ps_pairing_product_is_one(const std::vector<G1>& ps, const std::vector<G2>& qs,
+                          const G1& p, const PSPrecomputedG2& q)
+{
+  if (ps.size() != qs.size()) {
+    return false;
+  }
+  GT _f;
+  precomputedMillerLoop(_f, p, q.coefficients());
+  if (!ps.empty()) {
+    GT _f_rest;
+    millerLoopVec(_f_rest, ps.data(), qs.data(), ps.size());
+    GT::mul(_f, _f, _f_rest);
+  }
+  finalExp(_f, _f);
+  return _f.isOne();
+}
+
+Fr
+ps_random_small_exponent()
+{
+  uint8_t _buf[32];
+  Fr _full;
+  _full.setByCSPRNG();
+  _full.serialize(_buf, sizeof(_buf));
+  int64_t _small = 0;
+  for (size_t i = 0; i < 8; i++) {
+    _small = (_small << 8) | _buf[i];
+  }
+  _small &= INT64_MAX;
+  if (_small == 0) {
+    _small = 1;
+  }
+  return Fr(_small);
+}
@@ -0,0 +1,88 @@
+#ifndef PS_SRC_PS_PAIRING_H_
+#define PS_SRC_PS_PAIRING_H_
+
+#include <mcl/bls12_381.hpp>
+#include <vector>
+
+using namespace mcl::bls12;
+
+/**
+ * @brief The Miller-loop line coefficients of a fixed G2 point.
+ *
+ * Pairings with a fixed G2 argument, such as the generator gg of a public key, can skip the
+ * G2 side of the Miller loop by evaluating these precomputed lines instead.
+ */
+class PSPrecomputedG2 {
+public:
+  PSPrecomputedG2() = default;
+
+  /**
+   * @brief Precompute the lines of @p q.
+   */
+  explicit PSPrecomputedG2(const G2& q);
+
+  /**
+   * @brief The G2 point the lines belong to.
+   */
+  const G2&
+  point() const;
+
+  const std::vector<Fp6>&
+  coefficients() const;
+
+private:
+  G2 m_q;
+  std::vector<Fp6> m_coefficients;
+};
+
+/**
+ * @brief Check whether e(@p a1, @p b1) == e(@p a2, @p b2).
+ *
+ * Instead of computing two full pairings and comparing the results in GT, this function
+ * evaluates e(a1, b1) * e(-a2, b2) == 1 with a shared Miller loop and a single final
+ * exponentiation.
+ *
+ * @param a1 input G1 point of the left-hand side pairing.
+ * @param b1 input G2 point of the left-hand side pairing.
+ * @param a2 input G1 point of the right-hand side pairing.
+ * @param b2 input G2 point of the right-hand side pairing.
+ * @return true if both pairings are equal.
+ */
+bool
+ps_pairing_equal(const G1& a1, const G2& b1, const G1& a2, const G2& b2);
+
+/**
+ * @brief Same as above, with the lines of @p b2 precomputed.
+ */
+bool
+ps_pairing_equal(const G1& a1, const G2& b1, const G1& a2, const PSPrecomputedG2& b2);
+
+/**
+ * @brief Check whether PI{ e(@p ps[i], @p qs[i]) } == 1.
+ *
+ * All the pairings share one Miller loop and a single final exponentiation.
+ *
+ * @param ps input G1 points.
+ * @param qs input G2 points. qs.size() must be equal to ps.size().
+ * @return true if the product of all pairings is the identity of GT.
+ */
+bool
+ps_pairing_product_is_one(const std::vector<G1>& ps, const std::vector<G2>& qs);
+
+/**
+ * @brief Check whether PI{ e(@p ps[i], @p qs[i]) } * e(@p p, @p q) == 1, with the lines of @p q
+ *        precomputed.
+ */
+bool
+ps_pairing_product_is_one(const std::vector<G1>& ps, const std::vector<G2>& qs,
+                          const G1& p, const PSPrecomputedG2& q);
+
+/**
+ * @brief A random non-zero exponent of at most 63 bits, for randomized batch checks.
+ *
+ * A forged element passes a check randomized this way with probability at most 2^-63.
+ */
+Fr
+ps_random_small_exponent();
+
+#endif  // PS_SRC_PS_PAIRING_H_
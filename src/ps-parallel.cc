@@ -0,0 +1,57 @@
+#include "ps-parallel.h"
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+void
+ps_parallel_for(size_t n, size_t thread_num, const std::function<void(size_t)>& job)
+{
+#if defined(__EMSCRIPTEN__) && !defined(__EMSCRIPTEN_PTHREADS__)
+  thread_num = 1;
+#endif
+  if (thread_num == 0) {
+    thread_num = std::max(1u, std::thread::hardware_concurrency());
+  }
+  thread_num = std::min(thread_num, n);
+  if (thread_num <= 1) {
+    for (size_t i = 0; i < n; i++) {
+      job(i);
+    }
+    return;
+  }
+
+  std::atomic<size_t> next(0);
+  std::exception_ptr error;
+  std::mutex error_mutex;
+  auto worker = [&] {
+    size_t i;
+    while ((i = next.fetch_add(1)) < n) {
+      try {
+        job(i);
+      }
+      catch (...) {
+        std::lock_guard<std::mutex> lock(error_mutex);
+        if (!error) {
+          error = std::current_exception();
+        }
+        next = n;  // stop handing out jobs
+      }
+    }
+  };
+  std::vector<std::thread> threads;
+  threads.reserve(thread_num - 1);
+  for (size_t t = 1; t < thread_num; t++) {
+    threads.emplace_back(worker);
+  }
+  worker();  // the calling thread is a worker too
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  if (error) {
+    std::rethrow_exception(error);
+  }
+}
@@ -0,0 +1,22 @@
+#ifndef PS_SRC_PS_PARALLEL_H_
+#define PS_SRC_PS_PARALLEL_H_
+
+#include <cstddef>
+#include <functional>
+
+/**
+ * @brief Run @p job(i) for every i in [0, @p n) on a pool of worker threads.
+ *
+ * Indexes are handed out one at a time, so jobs of uneven cost are balanced across workers.
+ * Jobs must only write to state owned by their own index.
+ * The first exception thrown by a job is rethrown once all workers have stopped.
+ *
+ * @param n input The number of jobs.
+ * @param thread_num input The number of workers, 0 for std::thread::hardware_concurrency().
+ *        Builds without thread support always run the jobs on the calling thread.
+ * @param job input The job to run for each index.
+ */
+void
+ps_parallel_for(size_t n, size_t thread_num, const std::function<void(size_t)>& job);
+
+#endif  // PS_SRC_PS_PARALLEL_H_
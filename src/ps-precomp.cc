@@ -0,0 +1,155 @@
+#include "ps-precomp.h"
+
+#include <cstdint>
+#include <stdexcept>
+
+#include "ps-msm.h"
+
+using namespace mcl::bls12;
+
+static const size_t MAX_MULTI_MUL_WINDOW_BITS = 12;
+
+template <class G>
+PSFixedBaseTable<G>::PSFixedBaseTable()
+    : m_window_bits(0)
+    , m_window_num(0)
+{
+  m_base.clear();
+}
+
+template <class G>
+PSFixedBaseTable<G>::PSFixedBaseTable(const G& base, size_t window_bits)
+    : m_base(base)
+    , m_window_bits(window_bits)
+{
+  if (m_window_bits < 1 || m_window_bits > 8) {
+    throw std::runtime_error("unsupported window size");
+  }
+  m_window_num = (Fr::getBitSize() + m_window_bits - 1) / m_window_bits;
+  size_t _row_size = (size_t(1) << m_window_bits) - 1;
+  m_table.resize(m_window_num * _row_size);
+  G _row_base = base;
+  G _acc;
+  for (size_t i = 0; i < m_window_num; i++) {
+    _acc = _row_base;
+    for (size_t j = 0; j < _row_size; j++) {
+      m_table[i * _row_size + j] = _acc;
+      G::add(_acc, _acc, _row_base);
+    }
+    // _acc = row_base^(2^w), the base of the next window
+    _row_base = _acc;
+  }
+  for (auto& item : m_table) {
+    item.normalize();
+  }
+}
+
+template <class G>
+void
+PSFixedBaseTable<G>::mul(G& z, const Fr& scalar) const
+{
+  if (m_table.empty()) {
+    G::mul(z, m_base, scalar);
+    return;
+  }
+  uint8_t _bytes[64];
+  size_t _byte_size = ps_scalar_bytes(scalar, _bytes);
+  size_t _row_size = (size_t(1) << m_window_bits) - 1;
+  z.clear();
+  for (size_t i = 0; i < m_window_num; i++) {
+    size_t _digit = ps_scalar_digit(_bytes, _byte_size, i * m_window_bits, m_window_bits);
+    if (_digit != 0) {
+      G::add(z, z, m_table[i * _row_size + _digit - 1]);
+    }
+  }
+}
+
+template <class G>
+void
+PSFixedBaseTable<G>::multi_mul(G& z, const std::vector<const PSFixedBaseTable<G>*>& tables,
+                               const std::vector<Fr>& scalars)
+{
+  if (tables.size() != scalars.size()) {
+    throw std::runtime_error("table size does not match scalar size");
+  }
+  z.clear();
+  if (tables.empty()) {
+    return;
+  }
+  size_t _window_bits = tables[0]->m_window_bits;
+  bool _all_built = true;
+  for (const auto& table : tables) {
+    if (table->m_table.empty() || table->m_window_bits != _window_bits) {
+      _all_built = false;
+      break;
+    }
+  }
+  G _temp;
+  if (!_all_built || tables.size() == 1) {
+    for (size_t i = 0; i < tables.size(); i++) {
+      tables[i]->mul(_temp, scalars[i]);
+      G::add(z, z, _temp);
+    }
+    return;
+  }
+  // Every table holds base^(2^(w*i)) as the first entry of row i, so merging k rows into one
+  // digit of c = k*w bits turns the sum into a single bucket sum over n * (bit_size / c) points.
+  // Select k minimizing n * (bit_size / c) + 2^(c+1) additions.
+  size_t _n = tables.size();
+  size_t _bit_size = Fr::getBitSize();
+  size_t _k = 1;
+  size_t _best_cost = SIZE_MAX;
+  for (size_t k = 1; k * _window_bits <= MAX_MULTI_MUL_WINDOW_BITS; k++) {
+    size_t c = k * _window_bits;
+    size_t cost = _n * ((_bit_size + c - 1) / c) + (size_t(1) << (c + 1));
+    if (cost < _best_cost) {
+      _best_cost = cost;
+      _k = k;
+    }
+  }
+  size_t _c = _k * _window_bits;
+  size_t _digit_num = (_bit_size + _c - 1) / _c;
+  size_t _row_size = (size_t(1) << _window_bits) - 1;
+  std::vector<const G*> _points;
+  std::vector<uint32_t> _digits;
+  _points.reserve(_n * _digit_num);
+  _digits.reserve(_n * _digit_num);
+  uint8_t _bytes[64];
+  for (size_t i = 0; i < _n; i++) {
+    size_t _byte_size = ps_scalar_bytes(scalars[i], _bytes);
+    const auto& _rows = tables[i]->m_table;
+    for (size_t d = 0; d < _digit_num; d++) {
+      uint32_t digit = ps_scalar_digit(_bytes, _byte_size, d * _c, _c);
+      if (digit != 0) {
+        _points.push_back(&_rows[d * _k * _row_size]);
+        _digits.push_back(digit);
+      }
+    }
+  }
+  ps_bucket_sum(z, _points, _digits, _c);
+}
+
+template <class G>
+const G&
+PSFixedBaseTable<G>::base() const
+{
+  return m_base;
+}
+
+template class PSFixedBaseTable<G1>;
+template class PSFixedBaseTable<G2>;
+
+PSPubKeyPrecomp::PSPubKeyPrecomp(const PSPubKey& pk, size_t window_bits)
+    : g(pk.g, window_bits)
+    , gg(pk.gg, window_bits)
+    , XX(pk.XX, window_bits)
+{
+  Yi.reserve(pk.Yi.size());
+  for (const auto& item : pk.Yi) {
+    Yi.emplace_back(item, window_bits);
+  }
+  YYi.reserve(pk.YYi.size());
+  for (const auto& item : pk.YYi) {
+    YYi.emplace_back(item, window_bits);
+  }
+}
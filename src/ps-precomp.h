@@ -0,0 +1,92 @@
+#ifndef PS_SRC_PS_PRECOMP_H_
+#define PS_SRC_PS_PRECOMP_H_
+
+#include "ps-encoding.h"
+
+using namespace mcl::bls12;
+
+/**
+ * @brief Windowed precomputation table for scalar multiplications over a fixed base.
+ *
+ * For a window of w bits, the table stores base^(j * 2^(w*i)) for every window i and
+ * every digit j in [1, 2^w - 1], so that a scalar multiplication only costs one addition
+ * per non-zero window and no doubling.
+ *
+ * Instantiated for G1 and G2.
+ */
+template <class G>
+class PSFixedBaseTable {
+public:
+  PSFixedBaseTable();
+
+  /**
+   * @brief Build the table for @p base.
+   *
+   * @param base input The fixed base.
+   * @param window_bits input The window size in bits, in [1, 8].
+   */
+  explicit PSFixedBaseTable(const G& base, size_t window_bits = 4);
+
+  /**
+   * @brief z = base^scalar.
+   *
+   * Falls back to G::mul when the table has not been built.
+   */
+  void
+  mul(G& z, const Fr& scalar) const;
+
+  /**
+   * @brief Multi-scalar multiplication z = SUM{ tables[i].base^scalars[i] }.
+   *
+   * Uses Pippenger's bucket method over the precomputed window bases of all the tables,
+   * so no doubling is needed and the cost per base shrinks as the number of bases grows.
+   */
+  static void
+  multi_mul(G& z, const std::vector<const PSFixedBaseTable<G>*>& tables, const std::vector<Fr>& scalars);
+
+  const G&
+  base() const;
+
+private:
+  G m_base;
+  size_t m_window_bits;
+  size_t m_window_num;
+  std::vector<G> m_table;  // m_table[i * (2^w - 1) + (j - 1)] = base^(j * 2^(w*i))
+};
+
+/**
+ * @brief Fixed-base tables for all the generators in a PSPubKey.
+ *
+ * Built once from a public key and used by PSSigner, PSRequester, and PSVerifier for
+ * every scalar multiplication over g, gg, XX, Yi, and YYi.
+ */
+class PSPubKeyPrecomp {
+public:
+  PSPubKeyPrecomp() = default;
+
+  explicit PSPubKeyPrecomp(const PSPubKey& pk, size_t window_bits = 4);
+
+public:
+  /**
+   * @brief Table for the generator of group G1.
+   */
+  PSFixedBaseTable<G1> g;
+  /**
+   * @brief Table for the generator of group G2.
+   */
+  PSFixedBaseTable<G2> gg;
+  /**
+   * @brief Table for gg^x.
+   */
+  PSFixedBaseTable<G2> XX;
+  /**
+   * @brief Tables for g^yi, one per attribute.
+   */
+  std::vector<PSFixedBaseTable<G1>> Yi;
+  /**
+   * @brief Tables for gg^yi, one per attribute.
+   */
+  std::vector<PSFixedBaseTable<G2>> YYi;
+};
+
+#endif  // PS_SRC_PS_PRECOMP_H_
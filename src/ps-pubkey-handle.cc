@@ -0,0 +1,36 @@
+#include "ps-pubkey-handle.h"
+
+#include <stdexcept>
+
+PSPubKeyHandle::PSPubKeyHandle(const PSPubKey& pk)
+{
+  PSPubKey _pk = pk;
+  if (!_pk.validate()) {
+    throw std::runtime_error("invalid public key");
+  }
+  m_data = std::make_shared<const Data>(Data{_pk, PSPubKeyPrecomp(_pk), PSPrecomputedG2(_pk.gg)});
+}
+
+const PSPubKey&
+PSPubKeyHandle::pk() const
+{
+  return m_data->pk;
+}
+
+const PSPubKeyPrecomp&
+PSPubKeyHandle::precomp() const
+{
+  return m_data->precomp;
+}
+
+const PSPrecomputedG2&
+PSPubKeyHandle::gg_lines() const
+{
+  return m_data->gg_lines;
+}
+
+long
+PSPubKeyHandle::use_count() const
+{
+  return m_data.use_count();
+}
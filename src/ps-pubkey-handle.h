@@ -0,0 +1,62 @@
+#ifndef PS_SRC_PS_PUBKEY_HANDLE_H_
+#define PS_SRC_PS_PUBKEY_HANDLE_H_
+
+#include <memory>
+
+#include "ps-encoding.h"
+#include "ps-pairing.h"
+#include "ps-precomp.h"
+
+using namespace mcl::bls12;
+
+/**
+ * @brief A validated public key bundled with its precomputation, immutable and reference-counted.
+ *
+ * The key, its fixed-base tables, and the Miller-loop lines of gg are built once by the
+ * constructor. Copies of a handle share them, so any number of PSSigner, PSRequester, and
+ * PSVerifier objects on any number of threads can use one key without copying it. Nothing
+ * can be modified after construction, so sharing needs no locking.
+ */
+class PSPubKeyHandle {
+public:
+  /**
+   * @brief An empty handle, to be assigned before use.
+   */
+  PSPubKeyHandle() = default;
+
+  /**
+   * @brief Validate @p pk and build its precomputation.
+   *
+   * @param pk input The public key. Throws std::runtime_error if PSPubKey::validate() fails.
+   */
+  explicit PSPubKeyHandle(const PSPubKey& pk);
+
+  const PSPubKey&
+  pk() const;
+
+  const PSPubKeyPrecomp&
+  precomp() const;
+
+  /**
+   * @brief The Miller-loop lines of gg.
+   */
+  const PSPrecomputedG2&
+  gg_lines() const;
+
+  /**
+   * @brief The number of handles sharing this key, 0 for an empty handle.
+   */
+  long
+  use_count() const;
+
+private:
+  struct Data {
+    PSPubKey pk;
+    PSPubKeyPrecomp precomp;
+    PSPrecomputedG2 gg_lines;
+  };
+
+  std::shared_ptr<const Data> m_data;
+};
+
+#endif  // PS_SRC_PS_PUBKEY_HANDLE_H_
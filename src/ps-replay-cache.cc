@@ -0,0 +1,80 @@
+#include "ps-replay-cache.h"
+
+#include <algorithm>
+#include <functional>
+
+using namespace mcl::bls12;
+
+PSReplayCache::PSReplayCache(std::chrono::milliseconds ttl, size_t shard_num)
+    : m_ttl(ttl)
+    , m_shards(new Shard[std::max<size_t>(shard_num, 1)])
+    , m_shard_num(std::max<size_t>(shard_num, 1))
+{
+}
+
+bool
+PSReplayCache::contains(const Fr& c, const std::string& associated_data) const
+{
+  auto _key = make_key(c, associated_data);
+  auto& _shard = shard_of(_key);
+  std::lock_guard<std::mutex> lock(_shard.mutex);
+  auto _entry = _shard.expiries.find(_key);
+  return _entry != _shard.expiries.end() && _entry->second > Clock::now();
+}
+
+bool
+PSReplayCache::insert(const Fr& c, const std::string& associated_data)
+{
+  auto _key = make_key(c, associated_data);
+  auto& _shard = shard_of(_key);
+  auto _now = Clock::now();
+  std::lock_guard<std::mutex> lock(_shard.mutex);
+  // every key lives for the same ttl, so the oldest keys expire first
+  while (!_shard.order.empty() && _shard.order.front().first <= _now) {
+    auto _entry = _shard.expiries.find(_shard.order.front().second);
+    if (_entry != _shard.expiries.end() && _entry->second <= _now) {
+      _shard.expiries.erase(_entry);
+    }
+    _shard.order.pop_front();
+  }
+  auto _expiry = _now + m_ttl;
+  auto _inserted = _shard.expiries.emplace(_key, _expiry);
+  if (!_inserted.second) {
+    return false;
+  }
+  _shard.order.emplace_back(_expiry, std::move(_key));
+  return true;
+}
+
+size_t
+PSReplayCache::size() const
+{
+  size_t _size = 0;
+  for (size_t i = 0; i < m_shard_num; i++) {
+    std::lock_guard<std::mutex> lock(m_shards[i].mutex);
+    _size += m_shards[i].expiries.size();
+  }
+  return _size;
+}
+
+std::chrono::milliseconds
+PSReplayCache::ttl() const
+{
+  return m_ttl;
+}
+
+std::string
+PSReplayCache::make_key(const Fr& c, const std::string& associated_data)
+{
+  uint8_t _buf[64];
+  size_t _size = c.serialize(_buf, sizeof(_buf));
+  std::string _key(reinterpret_cast<const char*>(_buf), _size);
+  _key.append(associated_data);
+  return _key;
+}
+
+PSReplayCache::Shard&
+PSReplayCache::shard_of(const std::string& key) const
+{
+  return m_shards[std::hash<std::string>()(key) % m_shard_num];
+}
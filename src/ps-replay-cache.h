@@ -0,0 +1,84 @@
+#ifndef PS_SRC_PS_REPLAY_CACHE_H_
+#define PS_SRC_PS_REPLAY_CACHE_H_
+
+#include <chrono>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "ps-encoding.h"
+
+using namespace mcl::bls12;
+
+/**
+ * @brief The proofs accepted by an RP within a time to live, keyed by the NIZK challenge c and the
+ *        associated data of each proof.
+ *
+ * The challenge commits to the prover's random values, so an honest user never sends the same
+ * (c, associated data) twice, while a replayed proof always does. The keys are spread over shards,
+ * each with its own lock, so that concurrent verifications rarely contend. All functions are
+ * thread-safe.
+ */
+class PSReplayCache {
+public:
+  /**
+   * @brief Create an empty cache.
+   *
+   * @param ttl input How long an accepted proof is remembered. It should cover the time an RP
+   *        accepts the associated data of a proof, e.g., the lifetime of a login session.
+   * @param shard_num input The number of independently locked shards.
+   */
+  explicit PSReplayCache(std::chrono::milliseconds ttl, size_t shard_num = 16);
+
+  PSReplayCache(const PSReplayCache&) = delete;
+  PSReplayCache&
+  operator=(const PSReplayCache&) = delete;
+
+  /**
+   * @brief Whether a proof with @p c and @p associated_data was accepted within the time to live.
+   */
+  bool
+  contains(const Fr& c, const std::string& associated_data) const;
+
+  /**
+   * @brief Remember an accepted proof.
+   *
+   * @return bool False if the proof was already accepted within the time to live, i.e., it is a replay.
+   */
+  bool
+  insert(const Fr& c, const std::string& associated_data);
+
+  /**
+   * @brief The number of proofs remembered, including those expired but not purged yet.
+   */
+  size_t
+  size() const;
+
+  std::chrono::milliseconds
+  ttl() const;
+
+private:
+  using Clock = std::chrono::steady_clock;
+
+  struct Shard {
+    mutable std::mutex mutex;
+    std::unordered_map<std::string, Clock::time_point> expiries;   // key -> expiry
+    std::deque<std::pair<Clock::time_point, std::string>> order;   // keys by expiry, oldest first
+  };
+
+  static std::string
+  make_key(const Fr& c, const std::string& associated_data);
+
+  Shard&
+  shard_of(const std::string& key) const;
+
+private:
+  std::chrono::milliseconds m_ttl;
+  std::unique_ptr<Shard[]> m_shards;
+  size_t m_shard_num;
+};
+
+#endif  // PS_SRC_PS_REPLAY_CACHE_H_
@@ -1,24 +1,44 @@
 #include "ps-requester.h"
 
 #include <chrono>
-#include <cybozu/sha2.hpp>
+#include <stdexcept>
+#include <utility>
+
+#include "ps-pairing.h"
+#include "ps-transcript.h"
 
 using namespace mcl::bls12;
 
 PSRequester::PSRequester(const PSPubKey& pk)
-    : m_pk(pk)
+    : m_key(pk)
 {
 }
 
+PSRequester::PSRequester(const PSPubKeyHandle& key)
+    : m_key(key)
+{
+  if (m_key.use_count() == 0) {
+    throw std::runtime_error("empty public key handle");
+  }
+}
+
 size_t
 PSRequester::maxAllowedAttrNum() const
 {
-  return m_pk.Yi.size();
+  return m_key.pk().Yi.size();
 }
 
-PSCredRequest
+PSIssuanceSession
 PSRequester::el_passo_request_id(const std::vector<std::tuple<std::string, bool>> attributes,  // string is the attribute, bool whether to hide
-                                 const std::string& associated_data)
+                                 const std::string& associated_data) const
+{
+  return el_passo_request_id(attributes, std::vector<bool>(), associated_data);
+}
+
+PSIssuanceSession
+PSRequester::el_passo_request_id(const std::vector<std::tuple<std::string, bool>> attributes,
+                                 const std::vector<bool>& used_slots,
+                                 const std::string& associated_data) const
 {
   /** NIZK Prove:
    * Public Value: A = g^t * PI{Yi^(attribute_i)}, will be sent
@@ -26,63 +46,64 @@ PSRequester::el_passo_request_id(const std::vector<std::tuple<std::string, bool>
    * c = hash( A || V || associated_data);, will be sent
    * r0 = random1 - t*c; r1 = random2_i - attribute_i * c, will be sent
    */
-  // calcuate the max number of attributes supported
-  size_t maxAllowedAttrNum = m_pk.Yi.size();
-  if (attributes.size() != maxAllowedAttrNum) {
+  // the key slot of each attribute
+  std::vector<size_t> _slots;
+  if (!ps_slot_indexes(used_slots, attributes.size(), m_key.pk().Yi.size(), _slots)) {
     throw std::runtime_error("attribute size does not match");
   }
   // parameters to send:
-  PSCredRequest request;
+  PSIssuanceSession session;
+  PSCredRequest& request = session.request;
+  request.used_slots = used_slots;
   request.rs.reserve(attributes.size() + 1);
+  // bases of A and V: g and Yi of committed attributes
+  std::vector<const PSFixedBaseTable<G1>*> _bases;
+  _bases.reserve(attributes.size() + 1);
+  _bases.push_back(&m_key.precomp().g);
   // Prepare for A
-  m_t1.setByCSPRNG();
-  G1::mul(request.A, m_pk.g, m_t1);
+  session.t.setByCSPRNG();
   Fr _attribute_hash;
-  G1 _Yi_hash, _Yi_randomness;
-  std::vector<Fr> _attribute_hashes;
-  _attribute_hashes.reserve(attributes.size());
+  std::vector<Fr> _A_scalars;  // t and the hashes of committed attributes
+  _A_scalars.reserve(attributes.size() + 1);
+  _A_scalars.push_back(session.t);
   // Parepare for randomness
   std::vector<Fr> _randomnesses;
   _randomnesses.reserve(attributes.size() + 1);
   Fr _temp_randomness;
   _temp_randomness.setByCSPRNG();
   _randomnesses.push_back(_temp_randomness);  // the randomness for g^t
-  // prepare for V
-  G1 _V;
-  G1::mul(_V, m_pk.g, _temp_randomness);
   for (size_t i = 0; i < attributes.size(); i++) {
     if (std::get<1>(attributes[i])) {
       // this attribute needs to be commitmented
-      // calculate A
+      _bases.push_back(&m_key.precomp().Yi[_slots[i]]);
       _attribute_hash.setHashOf(std::get<0>(attributes[i]));
-      _attribute_hashes.push_back(_attribute_hash);
-      G1::mul(_Yi_hash, m_pk.Yi[i], _attribute_hash);
-      G1::add(request.A, request.A, _Yi_hash);
+      _A_scalars.push_back(_attribute_hash);
       // generate randomness
       _temp_randomness.setByCSPRNG();
       _randomnesses.push_back(_temp_randomness);  // the randomness for message i
-      // calculate V
-      G1::mul(_Yi_randomness, m_pk.Yi[i], _temp_randomness);
-      G1::add(_V, _V, _Yi_randomness);
     }
   }
+  // calculate A = g^t * PI{Yi^(attribute_i)}
+  PSFixedBaseTable<G1>::multi_mul(request.A, _bases, _A_scalars);
+  // calculate V = g^random1 * PROD{Yi^(random2_i)}
+  G1 _V;
+  PSFixedBaseTable<G1>::multi_mul(_V, _bases, _randomnesses);
   // Calculate c
-  cybozu::Sha256 digest_engine;
-  digest_engine.update(request.A.serializeToHexStr());
-  digest_engine.update(_V.serializeToHexStr());
-  auto _c_str = digest_engine.digest(associated_data);
-  request.c.setHashOf(_c_str);
+  PSTranscript transcript(request.version, PS_TRANSCRIPT_REQUEST_ID);
+  transcript.append(request.A);
+  transcript.append(_V);
+  transcript.challenge(request.c, associated_data);
   // std::cout << "parepare: A: " << request.A.serializeToHexStr() << std::endl;
   // std::cout << "parepare: V: " << _V.serializeToHexStr() << std::endl;
   // std::cout << "parepare: c: " << request.c.serializeToHexStr() << std::endl;
   // Calculate rs
   Fr _r_temp;
-  Fr::mul(_r_temp, m_t1, request.c);
+  Fr::mul(_r_temp, session.t, request.c);
   Fr::sub(_r_temp, _randomnesses[0], _r_temp);
   request.rs.push_back(_r_temp);
-  for (size_t i = 0; i < _attribute_hashes.size(); i++) {
-    Fr::mul(_r_temp, _attribute_hashes[i], request.c);
-    Fr::sub(_r_temp, _randomnesses[i + 1], _r_temp);
+  for (size_t i = 1; i < _A_scalars.size(); i++) {
+    Fr::mul(_r_temp, _A_scalars[i], request.c);
+    Fr::sub(_r_temp, _randomnesses[i], _r_temp);
     request.rs.push_back(_r_temp);
   }
   // plaintext attributes
@@ -95,18 +116,18 @@ PSRequester::el_passo_request_id(const std::vector<std::tuple<std::string, bool>
       request.attributes.push_back(std::get<0>(attributes[i]));
     }
   }
-  return request;
+  return session;
 }
 
 PSCredential
-PSRequester::unblind_credential(const PSCredential& sig) const
+PSRequester::unblind_credential(const PSCredential& sig, const PSIssuanceSession& session) const
 {
   // unblinded_sig <- (sig_1, sig_2 / sig_1^t)
   PSCredential newSig;
   newSig.sig1 = sig.sig1;
 
   G1 _sig1_t;
-  G1::mul(_sig1_t, sig.sig1, m_t1);
+  G1::mul(_sig1_t, sig.sig1, session.t);
   G1::sub(newSig.sig2, sig.sig2, _sig1_t);
 
   return newSig;
@@ -115,25 +136,28 @@ PSRequester::unblind_credential(const PSCredential& sig) const
 bool
 PSRequester::verify(const PSCredential& sig, const std::vector<std::string>& all_attributes) const
 {
-  if (sig.sig1.isZero()) {
+  if (sig.sig1.isZero() || all_attributes.size() != m_key.pk().YYi.size()) {
     return false;
   }
 
+  std::vector<const PSFixedBaseTable<G2>*> _bases;
+  std::vector<Fr> _attribute_hashes;
+  _bases.reserve(all_attributes.size());
+  _attribute_hashes.reserve(all_attributes.size());
   Fr _attribute_hash;
-  G2 _yy_hash_sum = m_pk.XX;
   int counter = 0;
-  G2 _yyi_hash_product;
   for (const auto& attribute : all_attributes) {
     _attribute_hash.setHashOf(attribute);
-    G2::mul(_yyi_hash_product, m_pk.YYi[counter], _attribute_hash);
-    G2::add(_yy_hash_sum, _yy_hash_sum, _yyi_hash_product);
+    _bases.push_back(&m_key.precomp().YYi[counter]);
+    _attribute_hashes.push_back(_attribute_hash);
     counter++;
   }
+  G2 _yy_hash_sum;
+  PSFixedBaseTable<G2>::multi_mul(_yy_hash_sum, _bases, _attribute_hashes);
+  G2::add(_yy_hash_sum, _yy_hash_sum, m_key.pk().XX);
 
-  GT _lhs, _rhs;
-  pairing(_lhs, sig.sig1, _yy_hash_sum);
-  pairing(_rhs, sig.sig2, m_pk.gg);
-  return _lhs == _rhs;
+  // e(sig1, XX * PI{ YYi^mi }) ?= e(sig2, gg)
+  return ps_pairing_equal(sig.sig1, _yy_hash_sum, sig.sig2, m_key.gg_lines());
 }
 
 PSCredential
@@ -154,279 +178,369 @@ PSRequester::el_passo_prove_id(const PSCredential& sig,
                                const std::string& service_name,
                                const G1& authority_pk, const G1& g, const G1& h) const
 {
-  size_t maxAllowedAttrNum = m_pk.Yi.size();
-  if (attributes.size() != maxAllowedAttrNum) {
-    throw std::runtime_error("attribute size does not match");
-  }
+  auto token = el_passo_precompute_prove_id(sig, attributes, authority_pk, g, h);
+  return el_passo_prove_id(std::move(token), associated_data, service_name);
+}
 
-  IdProof proof;
-  // new_sig = sig1^r, (sig2 + sig1^t)^r
-  Fr _t, _r;
-  _t.setByCSPRNG();
-  _r.setByCSPRNG();
-  G1::mul(proof.sig1, sig.sig1, _r);
-  G1::mul(proof.sig2, sig.sig1, _t);
-  G1::add(proof.sig2, proof.sig2, sig.sig2);
-  G1::mul(proof.sig2, proof.sig2, _r);
+IdProof  // sig1, sig2, k, phi, c, rs, attributes
+PSRequester::el_passo_prove_id_without_id_retrieval(const PSCredential& sig,
+                                                    const std::vector<std::tuple<std::string, bool>> attributes,
+                                                    const std::string& associated_data,
+                                                    const std::string& service_name) const
+{
+  auto token = el_passo_precompute_prove_id_without_id_retrieval(sig, attributes);
+  return el_passo_prove_id(std::move(token), associated_data, service_name);
+}
 
-  // El Gamal Cipher E = g^epsilon, y^epsilon * h^gamma
-  G1 _E1, _E2, _h_gamma;
-  Fr _epsilon, _gamma;
-  _epsilon.setByCSPRNG();
+PSPresentationToken
+PSRequester::el_passo_precompute_prove_id(const PSCredential& sig,
+                                          const std::vector<std::tuple<std::string, bool>> attributes,
+                                          const G1& authority_pk, const G1& g, const G1& h) const
+{
+  auto token = el_passo_precompute_prove_id_without_id_retrieval(sig, attributes);
+  Fr _gamma;
   _gamma.setHashOf(std::get<0>(attributes[1]));
-  G1::mul(_E1, g, _epsilon);
-  G1::mul(_E2, authority_pk, _epsilon);
-  G1::mul(_h_gamma, h, _gamma);
-  G1::add(_E2, _E2, _h_gamma);
+  add_id_retrieval(token, _gamma, authority_pk, g, h);
+  return token;
+}
+
+PSPresentationToken
+PSRequester::el_passo_precompute_prove_id_without_id_retrieval(const PSCredential& sig,
+                                                               const std::vector<std::tuple<std::string, bool>> attributes) const
+{
+  size_t maxAllowedAttrNum = m_key.pk().Yi.size();
+  if (attributes.size() != maxAllowedAttrNum) {
+    throw std::runtime_error("attribute size does not match");
+  }
 
-  // phi = hash(service_name)^gamma
-  G1 _service_hash;
   Fr _s;
-  hashAndMapToG1(_service_hash, service_name);
   _s.setHashOf(std::get<0>(attributes[0]));
-  G1::mul(proof.phi, _service_hash, _s);
-
-  // k = XX * PI{ YYj^mj } * gg^t
-  proof.k = m_pk.XX;
+  std::vector<size_t> _slots;
+  ps_slot_indexes(std::vector<bool>(), attributes.size(), maxAllowedAttrNum, _slots);
+  std::vector<bool> _hidden;
+  std::vector<Fr> _hidden_hashes;
+  _hidden.reserve(attributes.size());
+  _hidden_hashes.reserve(attributes.size());
   Fr _attribute_hash;
-  G2 _yy_hash;
-  std::vector<Fr> _attribute_hashes;
-  _attribute_hashes.reserve(attributes.size());
   for (size_t i = 0; i < attributes.size(); i++) {
+    _hidden.push_back(std::get<1>(attributes[i]));
     if (std::get<1>(attributes[i])) {
       _attribute_hash.setHashOf(std::get<0>(attributes[i]));
-      _attribute_hashes.push_back(_attribute_hash);
-      G2::mul(_yy_hash, m_pk.YYi[i], _attribute_hash);
-      G2::add(proof.k, proof.k, _yy_hash);
+      _hidden_hashes.push_back(_attribute_hash);
     }
   }
-  G2::mul(_yy_hash, m_pk.gg, _t);
-  G2::add(proof.k, proof.k, _yy_hash);
+  auto token = precompute_token(sig, _s, _hidden, _slots, _hidden_hashes, nullptr);
 
-  /** NIZK Prove:
-   * Public Value: will be sent
-   * * k = XX * PI{ YY_j^attribute_j } * gg^t
-   * * phi = hash(domain)^s
-   * * E1 = g^epsilon
-   * * E2 = y^epsilon * h^gamma
-   *
-   * Public Random Value: will not be sent
-   * * V_k = XX * PI{ YYj^random1_j } * gg^random_2
-   * * V_phi = hash(domain)^random1_s
-   * * V_E1 = g^random_3
-   * * V_E2 = y^random_3 * h^random1_gamma
-   *
-   * c: will be sent
-   * c = hash(k || phi || E1 || E2 || V_k || V_phi || V_E1 || V_E2 || associated_data )
-   *
-   * Rs: will be sent
-   * * random1_j - attribute_j * c
-   * * random2 - t * c
-   * * random3 - epsilon * c
-   */
-  // V_k = XX * PI{ YYj^random1_j } * gg^random_2
-  G2 _V_k = m_pk.XX;
-  std::vector<Fr> _randomnesses;
-  Fr _temp_randomness;
-  G2 _yy_randomness;
-  _randomnesses.reserve(attributes.size() + 2);
+  // plaintext attributes
+  token.attributes.reserve(attributes.size());
   for (size_t i = 0; i < attributes.size(); i++) {
     if (std::get<1>(attributes[i])) {
-      _temp_randomness.setByCSPRNG();
-      _randomnesses.push_back(_temp_randomness);
-      G2::mul(_yy_randomness, m_pk.YYi[i], _temp_randomness);
-      G2::add(_V_k, _V_k, _yy_randomness);
+      token.attributes.push_back("");
+    }
+    else {
+      token.attributes.push_back(std::get<0>(attributes[i]));
     }
   }
-  _temp_randomness.setByCSPRNG();
-  _randomnesses.push_back(_temp_randomness);  // random2
-  G2::mul(_yy_randomness, m_pk.gg, _temp_randomness);
-  G2::add(_V_k, _V_k, _yy_randomness);
+  return token;
+}
 
-  // V_phi
-  G1 _V_phi;
-  G1::mul(_V_phi, _service_hash, _randomnesses[0]);  // random1_s
+PSStoredCredential
+PSRequester::store_credential(const PSCredential& sig, const std::vector<std::string>& all_attributes) const
+{
+  return store_credential(sig, all_attributes, std::vector<bool>());
+}
 
-  // V_E1 = g^random_3
-  G1 _V_E1;
-  _temp_randomness.setByCSPRNG();
-  _randomnesses.push_back(_temp_randomness);  // random 3
-  G1::mul(_V_E1, g, _temp_randomness);
+PSStoredCredential
+PSRequester::store_credential(const PSCredential& sig, const std::vector<std::string>& all_attributes,
+                              const std::vector<bool>& used_slots) const
+{
+  std::vector<size_t> _slots;
+  if (!ps_slot_indexes(used_slots, all_attributes.size(), m_key.pk().Yi.size(), _slots)) {
+    throw std::runtime_error("attribute size does not match");
+  }
+  PSStoredCredential credential;
+  credential.sig = sig;
+  credential.attributes = all_attributes;
+  credential.used_slots = used_slots;
+  credential.attribute_hashes.resize(all_attributes.size());
+  credential.attribute_terms.resize(all_attributes.size());
+  credential.signed_message = m_key.pk().XX;
+  for (size_t i = 0; i < all_attributes.size(); i++) {
+    credential.attribute_hashes[i].setHashOf(all_attributes[i]);
+    m_key.precomp().YYi[_slots[i]].mul(credential.attribute_terms[i], credential.attribute_hashes[i]);
+    G2::add(credential.signed_message, credential.signed_message, credential.attribute_terms[i]);
+  }
+  if (!verify(credential)) {
+    throw std::runtime_error("invalid credential");
+  }
+  return credential;
+}
 
-  // V_E2 = y^random_3 * h^random1_gamma
-  G1 _V_E2;
-  G1 _h_random;
-  G1::mul(_V_E2, authority_pk, _temp_randomness);
-  G1::mul(_h_random, h, _randomnesses[1]);  // random1_gamma
-  G1::add(_V_E2, _V_E2, _h_random);
+bool
+PSRequester::verify(const PSStoredCredential& credential) const
+{
+  if (credential.sig.sig1.isZero()) {
+    return false;
+  }
+  // e(sig1, XX * PI{ YYi^mi }) ?= e(sig2, gg)
+  return ps_pairing_equal(credential.sig.sig1, credential.signed_message, credential.sig.sig2, m_key.gg_lines());
+}
 
-  // Calculate c = hash(k || phi || E1 || E2 || V_k || V_phi || V_E1 || V_E2 || associated_data )
-  cybozu::Sha256 digest_engine;
-  digest_engine.update(proof.k.serializeToHexStr());
-  digest_engine.update(proof.phi.serializeToHexStr());
-  digest_engine.update(_E1.serializeToHexStr());
-  digest_engine.update(_E2.serializeToHexStr());
-  digest_engine.update(_V_k.serializeToHexStr());
-  digest_engine.update(_V_phi.serializeToHexStr());
-  digest_engine.update(_V_E1.serializeToHexStr());
-  digest_engine.update(_V_E2.serializeToHexStr());
-  auto _c_str = digest_engine.digest(associated_data);
-  proof.c.setHashOf(_c_str);
-  // std::cout << "parepare: V k: " << _V_k.serializeToHexStr() << std::endl;
-  // std::cout << "parepare: V phi: " << _V_phi.serializeToHexStr() << std::endl;
-  // std::cout << "parepare: V E1: " << _V_E1.serializeToHexStr() << std::endl;
-  // std::cout << "parepare: V E2: " << _V_E2.serializeToHexStr() << std::endl;
+IdProof  // sig1, sig2, k, phi, E1, E2, c, rs, attributes
+PSRequester::el_passo_prove_id(const PSStoredCredential& credential,
+                               const std::vector<bool>& hidden,
+                               const std::string& associated_data,
+                               const std::string& service_name,
+                               const G1& authority_pk, const G1& g, const G1& h) const
+{
+  auto token = el_passo_precompute_prove_id(credential, hidden, authority_pk, g, h);
+  return el_passo_prove_id(std::move(token), associated_data, service_name);
+}
 
-  // Calculate Rs
-  Fr _temp_r;
-  Fr _secret_c;
-  proof.rs.reserve(attributes.size() + 2);
-  for (size_t i = 0; i < _attribute_hashes.size(); i++) {
-    Fr::mul(_secret_c, _attribute_hashes[i], proof.c);
-    Fr::sub(_temp_r, _randomnesses[i], _secret_c);
-    proof.rs.push_back(_temp_r);
+IdProof  // sig1, sig2, k, phi, c, rs, attributes
+PSRequester::el_passo_prove_id_without_id_retrieval(const PSStoredCredential& credential,
+                                                    const std::vector<bool>& hidden,
+                                                    const std::string& associated_data,
+                                                    const std::string& service_name) const
+{
+  auto token = el_passo_precompute_prove_id_without_id_retrieval(credential, hidden);
+  return el_passo_prove_id(std::move(token), associated_data, service_name);
+}
+
+PSPresentationToken
+PSRequester::el_passo_precompute_prove_id(const PSStoredCredential& credential,
+                                          const std::vector<bool>& hidden,
+                                          const G1& authority_pk, const G1& g, const G1& h) const
+{
+  // gamma is encrypted for the authority, and its Schnorr randomness is the second one
+  if (hidden.size() < 2 || !hidden[1]) {
+    throw std::runtime_error("gamma must be committed");
+  }
+  auto token = el_passo_precompute_prove_id_without_id_retrieval(credential, hidden);
+  add_id_retrieval(token, credential.attribute_hashes[1], authority_pk, g, h);
+  return token;
+}
+
+PSPresentationToken
+PSRequester::el_passo_precompute_prove_id_without_id_retrieval(const PSStoredCredential& credential,
+                                                               const std::vector<bool>& hidden) const
+{
+  std::vector<size_t> _slots;
+  if (hidden.size() != credential.attribute_terms.size()
+      || !ps_slot_indexes(credential.used_slots, hidden.size(), m_key.pk().Yi.size(), _slots)) {
+    throw std::runtime_error("attribute size does not match");
+  }
+  // s derives phi with the first Schnorr randomness, and must never be sent in plaintext
+  if (hidden.empty() || !hidden[0]) {
+    throw std::runtime_error("s must be committed");
   }
-  Fr::mul(_secret_c, _t, proof.c);
-  Fr::sub(_temp_r, _randomnesses[_randomnesses.size() - 2], _secret_c);
-  proof.rs.push_back(_temp_r);
-  Fr::mul(_secret_c, _epsilon, proof.c);
-  Fr::sub(_temp_r, _randomnesses[_randomnesses.size() - 1], _secret_c);
-  proof.rs.push_back(_temp_r);
+
+  // PI{ YYj^mj } over the committed attributes, from the cached terms
+  G2 _hidden_sum;
+  _hidden_sum.clear();
+  std::vector<Fr> _hidden_hashes;
+  _hidden_hashes.reserve(hidden.size());
+  for (size_t i = 0; i < hidden.size(); i++) {
+    if (hidden[i]) {
+      G2::add(_hidden_sum, _hidden_sum, credential.attribute_terms[i]);
+      _hidden_hashes.push_back(credential.attribute_hashes[i]);
+    }
+  }
+  auto token = precompute_token(credential.sig, credential.attribute_hashes[0], hidden, _slots, _hidden_hashes,
+                                &_hidden_sum);
 
   // plaintext attributes
-  proof.attributes.reserve(attributes.size());
-  for (size_t i = 0; i < attributes.size(); i++) {
-    if (std::get<1>(attributes[i])) {
-      proof.attributes.push_back("");
+  token.attributes.reserve(hidden.size());
+  for (size_t i = 0; i < hidden.size(); i++) {
+    if (hidden[i]) {
+      token.attributes.push_back("");
     }
     else {
-      proof.attributes.push_back(std::get<0>(attributes[i]));
+      token.attributes.push_back(credential.attributes[i]);
     }
   }
-  // sig1, sig2, k, phi, E1, E2, c, rs, attributes
-  proof.E1 = _E1;
-  proof.E2 = _E2;
-  return proof;
+  token.used_slots = credential.used_slots;
+  return token;
 }
 
-IdProof  // sig1, sig2, k, phi, c, rs, attributes
-PSRequester::el_passo_prove_id_without_id_retrieval(const PSCredential& sig,
-                                                    const std::vector<std::tuple<std::string, bool>> attributes,
-                                                    const std::string& associated_data,
-                                                    const std::string& service_name) const
+PSPresentationToken
+PSRequester::precompute_token(const PSCredential& sig, const Fr& s, const std::vector<bool>& hidden,
+                              const std::vector<size_t>& slots, const std::vector<Fr>& hidden_hashes,
+                              const G2* hidden_sum) const
 {
-  size_t maxAllowedAttrNum = m_pk.Yi.size();
-  if (attributes.size() != maxAllowedAttrNum) {
-    throw std::runtime_error("attribute size does not match");
-  }
+  PSPresentationToken token;
+  token.s = s;
 
-  IdProof proof;
   // new_sig = sig1^r, (sig2 + sig1^t)^r
   Fr _t, _r;
   _t.setByCSPRNG();
   _r.setByCSPRNG();
-  G1::mul(proof.sig1, sig.sig1, _r);
-  G1::mul(proof.sig2, sig.sig1, _t);
-  G1::add(proof.sig2, proof.sig2, sig.sig2);
-  G1::mul(proof.sig2, proof.sig2, _r);
-
-  // phi = hash(service_name)^s
-  G1 _service_hash;
-  Fr _s;
-  hashAndMapToG1(_service_hash, service_name);
-  _s.setHashOf(std::get<0>(attributes[0]));
-  G1::mul(proof.phi, _service_hash, _s);
+  G1::mul(token.sig.sig1, sig.sig1, _r);
+  G1::mul(token.sig.sig2, sig.sig1, _t);
+  G1::add(token.sig.sig2, token.sig.sig2, sig.sig2);
+  G1::mul(token.sig.sig2, token.sig.sig2, _r);
 
   // k = XX * PI{ YYj^mj } * gg^t
-  proof.k = m_pk.XX;
-  Fr _attribute_hash;
-  G2 _yy_hash;
-  std::vector<Fr> _attribute_hashes;
-  _attribute_hashes.reserve(attributes.size());
-  for (size_t i = 0; i < attributes.size(); i++) {
-    if (std::get<1>(attributes[i])) {
-      _attribute_hash.setHashOf(std::get<0>(attributes[i]));
-      _attribute_hashes.push_back(_attribute_hash);
-      G2::mul(_yy_hash, m_pk.YYi[i], _attribute_hash);
-      G2::add(proof.k, proof.k, _yy_hash);
+  std::vector<const PSFixedBaseTable<G2>*> _k_bases;  // YYj of committed attributes and gg
+  _k_bases.reserve(hidden.size() + 1);
+  for (size_t i = 0; i < hidden.size(); i++) {
+    if (hidden[i]) {
+      _k_bases.push_back(&m_key.precomp().YYi[slots[i]]);
     }
   }
-  G2::mul(_yy_hash, m_pk.gg, _t);
-  G2::add(proof.k, proof.k, _yy_hash);
+  _k_bases.push_back(&m_key.precomp().gg);
+  token.secrets.reserve(hidden_hashes.size() + 2);  // room for t, and epsilon with id retrieval
+  token.secrets.assign(hidden_hashes.begin(), hidden_hashes.end());
+  token.secrets.push_back(_t);
+  if (hidden_sum) {
+    m_key.precomp().gg.mul(token.k, _t);
+    G2::add(token.k, token.k, *hidden_sum);
+  }
+  else {
+    PSFixedBaseTable<G2>::multi_mul(token.k, _k_bases, token.secrets);
+  }
+  G2::add(token.k, token.k, m_key.pk().XX);
 
   /** NIZK Prove:
    * Public Value: will be sent
    * * k = XX * PI{ YY_j^attribute_j } * gg^t
-   * * phi = hash(domain)^s
+   * * phi = hash(domain)^s, computed online by PSRequester::el_passo_prove_id()
    *
    * Public Random Value: will not be sent
    * * V_k = XX * PI{ YYj^random1_j } * gg^random_2
-   * * V_phi = hash(domain)^random1_s
-   *
-   * c: will be sent
-   * c = hash(k || phi || V_k || V_phi || associated_data )
+   * * V_phi = hash(domain)^random1_s, computed online by PSRequester::el_passo_prove_id()
    *
-   * Rs: will be sent
+   * Rs: will be sent, computed online by PSRequester::el_passo_prove_id()
    * * random1_j - attribute_j * c
    * * random2 - t * c
    */
   // V_k = XX * PI{ YYj^random1_j } * gg^random_2
-  G2 _V_k = m_pk.XX;
-  std::vector<Fr> _randomnesses;
   Fr _temp_randomness;
-  G2 _yy_randomness;
-  _randomnesses.reserve(attributes.size() + 1);
-  for (size_t i = 0; i < attributes.size(); i++) {
-    if (std::get<1>(attributes[i])) {
-      _temp_randomness.setByCSPRNG();
-      _randomnesses.push_back(_temp_randomness);
-      G2::mul(_yy_randomness, m_pk.YYi[i], _temp_randomness);
-      G2::add(_V_k, _V_k, _yy_randomness);
-    }
+  token.randomnesses.reserve(hidden.size() + 2);
+  for (size_t i = 0; i < _k_bases.size(); i++) {
+    _temp_randomness.setByCSPRNG();
+    token.randomnesses.push_back(_temp_randomness);  // random1_j, and random2 as the last one
   }
-  _temp_randomness.setByCSPRNG();
-  _randomnesses.push_back(_temp_randomness);  // random2
-  G2::mul(_yy_randomness, m_pk.gg, _temp_randomness);
-  G2::add(_V_k, _V_k, _yy_randomness);
+  PSFixedBaseTable<G2>::multi_mul(token.V_k, _k_bases, token.randomnesses);
+  G2::add(token.V_k, token.V_k, m_key.pk().XX);
+  return token;
+}
+
+void
+PSRequester::add_id_retrieval(PSPresentationToken& token, const Fr& gamma,
+                              const G1& authority_pk, const G1& g, const G1& h) const
+{
+  // El Gamal Cipher E = g^epsilon, y^epsilon * h^gamma
+  G1 _E1, _E2, _h_gamma;
+  Fr _epsilon;
+  _epsilon.setByCSPRNG();
+  G1::mul(_E1, g, _epsilon);
+  G1::mul(_E2, authority_pk, _epsilon);
+  G1::mul(_h_gamma, h, gamma);
+  G1::add(_E2, _E2, _h_gamma);
+
+  /** NIZK Prove, in addition to PSRequester::precompute_token():
+   * Public Value: will be sent
+   * * E1 = g^epsilon
+   * * E2 = y^epsilon * h^gamma
+   *
+   * Public Random Value: will not be sent
+   * * V_E1 = g^random_3
+   * * V_E2 = y^random_3 * h^random1_gamma
+   *
+   * Rs: will be sent
+   * * random3 - epsilon * c
+   */
+  // V_E1 = g^random_3
+  G1 _V_E1;
+  Fr _temp_randomness;
+  _temp_randomness.setByCSPRNG();  // random 3
+  G1::mul(_V_E1, g, _temp_randomness);
+
+  // V_E2 = y^random_3 * h^random1_gamma
+  G1 _V_E2;
+  G1 _h_random;
+  G1::mul(_V_E2, authority_pk, _temp_randomness);
+  G1::mul(_h_random, h, token.randomnesses[1]);  // random1_gamma
+  G1::add(_V_E2, _V_E2, _h_random);
+
+  token.secrets.push_back(_epsilon);
+  token.randomnesses.push_back(_temp_randomness);
+  token.E1 = _E1;
+  token.E2 = _E2;
+  token.V_E1 = _V_E1;
+  token.V_E2 = _V_E2;
+}
+
+IdProof  // sig1, sig2, k, phi, (E1, E2,) c, rs, attributes
+PSRequester::el_passo_prove_id(PSPresentationToken&& token,
+                               const std::string& associated_data,
+                               const std::string& service_name,
+                               PSProofVersion version) const
+{
+  // a token used already has no randomnesses left, a second proof from it would reveal the secrets
+  if (token.randomnesses.empty() || token.randomnesses.size() != token.secrets.size()) {
+    throw std::runtime_error("presentation token used already");
+  }
+  IdProof proof;
+  proof.sig1 = token.sig.sig1;
+  proof.sig2 = token.sig.sig2;
+  proof.k = token.k;
+
+  // phi = hash(service_name)^s
+  G1 _service_hash;
+  hashAndMapToG1(_service_hash, service_name);
+  G1::mul(proof.phi, _service_hash, token.s);
 
   // V_phi = hash(domain)^random1_s
   G1 _V_phi;
-  G1::mul(_V_phi, _service_hash, _randomnesses[0]);  // random1_s
-
-  // Calculate c = hash(k || phi || V_k || V_phi || associated_data )
-  cybozu::Sha256 digest_engine;
-  digest_engine.update(proof.k.serializeToHexStr());
-  digest_engine.update(proof.phi.serializeToHexStr());
-  digest_engine.update(_V_k.serializeToHexStr());
-  digest_engine.update(_V_phi.serializeToHexStr());
-  auto _c_str = digest_engine.digest(associated_data);
-  proof.c.setHashOf(_c_str);
-  // std::cout << "parepare: V k: " << _V_k.serializeToHexStr() << std::endl;
+  G1::mul(_V_phi, _service_hash, token.randomnesses[0]);  // random1_s
+
+  // Calculate c = hash(k || phi || E1 || E2 || V_k || V_phi || V_E1 || V_E2 || associated_data )
+  // or c = hash(k || phi || V_k || V_phi || associated_data ) without id retrieval
+  bool _with_id_retrieval = token.E1.has_value() && token.E2.has_value();
+  proof.version = version;
+  PSTranscript transcript(proof.version, PS_TRANSCRIPT_PROVE_ID);
+  transcript.append(proof.k);
+  transcript.append(proof.phi);
+  if (_with_id_retrieval) {
+    transcript.append(token.E1.value());
+    transcript.append(token.E2.value());
+  }
+  transcript.append(token.V_k);
+  transcript.append(_V_phi);
+  if (_with_id_retrieval) {
+    transcript.append(token.V_E1.value());
+    transcript.append(token.V_E2.value());
+  }
+  transcript.challenge(proof.c, associated_data);
+  // std::cout << "parepare: V k: " << token.V_k.serializeToHexStr() << std::endl;
   // std::cout << "parepare: V phi: " << _V_phi.serializeToHexStr() << std::endl;
 
   // Calculate Rs
+  // random1_j - attribute_j * c, random2 - t * c, and random3 - epsilon * c with id retrieval
   Fr _temp_r;
   Fr _secret_c;
-  proof.rs.reserve(attributes.size() + 1);
-  for (size_t i = 0; i < _attribute_hashes.size(); i++) {
-    Fr::mul(_secret_c, _attribute_hashes[i], proof.c);
-    Fr::sub(_temp_r, _randomnesses[i], _secret_c);
+  proof.rs.reserve(token.secrets.size());
+  for (size_t i = 0; i < token.secrets.size(); i++) {
+    Fr::mul(_secret_c, token.secrets[i], proof.c);
+    Fr::sub(_temp_r, token.randomnesses[i], _secret_c);
     proof.rs.push_back(_temp_r);
   }
-  Fr::mul(_secret_c, _t, proof.c);
-  Fr::sub(_temp_r, _randomnesses[_randomnesses.size() - 1], _secret_c);
-  proof.rs.push_back(_temp_r);
-
-  // plaintext attributes
-  proof.attributes.reserve(attributes.size());
-  for (size_t i = 0; i < attributes.size(); i++) {
-    if (std::get<1>(attributes[i])) {
-      proof.attributes.push_back("");
-    }
-    else {
-      proof.attributes.push_back(std::get<0>(attributes[i]));
-    }
+  for (size_t i = 0; i < token.secrets.size(); i++) {
+    token.secrets[i].clear();
+    token.randomnesses[i].clear();
+  }
+  token.secrets.clear();
+  token.randomnesses.clear();
+  token.s.clear();
+
+  // sig1, sig2, k, phi, (E1, E2,) c, rs, attributes
+  proof.attributes = token.attributes;
+  proof.used_slots = token.used_slots;
+  if (_with_id_retrieval) {
+    proof.E1 = token.E1;
+    proof.E2 = token.E2;
   }
-  // sig1, sig2, k, phi, c, rs, attributes
   return proof;
-}
\ No newline at end of file
+}
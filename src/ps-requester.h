@@ -2,9 +2,132 @@
 #define PS_SRC_PS_REQUESTER_H_
 
 #include "ps-encoding.h"
+#include "ps-pairing.h"
+#include "ps-precomp.h"
+#include "ps-pubkey-handle.h"
 
 using namespace mcl::bls12;
 
+/**
+ * @brief State of one credential issuance between PSRequester::el_passo_request_id()
+ *        and PSRequester::unblind_credential().
+ *
+ * Each issuance keeps its own session, so one PSRequester can have many issuance requests
+ * in flight and can be shared across threads.
+ */
+class PSIssuanceSession {
+public:
+  /**
+   * @brief The request to be sent to the PSSigner.
+   */
+  PSCredRequest request;
+  /**
+   * @brief The blinding factor used to commit the hidden attributes. Must be kept secret.
+   */
+  Fr t;
+};
+
+/**
+ * @brief The offline part of an EL PASSO ProveID, produced by
+ *        PSRequester::el_passo_precompute_prove_id() or
+ *        PSRequester::el_passo_precompute_prove_id_without_id_retrieval().
+ *
+ * A token holds everything of a proof that depends neither on the RP's service name nor on the
+ * associated data, so it can be computed ahead of time and finished with
+ * PSRequester::el_passo_prove_id() once the login request comes in.
+ *
+ * A token contains secrets and must be used for exactly one proof: two proofs from the same
+ * token reveal the committed attributes. So a token can be moved but not copied, and
+ * PSRequester::el_passo_prove_id() takes it by rvalue reference, clears its secrets, and throws
+ * if it is given a token used already.
+ */
+class PSPresentationToken {
+public:
+  PSPresentationToken() = default;
+  PSPresentationToken(PSPresentationToken&&) = default;
+  PSPresentationToken&
+  operator=(PSPresentationToken&&) = default;
+  PSPresentationToken(const PSPresentationToken&) = delete;
+  PSPresentationToken&
+  operator=(const PSPresentationToken&) = delete;
+
+  /**
+   * @brief The randomized PS signature.
+   */
+  PSCredential sig;
+  /**
+   * @brief k = XX * PI{ YY_j^attribute_j } * gg^t
+   */
+  G2 k;
+  /**
+   * @brief V_k = XX * PI{ YY_j^random1_j } * gg^random2
+   */
+  G2 V_k;
+  /**
+   * @brief The hash of the first attribute, used to derive phi.
+   */
+  Fr s;
+  /**
+   * @brief The committed attribute hashes, t, and epsilon when id retrieval is enabled.
+   */
+  std::vector<Fr> secrets;
+  /**
+   * @brief The Schnorr randomness of each element in secrets, in the same order.
+   */
+  std::vector<Fr> randomnesses;
+  /**
+   * @brief A list of plaintext attributes. Empty strings are placeholders for committed attributes.
+   */
+  std::vector<std::string> attributes;
+  /**
+   * @brief The key slots used by a sparse credential, empty if every slot is used.
+   */
+  std::vector<bool> used_slots;
+  /**
+   * @brief El Gamal ciphertext and its commitments, set only when id retrieval is enabled.
+   */
+  std::optional<G1> E1;
+  std::optional<G1> E2;
+  std::optional<G1> V_E1;
+  std::optional<G1> V_E2;
+};
+
+/**
+ * @brief An unblinded credential kept by the user together with everything about its attributes
+ *        that does not change between logins. Produced by PSRequester::store_credential().
+ *
+ * Proving with a stored credential skips hashing the attributes, and derives k from the cached
+ * YY_i^m_i with G2 additions instead of a multi-scalar multiplication. Verifying it again costs
+ * the pairing check only.
+ */
+class PSStoredCredential {
+public:
+  /**
+   * @brief The unblinded PS signature.
+   */
+  PSCredential sig;
+  /**
+   * @brief All attributes in plaintext, in the same order as when the signature was requested.
+   */
+  std::vector<std::string> attributes;
+  /**
+   * @brief The key slots used by a sparse credential, empty if every slot is used.
+   */
+  std::vector<bool> used_slots;
+  /**
+   * @brief m_i = hash(attributes[i]).
+   */
+  std::vector<Fr> attribute_hashes;
+  /**
+   * @brief YY_i^m_i for the slot i of each attribute, its contribution to k and to the signed message.
+   */
+  std::vector<G2> attribute_terms;
+  /**
+   * @brief XX * PI{ YY_i^m_i }, the message the signature is checked against.
+   */
+  G2 signed_message;
+};
+
 /**
  * The requester who wants to get a PS credential from the signer.
  */
@@ -13,10 +136,17 @@ public:
   /**
    * @brief Construct a new PSRequester object
    *
-   * @param pk input The public key of the PSSigner.
+   * @param pk input The public key of the PSSigner. Throws std::runtime_error if PSPubKey::validate() fails.
    */
   PSRequester(const PSPubKey& pk);
 
+  /**
+   * @brief Construct a new PSRequester object sharing an already validated key and its precomputation.
+   *
+   * @param key input The public key of the PSSigner. Throws std::runtime_error if the handle is empty.
+   */
+  PSRequester(const PSPubKeyHandle& key);
+
   size_t
   maxAllowedAttrNum() const;
 
@@ -28,39 +158,84 @@ public:
    *   - std::string, the value of the attribute.
    *   - bool, true if the attribute should be committed.
    * @p associated_data, input, used for NIZK Schnorr verification.
-   * @return PSCredRequest containing
-   *   - G1, A, committed attributes
-   *   - Fr, c, used for NIZK Schnorr verification.
-   *   - std::vector<Fr>, rs, used for NIZK Schnorr verification.
-   *   - std::vector<std::string>, attributes, attributes that only contain plaintext attributes
-   *     and "" for committed attributes. The order of attributes is the same as @p attributes.
+   * @return PSIssuanceSession containing
+   *   - PSCredRequest, request, to be sent to the PSSigner, containing
+   *     - G1, A, committed attributes
+   *     - Fr, c, used for NIZK Schnorr verification.
+   *     - std::vector<Fr>, rs, used for NIZK Schnorr verification.
+   *     - std::vector<std::string>, attributes, attributes that only contain plaintext attributes
+   *       and "" for committed attributes. The order of attributes is the same as @p attributes.
+   *   - Fr, t, the blinding factor, to be passed to unblind_credential().
    */
-  PSCredRequest
+  PSIssuanceSession
   el_passo_request_id(const std::vector<std::tuple<std::string, bool>> attributes,  // string is the attribute, bool whether to hide
-                      const std::string& associated_data);
+                      const std::string& associated_data) const;
+
+  /**
+   * @brief Request a sparse credential, which uses only some slots of the key.
+   *
+   * @p attributes, input, the attributes of the used slots only, in slot order.
+   * @p used_slots, input, one bit per slot of the key, see ps_slot_indexes(). Unused slots add
+   *    no scalar multiplication to issuance, proofs, or verification.
+   * @p associated_data, input, the same as above.
+   * Throws std::runtime_error if @p used_slots and @p attributes do not match the key.
+   */
+  PSIssuanceSession
+  el_passo_request_id(const std::vector<std::tuple<std::string, bool>> attributes,
+                      const std::vector<bool>& used_slots,
+                      const std::string& associated_data) const;
 
   /**
    * Unblind the signature after the PSSigner signs requester's attribtues.
    *
    * @p sig, the PS signature (certificate) returned by the PSSigner.
+   * @p session, the issuance session returned by el_passo_request_id() for this signature.
    * @return PSCredential containing
    *   - G1, unblinded PS signature, part one.
    *   - G1, unblinded PS signature, part two.
    */
   PSCredential
-  unblind_credential(const PSCredential& sig) const;
+  unblind_credential(const PSCredential& sig, const PSIssuanceSession& session) const;
 
   /**
    * Verify the signature over the given attributes (all in plaintext).
    *
    * @p sig, the PS signature.
    * @p all_attributes, the attributes in the same order as when the PS signature is requested.
-   *                    All in plaintext.
-   * @return true if the signature is valid.
+   *                    All in plaintext, one per key slot.
+   * @return true if the signature is valid, false also if @p all_attributes does not match the key.
+   *         A sparse credential is verified with store_credential() instead.
    */
   bool
   verify(const PSCredential& sig, const std::vector<std::string>& all_attributes) const;
 
+  /**
+   * Verify a stored credential with its cached message, which costs the pairing check only.
+   */
+  bool
+  verify(const PSStoredCredential& credential) const;
+
+  /**
+   * Hash the attributes of an unblinded signature once and keep the results for later logins.
+   * Throws std::runtime_error if the signature does not verify over @p all_attributes.
+   *
+   * @p sig, the unblinded PS signature returned by unblind_credential().
+   * @p all_attributes, the attributes in the same order as when the PS signature is requested.
+   *                    All in plaintext.
+   * @return PSStoredCredential, to be passed to the ProveID functions instead of @p sig.
+   */
+  PSStoredCredential
+  store_credential(const PSCredential& sig, const std::vector<std::string>& all_attributes) const;
+
+  /**
+   * Store a sparse credential, with the attributes of the used slots only and the same
+   * @p used_slots as in el_passo_request_id(). Sparse credentials are proven through
+   * the ProveID functions taking a PSStoredCredential.
+   */
+  PSStoredCredential
+  store_credential(const PSCredential& sig, const std::vector<std::string>& all_attributes,
+                   const std::vector<bool>& used_slots) const;
+
   /**
    * Randomize a signature.
    *
@@ -116,15 +291,98 @@ public:
                                          const std::string& associated_data,
                                          const std::string& service_name) const;
 
+  /**
+   * EL PASSO ProveID, offline part.
+   * Randomize the signature, encrypt the identity retrieval token, and commit to all Schnorr
+   * randomnesses. None of these depends on the RP, so the token can be prepared before login.
+   *
+   * @p sig, @p attributes, @p authority_pk, @p g, @p h, the same as el_passo_prove_id().
+   * @return PSPresentationToken, to be passed to el_passo_prove_id() exactly once.
+   */
+  PSPresentationToken
+  el_passo_precompute_prove_id(const PSCredential& sig,
+                               const std::vector<std::tuple<std::string, bool>> attributes,
+                               const G1& authority_pk, const G1& g, const G1& h) const;
+
+  PSPresentationToken
+  el_passo_precompute_prove_id_without_id_retrieval(const PSCredential& sig,
+                                                    const std::vector<std::tuple<std::string, bool>> attributes) const;
+
+  /**
+   * EL PASSO ProveID with a stored credential, which reuses its attribute hashes and YY_i^m_i.
+   *
+   * Throws std::runtime_error unless the first attribute, s, is committed, and with id retrieval
+   * the second one, gamma, too.
+   *
+   * @p credential, input, a credential from store_credential().
+   * @p hidden, input, true for each attribute of @p credential that should be committed.
+   * Other parameters and the result are the same as el_passo_prove_id().
+   */
+  IdProof
+  el_passo_prove_id(const PSStoredCredential& credential,
+                    const std::vector<bool>& hidden,
+                    const std::string& associated_data,
+                    const std::string& service_name,
+                    const G1& authority_pk, const G1& g, const G1& h) const;
+
+  IdProof
+  el_passo_prove_id_without_id_retrieval(const PSStoredCredential& credential,
+                                         const std::vector<bool>& hidden,
+                                         const std::string& associated_data,
+                                         const std::string& service_name) const;
+
+  PSPresentationToken
+  el_passo_precompute_prove_id(const PSStoredCredential& credential,
+                               const std::vector<bool>& hidden,
+                               const G1& authority_pk, const G1& g, const G1& h) const;
+
+  PSPresentationToken
+  el_passo_precompute_prove_id_without_id_retrieval(const PSStoredCredential& credential,
+                                                    const std::vector<bool>& hidden) const;
+
+  /**
+   * EL PASSO ProveID, online part.
+   * Derive phi for @p service_name and bind the proof to @p associated_data.
+   * Costs two G1 exponentiations and one hash.
+   *
+   * Throws std::runtime_error if @p token has been used already.
+   *
+   * @p token, input, a token from el_passo_precompute_prove_id() or
+   *        el_passo_precompute_prove_id_without_id_retrieval(). Its secrets are cleared, so it
+   *        cannot be used for a second proof.
+   * @p associated_data, input, the same as el_passo_prove_id().
+   * @p service_name, input, the same as el_passo_prove_id().
+   * @p version, input, the proof format. Use PSProofVersion::HexTranscript only for RPs that
+   *    have not been updated yet.
+   * @return IdProof, the same as el_passo_prove_id(). E1 and E2 are set if the token has them.
+   */
+  IdProof
+  el_passo_prove_id(PSPresentationToken&& token,
+                    const std::string& associated_data,
+                    const std::string& service_name,
+                    PSProofVersion version = PSProofVersion::Current) const;
+
 private:
   G2
   prepare_hybrid_verification(const G2& k, const std::vector<std::string>& attributes) const;
 
+  // randomize @p sig and commit to @p hidden_hashes, the hashes of the committed attributes in order;
+  // @p slots maps attributes to key slots, and @p hidden_sum is PI{ YY_j^m_j } over the committed
+  // attributes if known, or null to compute it
+  PSPresentationToken
+  precompute_token(const PSCredential& sig, const Fr& s, const std::vector<bool>& hidden,
+                   const std::vector<size_t>& slots, const std::vector<Fr>& hidden_hashes,
+                   const G2* hidden_sum) const;
+
+  // add the identity retrieval token E1, E2 for @p gamma and its commitments to @p token
+  void
+  add_id_retrieval(PSPresentationToken& token, const Fr& gamma,
+                   const G1& authority_pk, const G1& g, const G1& h) const;
+
 private:
-  PSPubKey m_pk;  // public key
-  Fr m_sk_x;      // private key, x
-  G1 m_sk_X;      // private key, X
-  Fr m_t1;        // used for commiting attributes
+  PSPubKeyHandle m_key;  // public key and its precomputation, shared
+  Fr m_sk_x;             // private key, x
+  G1 m_sk_X;             // private key, X
 };
 
 #endif  // PS_SRC_PS_REQUESTER_H_
\ No newline at end of file
@@ -0,0 +1,162 @@
+#include "ps-result-cache.h"
+
+#include <cybozu/sha2.hpp>
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+using namespace mcl::bls12;
+
+static const char PS_RESULT_CACHE_LABEL[] = "el-passo/result-cache";
+
+// an unordered_map node holds a next pointer, the value and the cached hash, a list node two
+// pointers and the value, and malloc adds a header to each node
+static const size_t ALLOCATION_OVERHEAD = 2 * sizeof(void*);
+const size_t PSResultCache::ENTRY_SIZE = sizeof(void*) + sizeof(std::pair<const Digest, Entry>) + sizeof(size_t)
+                                         + sizeof(void*)  // bucket, at a load factor of 1
+                                         + 2 * sizeof(void*) + sizeof(const Digest*)
+                                         + 2 * ALLOCATION_OVERHEAD;
+
+PSResultCache::PSResultCache(size_t capacity, std::chrono::milliseconds ttl, size_t shard_num)
+    : m_shards(new Shard[std::max<size_t>(shard_num, 1)])
+    , m_shard_num(std::max<size_t>(shard_num, 1))
+    , m_shard_capacity(std::max<size_t>((capacity + m_shard_num - 1) / m_shard_num, 1))
+    , m_ttl(ttl)
+{
+}
+
+// absorbs the length first, so that no two sequences of fields are hashed alike
+static void
+update_field(cybozu::Sha256& engine, const void* data, size_t size)
+{
+  uint8_t _size[8];
+  for (int i = 0; i < 8; i++) {
+    _size[i] = static_cast<uint8_t>(static_cast<uint64_t>(size) >> (56 - 8 * i));
+  }
+  engine.update(_size, sizeof(_size));
+  engine.update(data, size);
+}
+
+static void
+update_point(cybozu::Sha256& engine, const G1& point)
+{
+  uint8_t _buf[128];
+  size_t _size = point.serialize(_buf, sizeof(_buf));
+  if (_size == 0) {
+    throw std::runtime_error("element serialization failed");
+  }
+  update_field(engine, _buf, _size);
+}
+
+PSResultCache::Digest
+PSResultCache::digest(const uint8_t* data, size_t size,
+                      const std::string& associated_data,
+                      const std::string& service_name,
+                      const G1* authority_pk, const G1* g, const G1* h)
+{
+  cybozu::Sha256 _engine;
+  _engine.update(PS_RESULT_CACHE_LABEL, sizeof(PS_RESULT_CACHE_LABEL) - 1);
+  update_field(_engine, service_name.data(), service_name.size());
+  update_field(_engine, associated_data.data(), associated_data.size());
+  uint8_t _with_id_retrieval = authority_pk != nullptr;
+  _engine.update(&_with_id_retrieval, 1);
+  if (authority_pk != nullptr) {
+    update_point(_engine, *authority_pk);
+    update_point(_engine, *g);
+    update_point(_engine, *h);
+  }
+  Digest _digest;
+  _engine.digest(_digest.data(), _digest.size(), data, size);
+  return _digest;
+}
+
+bool
+PSResultCache::lookup(const Digest& digest, bool& valid)
+{
+  auto& _shard = shard_of(digest);
+  std::unique_lock<std::mutex> lock(_shard.mutex);
+  auto _entry = _shard.entries.find(digest);
+  if (_entry != _shard.entries.end() && _entry->second.expiry <= Clock::now()) {
+    erase(_shard, _entry);
+    _entry = _shard.entries.end();
+  }
+  if (_entry == _shard.entries.end()) {
+    lock.unlock();
+    m_misses++;
+    return false;
+  }
+  _shard.lru.splice(_shard.lru.begin(), _shard.lru, _entry->second.position);
+  valid = _entry->second.valid;
+  lock.unlock();
+  m_hits++;
+  return true;
+}
+
+void
+PSResultCache::insert(const Digest& digest, bool valid)
+{
+  auto& _shard = shard_of(digest);
+  auto _now = Clock::now();
+  std::lock_guard<std::mutex> lock(_shard.mutex);
+  auto _entry = _shard.entries.find(digest);
+  if (_entry != _shard.entries.end() && _entry->second.expiry > _now) {
+    // the expiry is kept, so that a verdict never outlives the first verification
+    _entry->second.valid = _entry->second.valid || valid;
+    _shard.lru.splice(_shard.lru.begin(), _shard.lru, _entry->second.position);
+    return;
+  }
+  if (_entry != _shard.entries.end()) {
+    erase(_shard, _entry);
+  }
+  if (_shard.entries.size() >= m_shard_capacity) {
+    erase(_shard, _shard.entries.find(*_shard.lru.back()));
+  }
+  _entry = _shard.entries.emplace(digest, Entry{_now + m_ttl, {}, valid}).first;
+  _shard.lru.push_front(&_entry->first);
+  _entry->second.position = _shard.lru.begin();
+}
+
+PSResultCacheStats
+PSResultCache::stats() const
+{
+  PSResultCacheStats _stats;
+  _stats.hits = m_hits;
+  _stats.misses = m_misses;
+  _stats.capacity = m_shard_capacity * m_shard_num;
+  for (size_t i = 0; i < m_shard_num; i++) {
+    std::lock_guard<std::mutex> lock(m_shards[i].mutex);
+    _stats.size += m_shards[i].entries.size();
+  }
+  return _stats;
+}
+
+std::chrono::milliseconds
+PSResultCache::ttl() const
+{
+  return m_ttl;
+}
+
+size_t
+PSResultCache::DigestHash::operator()(const Digest& digest) const
+{
+  size_t _hash;
+  std::memcpy(&_hash, digest.data(), sizeof(_hash));
+  return _hash;
+}
+
+PSResultCache::Shard&
+PSResultCache::shard_of(const Digest& digest) const
+{
+  // other bytes than the bucket, so that the keys of a shard still spread over its buckets
+  uint64_t _hash;
+  std::memcpy(&_hash, digest.data() + 8, sizeof(_hash));
+  return m_shards[_hash % m_shard_num];
+}
+
+void
+PSResultCache::erase(Shard& shard, std::unordered_map<Digest, Entry, DigestHash>::iterator entry)
+{
+  shard.lru.erase(entry->second.position);
+  shard.entries.erase(entry);
+}
@@ -0,0 +1,137 @@
+#ifndef PS_SRC_PS_RESULT_CACHE_H_
+#define PS_SRC_PS_RESULT_CACHE_H_
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include "ps-encoding.h"
+
+using namespace mcl::bls12;
+
+/**
+ * @brief The counters of a PSResultCache.
+ */
+struct PSResultCacheStats {
+  uint64_t hits = 0;    // lookups answered with a previous verdict
+  uint64_t misses = 0;  // lookups that had to verify the proof
+  size_t size = 0;      // verdicts held, including those expired but not purged yet
+  size_t capacity = 0;  // maximum number of verdicts held
+};
+
+/**
+ * @brief The verdicts of the last verified encoded proofs, so that a byte-identical retry is
+ *        answered without verifying the proof again.
+ *
+ * A verdict is keyed by a SHA-256 digest of the encoded proof, its associated data, the service
+ * name, and the id retrieval parameters, see digest(). A verdict is held for a time to live at
+ * most, and the least recently used verdict is evicted first once the cache is full. Every entry
+ * has the same size, so the memory of the cache is bounded by its capacity, about ENTRY_SIZE
+ * bytes per verdict. The verdicts are spread over shards, each with its own lock and its own
+ * share of the capacity. All functions are thread-safe.
+ */
+class PSResultCache {
+public:
+  static const size_t DIGEST_SIZE = 32;
+  using Digest = std::array<uint8_t, DIGEST_SIZE>;
+
+  /**
+   * @brief Create an empty cache.
+   *
+   * @param capacity input The maximum number of verdicts held, at least one per shard.
+   * @param ttl input How long a verdict is held. With a replay cache, it must not exceed the
+   *        time to live of the replay cache, see PSVerifier::set_result_cache().
+   * @param shard_num input The number of independently locked shards.
+   */
+  PSResultCache(size_t capacity, std::chrono::milliseconds ttl, size_t shard_num = 16);
+
+  PSResultCache(const PSResultCache&) = delete;
+  PSResultCache&
+  operator=(const PSResultCache&) = delete;
+
+  /**
+   * @brief The key of a verification of @p size bytes of encoded proof at @p data.
+   *
+   * @param authority_pk, g, h input The parameters of PSVerifier::el_passo_verify_id(), or nullptr
+   *        for el_passo_verify_id_without_id_retrieval().
+   */
+  static Digest
+  digest(const uint8_t* data, size_t size,
+         const std::string& associated_data,
+         const std::string& service_name,
+         const G1* authority_pk, const G1* g, const G1* h);
+
+  /**
+   * @brief Look up the verdict for @p digest and count a hit or a miss.
+   *
+   * @return bool True with the verdict in @p valid if the proof has been verified within the time to live.
+   */
+  bool
+  lookup(const Digest& digest, bool& valid);
+
+  /**
+   * @brief Remember the verdict for @p digest for the time to live, evicting the least recently
+   *        used verdict of the shard if it is full.
+   *
+   * If the digest is already held, the proof is valid if either verdict is, as the same proof
+   * verified twice at once may be accepted by one call and rejected as a replay by the other.
+   */
+  void
+  insert(const Digest& digest, bool valid);
+
+  PSResultCacheStats
+  stats() const;
+
+  std::chrono::milliseconds
+  ttl() const;
+
+private:
+  using Clock = std::chrono::steady_clock;
+
+  // the digest is a hash already, its first bytes pick the bucket
+  struct DigestHash {
+    size_t
+    operator()(const Digest& digest) const;
+  };
+
+  struct Entry {
+    Clock::time_point expiry;
+    std::list<const Digest*>::iterator position;  // in the LRU list of the shard
+    bool valid;
+  };
+
+  struct Shard {
+    mutable std::mutex mutex;
+    std::unordered_map<Digest, Entry, DigestHash> entries;
+    std::list<const Digest*> lru;  // keys of entries, most recently used first
+  };
+
+  Shard&
+  shard_of(const Digest& digest) const;
+
+  // @p entry must be in @p shard, whose lock is held
+  static void
+  erase(Shard& shard, std::unordered_map<Digest, Entry, DigestHash>::iterator entry);
+
+public:
+  /**
+   * @brief The memory per verdict: a hash map node holding the digest once, its bucket, an LRU
+   *        list node, and the allocator overhead of the two nodes.
+   */
+  static const size_t ENTRY_SIZE;
+
+private:
+  std::unique_ptr<Shard[]> m_shards;
+  size_t m_shard_num;
+  size_t m_shard_capacity;
+  std::chrono::milliseconds m_ttl;
+  std::atomic<uint64_t> m_hits{0};
+  std::atomic<uint64_t> m_misses{0};
+};
+
+#endif  // PS_SRC_PS_RESULT_CACHE_H_
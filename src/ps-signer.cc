@@ -1,7 +1,11 @@
 #include "ps-signer.h"
 
 #include <chrono>
-#include <cybozu/sha2.hpp>
+#include <stdexcept>
+
+#include "ps-pairing.h"
+#include "ps-parallel.h"
+#include "ps-transcript.h"
 
 using namespace mcl::bls12;
 
@@ -26,6 +30,18 @@ PSSigner::PSSigner(size_t attribute_num, const G1& g, const G2& gg)
   m_pk.YYi.reserve(m_attribute_num);
 }
 
+PSSigner::PSSigner(const PSSecretKey& sk)
+    : m_attribute_num(sk.pk.Yi.size())
+    , m_sk_X(sk.X)
+    , m_pk(sk.pk)
+    , m_key(sk.pk)
+{
+  // e(X, gg) == e(g, XX), both hold x
+  if (m_sk_X.isZero() || !m_sk_X.isValid() || !ps_pairing_equal(m_sk_X, m_pk.gg, m_pk.g, m_pk.XX)) {
+    throw std::runtime_error("secret key does not match public key");
+  }
+}
+
 PSPubKey  // g, gg, XX, Yi, YYi
 PSSigner::key_gen()
 {
@@ -40,7 +56,11 @@ PSSigner::key_gen()
   // public key: XX
   G2::mul(m_pk.XX, m_pk.gg, _sk_x);
 
-  // public key: Y and YY for each attribute
+  // public key: Y and YY for each attribute, replacing those of a previous key
+  m_pk.Yi.clear();
+  m_pk.YYi.clear();
+  m_pk.Yi.reserve(m_attribute_num);
+  m_pk.YYi.reserve(m_attribute_num);
   Fr y_item;
   G1 Y_item;
   G2 YY_item;
@@ -51,6 +71,7 @@ PSSigner::key_gen()
     G2::mul(YY_item, m_pk.gg, y_item);
     m_pk.YYi.push_back(YY_item);
   }
+  m_key = PSPubKeyHandle(m_pk);
   return m_pk;
 }
 
@@ -60,6 +81,21 @@ PSSigner::get_pub_key() const
   return m_pk;
 }
 
+PSSecretKey
+PSSigner::get_secret_key() const
+{
+  PSSecretKey _sk;
+  _sk.X = m_sk_X;
+  _sk.pk = m_pk;
+  return _sk;
+}
+
+PSPubKeyHandle
+PSSigner::get_pub_key_handle() const
+{
+  return m_key;
+}
+
 bool
 PSSigner::el_passo_provide_id(const PSCredRequest& request,
                               const std::string& associated_data, PSCredential& sig) const
@@ -67,10 +103,60 @@ PSSigner::el_passo_provide_id(const PSCredRequest& request,
   if (!el_passo_nizk_verify_request(request, associated_data)) {
     return false;
   }
-  sig = sign_hybrid(request.A, request.attributes);
+  sig = sign_hybrid(request.A, request.attributes, request.used_slots);
   return true;
 }
 
+std::vector<bool>
+PSSigner::provide_id_batch(const std::vector<PSCredRequest>& requests,
+                           const std::vector<std::string>& associated_data,
+                           std::vector<PSCredential>& sigs, size_t thread_num) const
+{
+  if (associated_data.size() != requests.size()) {
+    throw std::runtime_error("associated data size does not match");
+  }
+  sigs.resize(requests.size());
+  std::vector<char> _accepted(requests.size(), 0);  // not vector<bool>, each worker writes its own slot
+  ps_parallel_for(requests.size(), thread_num, [&](size_t i) {
+    _accepted[i] = el_passo_nizk_verify_request(requests[i], associated_data[i]);
+  });
+  auto _shared_terms = shared_attribute_terms(requests, _accepted);
+  ps_parallel_for(requests.size(), thread_num, [&](size_t i) {
+    if (_accepted[i]) {
+      sigs[i] = sign_hybrid(requests[i].A, requests[i].attributes, requests[i].used_slots, &_shared_terms);
+    }
+  });
+  return std::vector<bool>(_accepted.begin(), _accepted.end());
+}
+
+PSSigner::AttributeTerms
+PSSigner::shared_attribute_terms(const std::vector<PSCredRequest>& requests, const std::vector<char>& accepted) const
+{
+  std::map<std::pair<size_t, std::string>, size_t> _counts;
+  std::vector<size_t> _slots;
+  for (size_t i = 0; i < requests.size(); i++) {
+    if (!accepted[i]) {
+      continue;
+    }
+    ps_slot_indexes(requests[i].used_slots, requests[i].attributes.size(), m_attribute_num, _slots);
+    for (size_t j = 0; j < requests[i].attributes.size(); j++) {
+      if (requests[i].attributes[j] != "") {
+        _counts[std::make_pair(_slots[j], requests[i].attributes[j])]++;
+      }
+    }
+  }
+  AttributeTerms _terms;
+  Fr _hash;
+  for (const auto& count : _counts) {
+    if (count.second < 2) {
+      continue;
+    }
+    _hash.setHashOf(count.first.second);
+    m_key.precomp().Yi[count.first.first].mul(_terms[count.first], _hash);
+  }
+  return _terms;
+}
+
 bool
 PSSigner::el_passo_nizk_verify_request(const PSCredRequest& request,
                                        const std::string& associated_data) const
@@ -78,27 +164,45 @@ PSSigner::el_passo_nizk_verify_request(const PSCredRequest& request,
   // NIZK proof
   // V: A^c * g^r0 * Yi^ri
   // true if hash( A || V || associated_data ) = c
+  // the shape of the request: one response for t and one per committed attribute
+  std::vector<size_t> _slots;
+  if (!ps_slot_indexes(request.used_slots, request.attributes.size(), m_attribute_num, _slots)) {
+    return false;
+  }
+  size_t _hidden_num = 0;
+  for (const auto& attribute : request.attributes) {
+    if (attribute.empty()) {
+      _hidden_num++;
+    }
+  }
+  if (request.rs.size() != _hidden_num + 1) {
+    return false;
+  }
   // prepare V
-  G1 _V;
-  G1::mul(_V, request.A, request.c);
-  G1 _temp;
-  G1::mul(_temp, m_pk.g, request.rs[0]);
-  G1::add(_V, _V, _temp);
+  std::vector<const PSFixedBaseTable<G1>*> _bases;
+  std::vector<Fr> _scalars;
+  _bases.reserve(request.rs.size());
+  _scalars.reserve(request.rs.size());
+  _bases.push_back(&m_key.precomp().g);
+  _scalars.push_back(request.rs[0]);
   int j = 1;
   for (size_t i = 0; i < request.attributes.size(); i++) {
     if (request.attributes[i] == "") {
-      G1::mul(_temp, m_pk.Yi[i], request.rs[j]);
+      _bases.push_back(&m_key.precomp().Yi[_slots[i]]);
+      _scalars.push_back(request.rs[j]);
       j++;
-      G1::add(_V, _V, _temp);
     }
   }
+  G1 _V, _temp;
+  PSFixedBaseTable<G1>::multi_mul(_V, _bases, _scalars);
+  G1::mul(_temp, request.A, request.c);
+  G1::add(_V, _V, _temp);
   // prepare c
   Fr _m_c;
-  cybozu::Sha256 digest_engine;
-  digest_engine.update(request.A.serializeToHexStr());
-  digest_engine.update(_V.serializeToHexStr());
-  auto _c_str = digest_engine.digest(associated_data);
-  _m_c.setHashOf(_c_str);
+  PSTranscript transcript(request.version, PS_TRANSCRIPT_REQUEST_ID);
+  transcript.append(request.A);
+  transcript.append(_V);
+  transcript.challenge(_m_c, associated_data);
   // std::cout << "sign: A: " << request.A.serializeToHexStr() << std::endl;
   // std::cout << "sign: V: " << _V.serializeToHexStr() << std::endl;
   // std::cout << "sign: c: " << _m_c.serializeToHexStr() << std::endl;
@@ -110,21 +214,46 @@ PSSigner::el_passo_nizk_verify_request(const PSCredRequest& request,
 }
 
 PSCredential
-PSSigner::sign_hybrid(const G1& commitment, const std::vector<std::string>& attributes) const
+PSSigner::sign_hybrid(const G1& commitment, const std::vector<std::string>& attributes,
+                      const std::vector<bool>& used_slots) const
 {
-  if (attributes.size() == 1) {
-    return this->sign_commitment(commitment);
+  return sign_hybrid(commitment, attributes, used_slots, nullptr);
+}
+
+PSCredential
+PSSigner::sign_hybrid(const G1& commitment, const std::vector<std::string>& attributes,
+                      const std::vector<bool>& used_slots, const AttributeTerms* shared_terms) const
+{
+  // unused slots are signed as m_i = 0 and contribute nothing
+  std::vector<size_t> _slots;
+  if (!ps_slot_indexes(used_slots, attributes.size(), m_attribute_num, _slots)) {
+    throw std::runtime_error("attribute size does not match");
   }
-  G1 _final_A = commitment;
-  G1 _temp_yi_hash;
+  std::vector<const PSFixedBaseTable<G1>*> _bases;
+  std::vector<Fr> _hashes;
+  _bases.reserve(attributes.size());
+  _hashes.reserve(attributes.size());
   Fr _temp_hash;
+  G1 _final_A = commitment;
   for (size_t i = 0; i < attributes.size(); i++) {
     if (attributes[i] == "") {
       continue;
     }
+    if (shared_terms) {
+      auto term = shared_terms->find(std::make_pair(_slots[i], attributes[i]));
+      if (term != shared_terms->end()) {
+        G1::add(_final_A, _final_A, term->second);
+        continue;
+      }
+    }
     _temp_hash.setHashOf(attributes[i]);
-    G1::mul(_temp_yi_hash, m_pk.Yi[i], _temp_hash);
-    G1::add(_final_A, _final_A, _temp_yi_hash);
+    _bases.push_back(&m_key.precomp().Yi[_slots[i]]);
+    _hashes.push_back(_temp_hash);
+  }
+  if (!_bases.empty()) {
+    G1 _temp;
+    PSFixedBaseTable<G1>::multi_mul(_temp, _bases, _hashes);
+    G1::add(_final_A, _final_A, _temp);
   }
   return this->sign_commitment(_final_A);
 }
@@ -137,7 +266,7 @@ PSSigner::sign_commitment(const G1& commitment) const
 
   PSCredential sig;
   // sig 1
-  G1::mul(sig.sig1, m_pk.g, u);
+  m_key.precomp().g.mul(sig.sig1, u);
   // sig 2
   G1::add(sig.sig2, m_sk_X, commitment);
   G1::mul(sig.sig2, sig.sig2, u);
@@ -2,6 +2,10 @@
 #define PS_SRC_PS_SIGNER_H_
 
 #include "ps-encoding.h"
+#include "ps-precomp.h"
+#include "ps-pubkey-handle.h"
+
+#include <map>
 
 using namespace mcl::bls12;
 
@@ -28,6 +32,14 @@ public:
    */
   PSSigner(size_t attribute_num, const G1& g, const G2& gg);
 
+  /**
+   * @brief Construct a PSSigner from a key exported by get_secret_key(), e.g., on restart.
+   *
+   * @param sk input The private and public key. Throws std::runtime_error if the public key is
+   *        not valid or does not match the private key.
+   */
+  explicit PSSigner(const PSSecretKey& sk);
+
   /**
    * @brief Generate PS private key and public key.
    *
@@ -44,6 +56,21 @@ public:
   PSPubKey
   get_pub_key() const;
 
+  /**
+   * @brief Get the private key with its public key, to restore the signer with PSSigner(const PSSecretKey&).
+   */
+  PSSecretKey
+  get_secret_key() const;
+
+  /**
+   * @brief Get a shared handle to the public key and its precomputation.
+   *
+   * The handle can be passed to any number of PSRequester and PSVerifier objects without
+   * copying or re-validating the key. It is empty until key_gen() has been called.
+   */
+  PSPubKeyHandle
+  get_pub_key_handle() const;
+
   /**
    * @brief EL PASSO ProvideID.
    *
@@ -57,6 +84,28 @@ public:
   el_passo_provide_id(const PSCredRequest& request,
                       const std::string& associated_data, PSCredential& sig) const;
 
+  /**
+   * @brief EL PASSO ProvideID over many requests at once.
+   *
+   * The NIZK proof of each request is checked on its own because its challenge commits to the
+   * requester's random values, so it cannot be folded into a random linear combination.
+   * Instead, the verification and signing of all requests are spread over a pool of worker threads.
+   * A plaintext attribute disclosed at the same slot by several requests, e.g., an expiration date,
+   * is hashed and multiplied by its Yi once for the whole batch.
+   *
+   * @param requests input The ID requests generated by PSRequesters.
+   * @param associated_data input The associated data of each request, in the same order as @p requests.
+   * @param sigs output The PS signatures, in the same order as @p requests. Only the signatures
+   *        of accepted requests are set.
+   * @param thread_num input The number of worker threads, 0 for one per hardware thread.
+   * @return std::vector<bool> One result per request, true if the request at the same index is
+   *         accepted and signed.
+   */
+  std::vector<bool>
+  provide_id_batch(const std::vector<PSCredRequest>& requests,
+                   const std::vector<std::string>& associated_data,
+                   std::vector<PSCredential>& sigs, size_t thread_num = 0) const;
+
   /**
    * @brief Use PS key to sign over a committed message.
    *
@@ -77,22 +126,38 @@ public:
    * @param commitment input The committed message.
    * @param attributes input The plaintext attributes and empty strings are used as
    *        placeholders for secret attributes.
+   * @param used_slots input The key slots of a sparse credential, empty if every slot is used,
+   *        see ps_slot_indexes(). Throws std::runtime_error if it does not match @p attributes.
    * @return PSCredential containing
    *  - G1, the PS signature, first element
    *  - G2, the PS signature, second element
    */
   PSCredential
-  sign_hybrid(const G1& commitment, const std::vector<std::string>& attributes) const;
+  sign_hybrid(const G1& commitment, const std::vector<std::string>& attributes,
+              const std::vector<bool>& used_slots = std::vector<bool>()) const;
 
 private:
+  // (slot, value) of a plaintext attribute -> Yi^hash(value)
+  using AttributeTerms = std::map<std::pair<size_t, std::string>, G1>;
+
   bool
   el_passo_nizk_verify_request(const PSCredRequest& request,
                                const std::string& associated_data) const;
 
+  // the terms of the plaintext attributes shared by at least two of the @p accepted requests
+  AttributeTerms
+  shared_attribute_terms(const std::vector<PSCredRequest>& requests, const std::vector<char>& accepted) const;
+
+  // @p shared_terms are added as they are instead of being hashed and multiplied, may be null
+  PSCredential
+  sign_hybrid(const G1& commitment, const std::vector<std::string>& attributes,
+              const std::vector<bool>& used_slots, const AttributeTerms* shared_terms) const;
+
 private:
-  size_t m_attribute_num;  // maximum supported number of attributes
-  G1 m_sk_X;               // private key, X
-  PSPubKey m_pk;           // public key
+  size_t m_attribute_num;     // maximum supported number of attributes
+  G1 m_sk_X;                  // private key, X
+  PSPubKey m_pk;              // public key
+  PSPubKeyHandle m_key;       // public key of the last key_gen() and its precomputation, shared
 };
 
 #endif  // PS_SRC_PS_SIGNER_H_
\ No newline at end of file
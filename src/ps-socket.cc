@@ -0,0 +1,263 @@
+#include "ps-socket.h"
+
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <stdexcept>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+namespace {
+
+const long ACCEPT_RETRY_DELAY_MS = 10;  // after accept() fails for lack of resources
+
+sockaddr_un
+socket_address(const std::string& path)
+{
+  sockaddr_un _addr;
+  std::memset(&_addr, 0, sizeof(_addr));
+  _addr.sun_family = AF_UNIX;
+  if (path.size() >= sizeof(_addr.sun_path)) {
+    throw std::runtime_error("socket path too long");
+  }
+  std::memcpy(_addr.sun_path, path.data(), path.size());
+  return _addr;
+}
+
+bool
+read_full(int fd, uint8_t* buf, size_t size)
+{
+  while (size > 0) {
+    ssize_t n = ::read(fd, buf, size);
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n <= 0) {
+      return false;
+    }
+    buf += n;
+    size -= n;
+  }
+  return true;
+}
+
+bool
+write_full(int fd, const uint8_t* buf, size_t size)
+{
+  while (size > 0) {
+    ssize_t n = ::send(fd, buf, size, MSG_NOSIGNAL);
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n <= 0) {
+      return false;
+    }
+    buf += n;
+    size -= n;
+  }
+  return true;
+}
+
+bool
+read_u32(int fd, uint32_t& value)
+{
+  uint8_t _buf[4];
+  if (!read_full(fd, _buf, sizeof(_buf))) {
+    return false;
+  }
+  value = (uint32_t(_buf[0]) << 24) | (uint32_t(_buf[1]) << 16) | (uint32_t(_buf[2]) << 8) | uint32_t(_buf[3]);
+  return true;
+}
+
+void
+append_u32(std::vector<uint8_t>& buf, uint32_t value)
+{
+  buf.push_back(value >> 24);
+  buf.push_back(value >> 16);
+  buf.push_back(value >> 8);
+  buf.push_back(value);
+}
+
+}  // namespace
+
+// the socket of a connection, closed once the reader and all pending responses are done with it
+struct PSSocketServer::Connection {
+  int fd;
+  std::mutex write_mutex;  // responses of different workers must not interleave
+
+  explicit Connection(int fd)
+      : fd(fd)
+  {
+  }
+
+  ~Connection()
+  {
+    ::close(fd);
+  }
+
+  void
+  respond(uint32_t id, const PSBuffer& payload)
+  {
+    std::vector<uint8_t> _buf;
+    _buf.reserve(8 + payload.size());
+    append_u32(_buf, id);
+    append_u32(_buf, payload.size());
+    _buf.insert(_buf.end(), payload.begin(), payload.end());
+    std::lock_guard<std::mutex> lock(write_mutex);
+    write_full(fd, _buf.data(), _buf.size());
+  }
+};
+
+PSSocketServer::PSSocketServer(const std::string& path, Handler handler)
+    : m_handler(std::move(handler))
+    , m_path(path)
+{
+  auto _addr = socket_address(path);
+  m_listen_fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+  if (m_listen_fd < 0) {
+    throw std::runtime_error("cannot create socket");
+  }
+  ::unlink(path.c_str());
+  if (::bind(m_listen_fd, reinterpret_cast<sockaddr*>(&_addr), sizeof(_addr)) != 0
+      || ::listen(m_listen_fd, SOMAXCONN) != 0) {
+    ::close(m_listen_fd);
+    throw std::runtime_error("cannot listen on " + path);
+  }
+  m_acceptor = std::thread(&PSSocketServer::accept_connections, this);
+}
+
+PSSocketServer::~PSSocketServer()
+{
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stopped = true;
+    // wake up the acceptor and all readers blocked in the kernel
+    ::shutdown(m_listen_fd, SHUT_RDWR);
+    for (auto& session : m_sessions) {
+      ::shutdown(session.connection->fd, SHUT_RDWR);
+    }
+  }
+  m_acceptor.join();
+  for (auto& session : m_sessions) {
+    session.reader.join();
+  }
+  ::close(m_listen_fd);
+  ::unlink(m_path.c_str());
+}
+
+void
+PSSocketServer::accept_connections()
+{
+  while (true) {
+    int fd = ::accept(m_listen_fd, nullptr, nullptr);
+    int _error = errno;
+    std::unique_lock<std::mutex> lock(m_mutex);
+    if (m_stopped) {
+      if (fd >= 0) {
+        ::close(fd);
+      }
+      return;
+    }
+    if (fd < 0) {
+      if (_error != EINTR && _error != ECONNABORTED) {
+        // e.g., out of file descriptors: wait for connections to close instead of spinning
+        lock.unlock();
+        std::this_thread::sleep_for(std::chrono::milliseconds(ACCEPT_RETRY_DELAY_MS));
+      }
+      continue;
+    }
+    reap_closed_sessions();
+    m_sessions.emplace_back();
+    auto& session = m_sessions.back();
+    session.connection = std::make_shared<Connection>(fd);
+    session.reader = std::thread(&PSSocketServer::serve, this, std::ref(session));
+  }
+}
+
+void
+PSSocketServer::serve(Session& session)
+{
+  auto connection = session.connection;
+  uint32_t _id, _size;
+  while (read_u32(connection->fd, _id) && read_u32(connection->fd, _size) && _size <= MAX_ASSOCIATED_DATA_SIZE) {
+    std::string _associated_data(_size, '\0');
+    if (!read_full(connection->fd, reinterpret_cast<uint8_t*>(&_associated_data[0]), _size)
+        || !read_u32(connection->fd, _size) || _size > MAX_PAYLOAD_SIZE) {
+      break;
+    }
+    PSBuffer _payload;
+    _payload.resize(_size);
+    if (!read_full(connection->fd, _payload.data(), _size)) {
+      break;
+    }
+    m_handler(std::move(_payload), std::move(_associated_data),
+              [connection, _id](const PSBuffer& payload) { connection->respond(_id, payload); });
+  }
+  ::shutdown(connection->fd, SHUT_RDWR);
+  session.closed = true;
+}
+
+void
+PSSocketServer::reap_closed_sessions()
+{
+  for (auto it = m_sessions.begin(); it != m_sessions.end();) {
+    if (it->closed) {
+      it->reader.join();
+      it = m_sessions.erase(it);
+    }
+    else {
+      ++it;
+    }
+  }
+}
+
+PSSocketClient::PSSocketClient(const std::string& path)
+{
+  auto _addr = socket_address(path);
+  m_fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+  if (m_fd < 0) {
+    throw std::runtime_error("cannot create socket");
+  }
+  if (::connect(m_fd, reinterpret_cast<sockaddr*>(&_addr), sizeof(_addr)) != 0) {
+    ::close(m_fd);
+    throw std::runtime_error("cannot connect to " + path);
+  }
+}
+
+PSSocketClient::~PSSocketClient()
+{
+  ::close(m_fd);
+}
+
+PSBuffer
+PSSocketClient::request(const PSBuffer& payload, const std::string& associated_data)
+{
+  uint32_t _id = m_next_id++;
+  std::vector<uint8_t> _buf;
+  _buf.reserve(12 + associated_data.size() + payload.size());
+  append_u32(_buf, _id);
+  append_u32(_buf, associated_data.size());
+  _buf.insert(_buf.end(), associated_data.begin(), associated_data.end());
+  append_u32(_buf, payload.size());
+  _buf.insert(_buf.end(), payload.begin(), payload.end());
+  if (!write_full(m_fd, _buf.data(), _buf.size())) {
+    throw std::runtime_error("cannot send request");
+  }
+  uint32_t _response_id, _size;
+  if (!read_u32(m_fd, _response_id) || _response_id != _id || !read_u32(m_fd, _size)
+      || _size > PSSocketServer::MAX_PAYLOAD_SIZE) {
+    throw std::runtime_error("cannot receive response");
+  }
+  PSBuffer _response;
+  _response.resize(_size);
+  if (!read_full(m_fd, _response.data(), _size)) {
+    throw std::runtime_error("cannot receive response");
+  }
+  return _response;
+}
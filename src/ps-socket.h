@@ -0,0 +1,117 @@
+#ifndef PS_SRC_PS_SOCKET_H_
+#define PS_SRC_PS_SOCKET_H_
+
+#include <atomic>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "ps-encoding.h"
+
+/**
+ * @brief A Unix domain socket server of framed requests, each answered once, in any order.
+ *
+ * A connection carries any number of requests, and a response is sent as soon as its request is
+ * handled, so a client can keep several requests in flight. All integers are big-endian.
+ *  - request: id (4 bytes), associated data size (4 bytes), associated data, payload size (4 bytes), payload.
+ *  - response: id (4 bytes) of the request, payload size (4 bytes), payload.
+ *
+ * A connection sending a size over the limits below is closed.
+ */
+class PSSocketServer {
+public:
+  static constexpr uint32_t MAX_ASSOCIATED_DATA_SIZE = 1 << 16;
+  static constexpr uint32_t MAX_PAYLOAD_SIZE = 1 << 20;
+
+  /**
+   * @brief Sends the response of a request. Can be called from any thread, after the server is gone too.
+   */
+  using Respond = std::function<void(const PSBuffer& payload)>;
+
+  /**
+   * @brief Called on the reader thread of a connection for every request. The next request of the
+   *        connection is read once it returns, so a handler that waits slows down its client.
+   */
+  using Handler = std::function<void(PSBuffer payload, std::string associated_data, Respond respond)>;
+
+  /**
+   * @brief Listen on @p path and start accepting connections.
+   *
+   * @param path input The path of the socket. An existing file at @p path is replaced.
+   *        Throws std::runtime_error if the socket cannot be created.
+   * @param handler input Called for every request.
+   */
+  PSSocketServer(const std::string& path, Handler handler);
+
+  PSSocketServer(const PSSocketServer&) = delete;
+  PSSocketServer&
+  operator=(const PSSocketServer&) = delete;
+
+  /**
+   * @brief Stop accepting, close all connections, and remove the socket file.
+   *
+   * Responses to requests still being handled are dropped.
+   */
+  ~PSSocketServer();
+
+private:
+  struct Connection;
+  struct Session {
+    std::shared_ptr<Connection> connection;
+    std::thread reader;
+    std::atomic<bool> closed{false};
+  };
+
+  void
+  accept_connections();
+
+  void
+  serve(Session& session);
+
+  void
+  reap_closed_sessions();
+
+private:
+  Handler m_handler;
+  std::string m_path;
+  int m_listen_fd = -1;
+
+  std::mutex m_mutex;
+  std::list<Session> m_sessions;
+  bool m_stopped = false;
+  std::thread m_acceptor;  // started last, after all the members above
+};
+
+/**
+ * @brief A blocking client of a PSSocketServer, one request at a time.
+ */
+class PSSocketClient {
+public:
+  /**
+   * @brief Connect to the server at @p path. Throws std::runtime_error on failure.
+   */
+  explicit PSSocketClient(const std::string& path);
+
+  PSSocketClient(const PSSocketClient&) = delete;
+  PSSocketClient&
+  operator=(const PSSocketClient&) = delete;
+
+  ~PSSocketClient();
+
+  /**
+   * @brief Send a request and wait for its response.
+   *
+   * @return PSBuffer The payload of the response. Throws std::runtime_error if the connection fails.
+   */
+  PSBuffer
+  request(const PSBuffer& payload, const std::string& associated_data);
+
+private:
+  int m_fd = -1;
+  uint32_t m_next_id = 0;
+};
+
+#endif  // PS_SRC_PS_SOCKET_H_
@@ -0,0 +1,115 @@
+#include "ps-token-pool.h"
+
+using namespace mcl::bls12;
+
+PSPresentationTokenPool::PSPresentationTokenPool(const PSRequester& requester, const PSCredential& sig,
+                                                 const std::vector<std::tuple<std::string, bool>>& attributes,
+                                                 size_t capacity)
+    : m_requester(requester)
+    , m_sig(sig)
+    , m_attributes(attributes)
+    , m_with_id_retrieval(false)
+    , m_capacity(capacity)
+{
+  start();
+}
+
+PSPresentationTokenPool::PSPresentationTokenPool(const PSRequester& requester, const PSCredential& sig,
+                                                 const std::vector<std::tuple<std::string, bool>>& attributes,
+                                                 const G1& authority_pk, const G1& g, const G1& h,
+                                                 size_t capacity)
+    : m_requester(requester)
+    , m_sig(sig)
+    , m_attributes(attributes)
+    , m_with_id_retrieval(true)
+    , m_authority_pk(authority_pk)
+    , m_g(g)
+    , m_h(h)
+    , m_capacity(capacity)
+{
+  start();
+}
+
+PSPresentationTokenPool::~PSPresentationTokenPool()
+{
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stopped = true;
+  }
+  m_cv.notify_all();
+  m_worker.join();
+}
+
+PSPresentationToken
+PSPresentationTokenPool::take()
+{
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_tokens.empty()) {
+      auto token = std::move(m_tokens.front());
+      m_tokens.pop_front();
+      m_cv.notify_all();
+      return token;
+    }
+    if (m_error) {
+      std::rethrow_exception(m_error);
+    }
+  }
+  return precompute();
+}
+
+size_t
+PSPresentationTokenPool::size() const
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_tokens.size();
+}
+
+PSPresentationToken
+PSPresentationTokenPool::precompute() const
+{
+  if (m_with_id_retrieval) {
+    return m_requester.el_passo_precompute_prove_id(m_sig, m_attributes, m_authority_pk, m_g, m_h);
+  }
+  return m_requester.el_passo_precompute_prove_id_without_id_retrieval(m_sig, m_attributes);
+}
+
+void
+PSPresentationTokenPool::start()
+{
+  // on the caller's thread, so that invalid inputs throw from the constructor
+  auto token = precompute();
+  if (m_capacity > 0) {
+    m_tokens.push_back(std::move(token));
+  }
+  m_worker = std::thread(&PSPresentationTokenPool::refill, this);
+}
+
+void
+PSPresentationTokenPool::refill()
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  while (true) {
+    m_cv.wait(lock, [this] { return m_stopped || m_tokens.size() < m_capacity; });
+    if (m_stopped) {
+      return;
+    }
+    // compute without holding the lock so take() is never blocked by a precomputation
+    lock.unlock();
+    PSPresentationToken token;
+    std::exception_ptr error;
+    try {
+      token = precompute();
+    }
+    catch (...) {
+      error = std::current_exception();
+    }
+    lock.lock();
+    if (error) {
+      // the inputs do not change, so later tokens would fail alike
+      m_error = error;
+      return;
+    }
+    m_tokens.push_back(std::move(token));
+  }
+}
@@ -0,0 +1,101 @@
+#ifndef PS_SRC_PS_TOKEN_POOL_H_
+#define PS_SRC_PS_TOKEN_POOL_H_
+
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <thread>
+
+#include "ps-requester.h"
+
+using namespace mcl::bls12;
+
+/**
+ * @brief A pool of PSPresentationToken kept filled by a background thread, so that a login
+ *        only pays for PSRequester::el_passo_prove_id() with a token.
+ *
+ * Every token is handed out once by take() and removed from the pool. The first token is computed
+ * by the constructor, so that invalid inputs throw to the caller rather than on the background
+ * thread.
+ */
+class PSPresentationTokenPool {
+public:
+  /**
+   * @brief Start a pool of tokens for ProveID without id retrieval.
+   *
+   * Throws std::runtime_error if a token cannot be computed from @p sig and @p attributes.
+   *
+   * @param requester input The requester, must outlive the pool.
+   * @param sig input The original PS signature.
+   * @param attributes input The same as PSRequester::el_passo_prove_id().
+   * @param capacity input The number of tokens kept ready.
+   */
+  PSPresentationTokenPool(const PSRequester& requester, const PSCredential& sig,
+                          const std::vector<std::tuple<std::string, bool>>& attributes,
+                          size_t capacity);
+
+  /**
+   * @brief Start a pool of tokens for ProveID with id retrieval.
+   *
+   * @param authority_pk, g, h input The same as PSRequester::el_passo_prove_id().
+   */
+  PSPresentationTokenPool(const PSRequester& requester, const PSCredential& sig,
+                          const std::vector<std::tuple<std::string, bool>>& attributes,
+                          const G1& authority_pk, const G1& g, const G1& h,
+                          size_t capacity);
+
+  PSPresentationTokenPool(const PSPresentationTokenPool&) = delete;
+  PSPresentationTokenPool&
+  operator=(const PSPresentationTokenPool&) = delete;
+
+  /**
+   * @brief Stop the background thread. Tokens left in the pool are dropped.
+   */
+  ~PSPresentationTokenPool();
+
+  /**
+   * @brief Remove a token from the pool. Computes one in place if the pool is empty.
+   *
+   * Once the background thread has failed to compute a token, it stops refilling the pool, and
+   * take() rethrows its exception when the pool is empty.
+   */
+  PSPresentationToken
+  take();
+
+  /**
+   * @brief The number of tokens currently ready.
+   */
+  size_t
+  size() const;
+
+private:
+  PSPresentationToken
+  precompute() const;
+
+  // compute the first token, then start the background thread
+  void
+  start();
+
+  void
+  refill();
+
+private:
+  const PSRequester& m_requester;
+  PSCredential m_sig;
+  std::vector<std::tuple<std::string, bool>> m_attributes;
+  bool m_with_id_retrieval;
+  G1 m_authority_pk;
+  G1 m_g;
+  G1 m_h;
+  size_t m_capacity;
+
+  mutable std::mutex m_mutex;
+  std::condition_variable m_cv;           // signaled when a token is taken or the pool stops
+  std::deque<PSPresentationToken> m_tokens;
+  bool m_stopped = false;
+  std::exception_ptr m_error;             // the failure of the background thread, if any
+  std::thread m_worker;                   // started by start(), after all the members above
+};
+
+#endif  // PS_SRC_PS_TOKEN_POOL_H_
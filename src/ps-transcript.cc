@@ -0,0 +1,68 @@
+#include "ps-transcript.h"
+
+#include <stdexcept>
+
+using namespace mcl::bls12;
+
+// large enough for a compressed G2 point over the largest field mcl supports
+static const size_t MAX_ELEMENT_SIZE = 192;
+
+PSTranscript::PSTranscript(PSProofVersion version, const std::string& label)
+    : m_version(version)
+{
+  switch (m_version) {
+  case PSProofVersion::HexTranscript:
+    break;
+  case PSProofVersion::BinaryTranscript:
+    m_digest_engine.update(label);
+    break;
+  default:
+    throw std::runtime_error("unsupported proof version");
+  }
+}
+
+template <class T>
+void
+PSTranscript::appendElement(const T& item)
+{
+  if (m_version == PSProofVersion::HexTranscript) {
+    m_digest_engine.update(item.serializeToHexStr());
+    return;
+  }
+  uint8_t buf[MAX_ELEMENT_SIZE];
+  size_t size = item.serialize(buf, sizeof(buf));
+  if (size == 0) {
+    throw std::runtime_error("element serialization failed");
+  }
+  m_digest_engine.update(buf, size);
+}
+
+void
+PSTranscript::append(const G1& g)
+{
+  appendElement(g);
+}
+
+void
+PSTranscript::append(const G2& g)
+{
+  appendElement(g);
+}
+
+void
+PSTranscript::append(const Fr& f)
+{
+  appendElement(f);
+}
+
+void
+PSTranscript::challenge(Fr& c, const std::string& associated_data)
+{
+  if (m_version == PSProofVersion::HexTranscript) {
+    c.setHashOf(m_digest_engine.digest(associated_data));
+    return;
+  }
+  uint8_t md[32];
+  m_digest_engine.digest(md, sizeof(md), associated_data.data(), associated_data.size());
+  c.setHashOf(md, sizeof(md));
+}
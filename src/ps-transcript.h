@@ -0,0 +1,60 @@
+#ifndef PS_SRC_PS_TRANSCRIPT_H_
+#define PS_SRC_PS_TRANSCRIPT_H_
+
+#include <cybozu/sha2.hpp>
+
+#include "ps-encoding.h"
+
+using namespace mcl::bls12;
+
+// protocol labels of PSTranscript, shared by provers and verifiers
+static const char PS_TRANSCRIPT_REQUEST_ID[] = "el-passo/request-id";
+static const char PS_TRANSCRIPT_PROVE_ID[] = "el-passo/prove-id";
+
+/**
+ * @brief Fiat-Shamir transcript of a NIZK Schnorr proof.
+ *
+ * The prover and the verifier append the same public values in the same order and then
+ * derive the challenge c from the associated data.
+ *
+ * With PSProofVersion::BinaryTranscript, the transcript starts with a protocol label and every
+ * element is absorbed in its fixed-size compressed encoding, serialized on the stack.
+ * With PSProofVersion::HexTranscript, the label is ignored and every element is absorbed as a
+ * hex string, which is how proofs were built before versioning.
+ */
+class PSTranscript {
+public:
+  /**
+   * @brief Start a transcript.
+   *
+   * @param version input The proof format, throws std::runtime_error if unknown.
+   * @param label input The protocol label, to separate the challenges of different proofs.
+   */
+  PSTranscript(PSProofVersion version, const std::string& label);
+
+  void
+  append(const G1& g);
+
+  void
+  append(const G2& g);
+
+  void
+  append(const Fr& f);
+
+  /**
+   * @brief c = hash(transcript || associated_data). The transcript must not be used afterwards.
+   */
+  void
+  challenge(Fr& c, const std::string& associated_data);
+
+private:
+  template <class T>
+  void
+  appendElement(const T& item);
+
+private:
+  PSProofVersion m_version;
+  cybozu::Sha256 m_digest_engine;
+};
+
+#endif  // PS_SRC_PS_TRANSCRIPT_H_
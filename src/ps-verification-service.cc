@@ -0,0 +1,234 @@
+#include "ps-verification-service.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+using namespace mcl::bls12;
+
+PSVerificationService::PSVerificationService(const PSVerifier& verifier, const std::string& service_name,
+                                             size_t thread_num, size_t queue_capacity, size_t max_batch)
+    : m_verifier(verifier)
+    , m_service_name(service_name)
+    , m_with_id_retrieval(false)
+    , m_capacity(std::max<size_t>(queue_capacity, 1))
+    , m_max_batch(std::max<size_t>(max_batch, 1))
+{
+  start(thread_num);
+}
+
+PSVerificationService::PSVerificationService(const PSVerifier& verifier, const std::string& service_name,
+                                             const G1& authority_pk, const G1& g, const G1& h,
+                                             size_t thread_num, size_t queue_capacity, size_t max_batch)
+    : m_verifier(verifier)
+    , m_service_name(service_name)
+    , m_with_id_retrieval(true)
+    , m_authority_pk(authority_pk)
+    , m_g(g)
+    , m_h(h)
+    , m_capacity(std::max<size_t>(queue_capacity, 1))
+    , m_max_batch(std::max<size_t>(max_batch, 1))
+{
+  start(thread_num);
+}
+
+PSVerificationService::~PSVerificationService()
+{
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stopped = true;
+  }
+  m_work_cv.notify_all();
+  m_space_cv.notify_all();
+  for (auto& worker : m_workers) {
+    worker.join();
+  }
+}
+
+std::future<bool>
+PSVerificationService::submit(PSBuffer proof, std::string associated_data)
+{
+  auto promise = std::make_shared<std::promise<bool>>();
+  auto result = promise->get_future();
+  submit(std::move(proof), std::move(associated_data), [promise](bool valid) { promise->set_value(valid); });
+  return result;
+}
+
+void
+PSVerificationService::submit(PSBuffer proof, std::string associated_data, Callback done)
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  m_space_cv.wait(lock, [this] { return m_stopped || m_in_flight < m_capacity; });
+  enqueue(lock, std::move(proof), std::move(associated_data), std::move(done));
+}
+
+bool
+PSVerificationService::try_submit(PSBuffer proof, std::string associated_data, Callback done)
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  if (!m_stopped && m_in_flight >= m_capacity) {
+    return false;
+  }
+  enqueue(lock, std::move(proof), std::move(associated_data), std::move(done));
+  return true;
+}
+
+size_t
+PSVerificationService::pending() const
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_in_flight;
+}
+
+void
+PSVerificationService::start(size_t thread_num)
+{
+  if (thread_num == 0) {
+    thread_num = std::max(1u, std::thread::hardware_concurrency());
+  }
+  m_workers.reserve(thread_num);
+  for (size_t t = 0; t < thread_num; t++) {
+    m_workers.emplace_back(&PSVerificationService::work, this);
+  }
+}
+
+void
+PSVerificationService::enqueue(std::unique_lock<std::mutex>& lock, PSBuffer&& proof, std::string&& associated_data,
+                               Callback&& done)
+{
+  if (m_stopped) {
+    throw std::runtime_error("verification service stopped");
+  }
+  auto job = std::make_unique<Job>();
+  job->buffer = std::move(proof);
+  job->associated_data = std::move(associated_data);
+  job->done = std::move(done);
+  m_decode_queue.push_back(std::move(job));
+  m_in_flight++;
+  lock.unlock();
+  m_work_cv.notify_one();
+}
+
+void
+PSVerificationService::work()
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  while (true) {
+    m_work_cv.wait(lock, [this] {
+      return !m_pairing_queue.empty() || !m_nizk_queue.empty() || !m_decode_queue.empty()
+          || (m_stopped && m_in_flight == 0);
+    });
+    std::vector<JobPtr> _done;
+    std::vector<bool> _results;
+    // the most advanced stage first, so that proofs in flight finish before new ones start
+    if (!m_pairing_queue.empty()) {
+      while (!m_pairing_queue.empty() && _done.size() < m_max_batch) {
+        _done.push_back(std::move(m_pairing_queue.front()));
+        m_pairing_queue.pop_front();
+      }
+      lock.unlock();
+      _results.assign(_done.size(), false);
+      check_pairings(_done, _results);
+    }
+    else if (!m_nizk_queue.empty() || !m_decode_queue.empty()) {
+      bool _decoding = m_nizk_queue.empty();
+      auto& _queue = _decoding ? m_decode_queue : m_nizk_queue;
+      auto _job = std::move(_queue.front());
+      _queue.pop_front();
+      lock.unlock();
+      bool _passed = _decoding ? decode(*_job) : check_nizk(*_job);
+      if (_passed) {
+        lock.lock();
+        (_decoding ? m_nizk_queue : m_pairing_queue).push_back(std::move(_job));
+        m_work_cv.notify_one();
+        continue;
+      }
+      _results.push_back(_job->verdict);
+      _done.push_back(std::move(_job));
+    }
+    else {
+      return;  // stopped and drained
+    }
+    finish(_done, _results);
+    lock.lock();
+    m_in_flight -= _done.size();
+    m_space_cv.notify_all();
+    if (m_stopped && m_in_flight == 0) {
+      m_work_cv.notify_all();
+    }
+  }
+}
+
+bool
+PSVerificationService::decode(Job& job) const
+{
+  // the shape and the caches are checked on the layout, before any point is decoded
+  IdProofView _view;
+  if (IdProofView::parse(job.buffer.data(), job.buffer.size(), _view) != PSDecodeStatus::Ok
+      || m_verifier.admit(_view, m_with_id_retrieval) != PSAdmissionStatus::Admitted) {
+    return false;
+  }
+  auto& _result_cache = m_verifier.m_result_cache;
+  if (_result_cache) {
+    job.result_key = PSResultCache::digest(job.buffer.data(), job.buffer.size(), job.associated_data, m_service_name,
+                                           m_with_id_retrieval ? &m_authority_pk : nullptr,
+                                           m_with_id_retrieval ? &m_g : nullptr,
+                                           m_with_id_retrieval ? &m_h : nullptr);
+    if (m_verifier.cached_verdict(_view, *job.result_key, job.associated_data, job.verdict)) {
+      job.result_key.reset();
+      return false;
+    }
+  }
+  Fr _c;
+  if (!_view.decode_c(_c) || m_verifier.is_replay(_c, job.associated_data)) {
+    return false;
+  }
+  if (IdProof::tryFromBufferString(job.buffer, job.proof) != PSDecodeStatus::Ok) {
+    return false;
+  }
+  job.buffer = PSBuffer();
+  return true;
+}
+
+bool
+PSVerificationService::check_nizk(Job& job) const
+{
+  if (m_with_id_retrieval) {
+    return m_verifier.el_passo_prepare_pairing_check(job.proof, job.associated_data, m_service_name,
+                                                     &m_authority_pk, &m_g, &m_h, job.final_k);
+  }
+  return m_verifier.el_passo_prepare_pairing_check(job.proof, job.associated_data, m_service_name,
+                                                   nullptr, nullptr, nullptr, job.final_k);
+}
+
+void
+PSVerificationService::check_pairings(std::vector<JobPtr>& jobs, std::vector<bool>& results) const
+{
+  std::vector<IdProof> _proofs;
+  std::vector<G2> _final_ks;
+  std::vector<size_t> _indexes;
+  _proofs.reserve(jobs.size());
+  _final_ks.reserve(jobs.size());
+  _indexes.reserve(jobs.size());
+  for (auto& job : jobs) {
+    _indexes.push_back(_proofs.size());
+    _proofs.push_back(std::move(job->proof));
+    _final_ks.push_back(job->final_k);
+  }
+  m_verifier.batch_pairing_check(_proofs, _final_ks, _indexes, results);
+  for (size_t i = 0; i < jobs.size(); i++) {
+    results[i] = results[i] && m_verifier.remember(_proofs[i].c, jobs[i]->associated_data);
+  }
+}
+
+void
+PSVerificationService::finish(std::vector<JobPtr>& jobs, const std::vector<bool>& results)
+{
+  for (size_t i = 0; i < jobs.size(); i++) {
+    if (jobs[i]->result_key) {
+      m_verifier.m_result_cache->insert(*jobs[i]->result_key, results[i]);
+    }
+    if (jobs[i]->done) {
+      jobs[i]->done(results[i]);
+    }
+  }
+}
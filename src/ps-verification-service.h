@@ -0,0 +1,158 @@
+#ifndef PS_SRC_PS_VERIFICATION_SERVICE_H_
+#define PS_SRC_PS_VERIFICATION_SERVICE_H_
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+
+#include "ps-verifier.h"
+
+using namespace mcl::bls12;
+
+/**
+ * @brief A pool of worker threads verifying encoded ProveID messages for one RP service.
+ *
+ * Every submitted proof goes through three stages, each with its own queue:
+ *  -# decode: PSVerifier::admit(), then the result cache and the replay cache of the verifier
+ *     on the layout of the proof, then IdProof::tryFromBufferString().
+ *  -# NIZK: the Schnorr proof, then the aggregation of the disclosed attributes into k.
+ *  -# pairing: the PS signature check. Proofs waiting at this stage are checked together,
+ *     up to a batch size, with one multi-pairing as in PSVerifier::batch_verify_id().
+ *
+ * An idle worker takes work from the most advanced stage that has any, so proofs already in
+ * flight finish before new ones are started and the latency of a proof stays bounded under load.
+ * At most a queue capacity of proofs are in flight: submit() blocks and try_submit() fails
+ * while the service is full.
+ */
+class PSVerificationService {
+public:
+  /**
+   * @brief Called once with the result of a proof, on a worker thread. Must not throw.
+   */
+  using Callback = std::function<void(bool)>;
+
+  /**
+   * @brief Start a service verifying proofs without id retrieval.
+   *
+   * @param verifier input The verifier, must outlive the service. Register the service name and
+   *        disclosed attributes before starting the service.
+   * @param service_name input The RP's service name, e.g., RP's domain name.
+   * @param thread_num input The number of workers, 0 for std::thread::hardware_concurrency().
+   * @param queue_capacity input The maximum number of proofs in flight.
+   * @param max_batch input The maximum number of proofs in one pairing check.
+   */
+  PSVerificationService(const PSVerifier& verifier, const std::string& service_name,
+                        size_t thread_num = 0, size_t queue_capacity = 1024, size_t max_batch = 16);
+
+  /**
+   * @brief Start a service verifying proofs with id retrieval.
+   *
+   * @param authority_pk, g, h input The same as PSVerifier::el_passo_verify_id().
+   */
+  PSVerificationService(const PSVerifier& verifier, const std::string& service_name,
+                        const G1& authority_pk, const G1& g, const G1& h,
+                        size_t thread_num = 0, size_t queue_capacity = 1024, size_t max_batch = 16);
+
+  PSVerificationService(const PSVerificationService&) = delete;
+  PSVerificationService&
+  operator=(const PSVerificationService&) = delete;
+
+  /**
+   * @brief Finish the proofs already submitted, then stop the workers.
+   */
+  ~PSVerificationService();
+
+  /**
+   * @brief Submit an encoded IdProof, waiting while the service is full.
+   *
+   * @param proof input The output of IdProof::toBufferString().
+   * @param associated_data input The associated data bound with the proof.
+   * @return std::future<bool> True once the proof is found valid.
+   */
+  std::future<bool>
+  submit(PSBuffer proof, std::string associated_data);
+
+  /**
+   * @brief Submit an encoded IdProof, waiting while the service is full.
+   *
+   * @param done input Called with the result once the proof is verified.
+   */
+  void
+  submit(PSBuffer proof, std::string associated_data, Callback done);
+
+  /**
+   * @brief Submit an encoded IdProof unless the service is full.
+   *
+   * @return bool False if the service is full, in which case @p done is never called.
+   */
+  bool
+  try_submit(PSBuffer proof, std::string associated_data, Callback done);
+
+  /**
+   * @brief The number of proofs in flight, including those whose callback is still running.
+   */
+  size_t
+  pending() const;
+
+private:
+  struct Job {
+    PSBuffer buffer;
+    std::string associated_data;
+    Callback done;
+    IdProof proof;
+    G2 final_k;
+    std::optional<PSResultCache::Digest> result_key;  // the key of the proof in the result cache, if to be cached
+    bool verdict = false;                              // the result of a proof that leaves before the last stage
+  };
+  using JobPtr = std::unique_ptr<Job>;
+
+  void
+  start(size_t thread_num);
+
+  void
+  enqueue(std::unique_lock<std::mutex>& lock, PSBuffer&& proof, std::string&& associated_data, Callback&& done);
+
+  void
+  work();
+
+  // each stage returns whether the job moves on to the next one
+  bool
+  decode(Job& job) const;
+
+  bool
+  check_nizk(Job& job) const;
+
+  void
+  check_pairings(std::vector<JobPtr>& jobs, std::vector<bool>& results) const;
+
+  void
+  finish(std::vector<JobPtr>& jobs, const std::vector<bool>& results);
+
+private:
+  const PSVerifier& m_verifier;
+  std::string m_service_name;
+  bool m_with_id_retrieval;
+  G1 m_authority_pk;
+  G1 m_g;
+  G1 m_h;
+  size_t m_capacity;
+  size_t m_max_batch;
+
+  mutable std::mutex m_mutex;
+  std::condition_variable m_work_cv;   // signaled when a job is queued or the service stops
+  std::condition_variable m_space_cv;  // signaled when a job is finished
+  std::deque<JobPtr> m_decode_queue;
+  std::deque<JobPtr> m_nizk_queue;
+  std::deque<JobPtr> m_pairing_queue;
+  size_t m_in_flight = 0;
+  bool m_stopped = false;
+  std::vector<std::thread> m_workers;  // started last, after all the members above
+};
+
+#endif  // PS_SRC_PS_VERIFICATION_SERVICE_H_
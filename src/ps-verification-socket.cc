@@ -0,0 +1,25 @@
+#include "ps-verification-socket.h"
+
+PSVerificationSocketServer::PSVerificationSocketServer(PSVerificationService& service, const std::string& path)
+    : m_server(path, [&service](PSBuffer proof, std::string associated_data, PSSocketServer::Respond respond) {
+      // waits while the service is full, so a fast client is slowed down to the pace of the workers
+      service.submit(std::move(proof), std::move(associated_data), [respond](bool valid) {
+        PSBuffer _result;
+        _result.push_back(valid ? 1 : 0);
+        respond(_result);
+      });
+    })
+{
+}
+
+PSVerificationSocketClient::PSVerificationSocketClient(const std::string& path)
+    : m_client(path)
+{
+}
+
+bool
+PSVerificationSocketClient::verify(const PSBuffer& proof, const std::string& associated_data)
+{
+  auto _result = m_client.request(proof, associated_data);
+  return _result.size() == 1 && _result[0] == 1;
+}
@@ -0,0 +1,52 @@
+#ifndef PS_SRC_PS_VERIFICATION_SOCKET_H_
+#define PS_SRC_PS_VERIFICATION_SOCKET_H_
+
+#include "ps-socket.h"
+#include "ps-verification-service.h"
+
+/**
+ * @brief A Unix domain socket front end of a PSVerificationService.
+ *
+ * Requests and responses are framed as described in PSSocketServer.
+ *  - request payload: the output of IdProof::toBufferString(), with the associated data bound with the proof.
+ *  - response payload: 1 byte, 1 if the proof is valid and 0 otherwise.
+ */
+class PSVerificationSocketServer {
+public:
+  /**
+   * @brief Listen on @p path and start accepting connections.
+   *
+   * @param service input The service verifying the proofs, must outlive the server.
+   * @param path input The same as PSSocketServer::PSSocketServer().
+   */
+  PSVerificationSocketServer(PSVerificationService& service, const std::string& path);
+
+private:
+  PSSocketServer m_server;
+};
+
+/**
+ * @brief A blocking client of a PSVerificationSocketServer, one request at a time.
+ */
+class PSVerificationSocketClient {
+public:
+  /**
+   * @brief Connect to the server at @p path. Throws std::runtime_error on failure.
+   */
+  explicit PSVerificationSocketClient(const std::string& path);
+
+  /**
+   * @brief Send a proof and wait for its result.
+   *
+   * @param proof input The output of IdProof::toBufferString().
+   * @param associated_data input The associated data bound with the proof.
+   * @return bool True if the proof is valid. Throws std::runtime_error if the connection fails.
+   */
+  bool
+  verify(const PSBuffer& proof, const std::string& associated_data);
+
+private:
+  PSSocketClient m_client;
+};
+
+#endif  // PS_SRC_PS_VERIFICATION_SOCKET_H_
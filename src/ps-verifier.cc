@@ -1,37 +1,55 @@
 #include "ps-verifier.h"
 
 #include <chrono>
+#include <stdexcept>
+
 #include <cybozu/sha2.hpp>
 
+#include "ps-msm.h"
+#include "ps-pairing.h"
+#include "ps-transcript.h"
+
 using namespace mcl::bls12;
 
 PSVerifier::PSVerifier(const PSPubKey& pk)
-    : m_pk(pk)
+    : PSVerifier(PSPubKeyHandle(pk))
 {
 }
 
+PSVerifier::PSVerifier(const PSPubKeyHandle& key)
+    : m_key(key)
+{
+  if (m_key.use_count() == 0) {
+    throw std::runtime_error("empty public key handle");
+  }
+  m_attribute_terms.resize(m_key.pk().YYi.size());
+}
+
 bool
 PSVerifier::verify(const PSCredential& sig, const std::vector<std::string>& all_attributes) const
 {
-  if (sig.sig1.isZero()) {
+  if (sig.sig1.isZero() || all_attributes.size() != m_key.pk().YYi.size()) {
     return false;
   }
 
+  std::vector<const PSFixedBaseTable<G2>*> _bases;
+  std::vector<Fr> _attribute_hashes;
+  _bases.reserve(all_attributes.size());
+  _attribute_hashes.reserve(all_attributes.size());
   Fr _attribute_hash;
-  G2 _yy_hash_sum = m_pk.XX;
   int counter = 0;
-  G2 _yyi_hash_product;
   for (const auto& attribute : all_attributes) {
     _attribute_hash.setHashOf(attribute);
-    G2::mul(_yyi_hash_product, m_pk.YYi[counter], _attribute_hash);
-    G2::add(_yy_hash_sum, _yy_hash_sum, _yyi_hash_product);
+    _bases.push_back(&m_key.precomp().YYi[counter]);
+    _attribute_hashes.push_back(_attribute_hash);
     counter++;
   }
+  G2 _yy_hash_sum;
+  PSFixedBaseTable<G2>::multi_mul(_yy_hash_sum, _bases, _attribute_hashes);
+  G2::add(_yy_hash_sum, _yy_hash_sum, m_key.pk().XX);
 
-  GT _lhs, _rhs;
-  pairing(_lhs, sig.sig1, _yy_hash_sum);
-  pairing(_rhs, sig.sig2, m_pk.gg);
-  return _lhs == _rhs;
+  // e(sig1, XX * PI{ YYi^mi }) ?= e(sig2, gg)
+  return ps_pairing_equal(sig.sig1, _yy_hash_sum, sig.sig2, m_key.gg_lines());
 }
 
 bool
@@ -40,191 +58,577 @@ PSVerifier::el_passo_verify_id(const IdProof& proof,
                                const std::string& service_name,
                                const G1& authority_pk, const G1& g, const G1& h) const
 {
-  /** NIZK Verify:
-   * Public Value:
-   * * k = XX * PI{ YY_j^attribute_j } * gg^t
-   * * phi = hash(domain)^s
-   * * E1 = g^epsilon
-   * * E2 = y^epsilon * h^gamma
-   *
-   * Public Random Value:
-   * * V_k = XX * PI{ YYj^random1_j } * gg^random_2
-   *       = k^c * XX^(1-c) * PI{ YYj^r1_j } * gg^r2
-   * * V_phi = hash(domain)^random1_s
-   *         = phi^c * hash(domain)^r1_s
-   * * V_E1 = g^random_3
-   *        = E1^c * g^r3
-   * * V_E2 = y^random_3 * h^random1_gamma
-   *        = E2^c * y^r3 * h^r1_gamma
-   *
-   * c: to be compared
-   * c = hash(k || phi || E1 || E2 || V_k || V_phi || V_E1 || V_E2 || associated_data )
-   *
-   * Rs:
-   * * r1_j: random1_j - attribute_j * c
-   * * r2: random2 - t * c
-   * * r3: random3 - epsilon * c
-   */
-  if (!proof.E1.has_value() || !proof.E2.has_value()) {
+  std::vector<size_t> _slots;
+  if (is_replay(proof.c, associated_data)
+      || !el_passo_nizk_verify_id(proof, associated_data, service_name, authority_pk, g, h, _slots)) {
     return false;
   }
-  // V_k = k^c * XX^(1-c) * PI{ YYj^r1_j } * gg^r2
-  G2 _V_k;
-  G2::mul(_V_k, proof.k, proof.c);
-  int counter = 0;
-  G2 _base_r;
-  for (size_t i = 0; i < proof.attributes.size(); i++) {
-    if (proof.attributes[i] == "") {
-      G2::mul(_base_r, m_pk.YYi[i], proof.rs[counter]);
-      counter++;
-      G2::add(_V_k, _V_k, _base_r);
-    }
-  }
-  G2::mul(_base_r, m_pk.gg, proof.rs[proof.rs.size() - 2]);
-  G2::add(_V_k, _V_k, _base_r);
-  Fr _1_c = Fr::one();
-  Fr::sub(_1_c, _1_c, proof.c);
-  G2::mul(_base_r, m_pk.XX, _1_c);
-  G2::add(_V_k, _V_k, _base_r);
 
-  // V_phi = phi^c * hash(domain)^r1_s
-  G1 _V_phi, _V_E1, _V_E2;
-  G1::mul(_V_phi, proof.phi, proof.c);
-  G1 _temp;
-  hashAndMapToG1(_temp, service_name);
-  G1::mul(_temp, _temp, proof.rs[0]);
-  G1::add(_V_phi, _V_phi, _temp);
+  // signature verification, e(sigma’_1, k) ?= e(sigma’_2, gg)
+  G2 _final_k = prepare_hybrid_verification(proof.k, proof.attributes, _slots);
+  return ps_pairing_equal(proof.sig1, _final_k, proof.sig2, m_key.gg_lines())
+      && remember(proof.c, associated_data);
+}
 
-  // V_E1 = E1^c * g^r3
-  G1::mul(_V_E1, proof.E1.value(), proof.c);
-  G1::mul(_temp, g, proof.rs[proof.rs.size() - 1]);
-  G1::add(_V_E1, _V_E1, _temp);
+bool
+PSVerifier::el_passo_verify_id_without_id_retrieval(const IdProof& proof,
+                                                    const std::string& associated_data,
+                                                    const std::string& service_name) const
+{
+  std::vector<size_t> _slots;
+  if (is_replay(proof.c, associated_data)
+      || !el_passo_nizk_verify_id_without_id_retrieval(proof, associated_data, service_name, _slots)) {
+    return false;
+  }
 
-  // V_E2 = E2^c * y^r3 * h^r1_gamma
-  G1::mul(_V_E2, proof.E2.value(), proof.c);
-  G1::mul(_temp, authority_pk, proof.rs[proof.rs.size() - 1]);
-  G1::add(_V_E2, _V_E2, _temp);
-  G1::mul(_temp, h, proof.rs[1]);
-  G1::add(_V_E2, _V_E2, _temp);
+  // signature verification, e(sigma’_1, k) ?= e(sigma’_2, gg)
+  G2 _final_k = prepare_hybrid_verification(proof.k, proof.attributes, _slots);
+  return ps_pairing_equal(proof.sig1, _final_k, proof.sig2, m_key.gg_lines())
+      && remember(proof.c, associated_data);
+}
 
-  // Calculate c = hash(k || phi || E1 || E2 || V_k || V_phi || V_E1 || V_E2 || associated_data )
-  Fr _local_c;
-  cybozu::Sha256 digest_engine;
-  digest_engine.update(proof.k.serializeToHexStr());
-  digest_engine.update(proof.phi.serializeToHexStr());
-  digest_engine.update(proof.E1.value().serializeToHexStr());
-  digest_engine.update(proof.E2.value().serializeToHexStr());
-  digest_engine.update(_V_k.serializeToHexStr());
-  digest_engine.update(_V_phi.serializeToHexStr());
-  digest_engine.update(_V_E1.serializeToHexStr());
-  digest_engine.update(_V_E2.serializeToHexStr());
-  auto _c_str = digest_engine.digest(associated_data);
-  _local_c.setHashOf(_c_str);
-  // std::cout << "parepare: V k: " << _V_k.serializeToHexStr() << std::endl;
-  // std::cout << "parepare: V phi: " << _V_phi.serializeToHexStr() << std::endl;
-  // std::cout << "parepare: V E1: " << _V_E1.serializeToHexStr() << std::endl;
-  // std::cout << "parepare: V E2: " << _V_E2.serializeToHexStr() << std::endl;
+template <class Verify>
+bool
+PSVerifier::with_result_cache(const IdProofView& proof,
+                              const std::string& associated_data,
+                              const std::string& service_name,
+                              const G1* authority_pk, const G1* g, const G1* h,
+                              Verify verify) const
+{
+  if (!m_result_cache) {
+    return verify();
+  }
+  auto _key = PSResultCache::digest(proof.data(), proof.size(), associated_data, service_name, authority_pk, g, h);
+  bool _valid;
+  if (!cached_verdict(proof, _key, associated_data, _valid)) {
+    _valid = verify();
+    m_result_cache->insert(_key, _valid);
+  }
+  return _valid;
+}
 
-  if (proof.c != _local_c) {
+bool
+PSVerifier::cached_verdict(const IdProofView& proof, const PSResultCache::Digest& key,
+                           const std::string& associated_data, bool& valid) const
+{
+  if (!m_result_cache->lookup(key, valid)) {
     return false;
   }
+  // an accepted proof seen again is a replay as long as the replay cache remembers it
+  Fr _c;
+  if (valid && m_replay_cache && (!proof.decode_c(_c) || is_replay(_c, associated_data))) {
+    valid = false;
+  }
+  return true;
+}
 
-  // signature verification, e(sigma’_1, k) ?= e(sigma’_2, gg)
-  G2 _final_k = prepare_hybrid_verification(proof.k, proof.attributes);
-  GT lhs, rhs;
-  pairing(lhs, proof.sig1, _final_k);
-  pairing(rhs, proof.sig2, m_pk.gg);
-  return lhs == rhs;
+bool
+PSVerifier::el_passo_verify_id(const IdProofView& proof,
+                               const std::string& associated_data,
+                               const std::string& service_name,
+                               const G1& authority_pk, const G1& g, const G1& h) const
+{
+  return with_result_cache(proof, associated_data, service_name, &authority_pk, &g, &h, [&] {
+    std::vector<size_t> _slots;
+    if (admit_shape(proof.attributes(), proof.used_slots(), proof.rs_size(), proof.has_id_retrieval(), true, _slots)
+        != PSAdmissionStatus::Admitted) {
+      return false;
+    }
+    // decode only what the NIZK proof needs first, the signature only once the proof holds
+    G2 _k;
+    G1 _phi, _E1, _E2;
+    Fr _c;
+    std::vector<Fr> _rs;
+    if (!proof.decode_c(_c) || is_replay(_c, associated_data)) {
+      return false;
+    }
+    if (!proof.decode_rs(_rs) || !proof.decode_k(_k) || !proof.decode_phi(_phi)
+        || !proof.decode_E1(_E1) || !proof.decode_E2(_E2)) {
+      return false;
+    }
+    PSIdRetrievalParams _params{&_E1, &_E2, &authority_pk, &g, &h};
+    if (!nizk_verify_id(proof.version(), _k, _phi, _c, _rs, proof.attributes(), _slots, &_params,
+                        associated_data, service_name)) {
+      return false;
+    }
+
+    // signature verification, e(sigma’_1, k) ?= e(sigma’_2, gg)
+    G1 _sig1, _sig2;
+    if (!proof.decode_sig1(_sig1) || !proof.decode_sig2(_sig2) || _sig1.isZero()) {
+      return false;
+    }
+    G2 _final_k = prepare_hybrid_verification(_k, proof.attributes(), _slots);
+    return ps_pairing_equal(_sig1, _final_k, _sig2, m_key.gg_lines()) && remember(_c, associated_data);
+  });
 }
 
 bool
-PSVerifier::el_passo_verify_id_without_id_retrieval(const IdProof& proof,
+PSVerifier::el_passo_verify_id_without_id_retrieval(const IdProofView& proof,
                                                     const std::string& associated_data,
                                                     const std::string& service_name) const
+{
+  return with_result_cache(proof, associated_data, service_name, nullptr, nullptr, nullptr, [&] {
+    std::vector<size_t> _slots;
+    if (admit_shape(proof.attributes(), proof.used_slots(), proof.rs_size(), proof.has_id_retrieval(), false, _slots)
+        != PSAdmissionStatus::Admitted) {
+      return false;
+    }
+    G2 _k;
+    G1 _phi;
+    Fr _c;
+    std::vector<Fr> _rs;
+    if (!proof.decode_c(_c) || is_replay(_c, associated_data)) {
+      return false;
+    }
+    if (!proof.decode_rs(_rs) || !proof.decode_k(_k) || !proof.decode_phi(_phi)) {
+      return false;
+    }
+    if (!nizk_verify_id(proof.version(), _k, _phi, _c, _rs, proof.attributes(), _slots, nullptr,
+                        associated_data, service_name)) {
+      return false;
+    }
+
+    // signature verification, e(sigma’_1, k) ?= e(sigma’_2, gg)
+    G1 _sig1, _sig2;
+    if (!proof.decode_sig1(_sig1) || !proof.decode_sig2(_sig2) || _sig1.isZero()) {
+      return false;
+    }
+    G2 _final_k = prepare_hybrid_verification(_k, proof.attributes(), _slots);
+    return ps_pairing_equal(_sig1, _final_k, _sig2, m_key.gg_lines()) && remember(_c, associated_data);
+  });
+}
+
+std::vector<bool>
+PSVerifier::batch_verify_id(const std::vector<IdProof>& proofs,
+                            const std::vector<std::string>& associated_data,
+                            const std::string& service_name,
+                            const G1& authority_pk, const G1& g, const G1& h) const
+{
+  if (associated_data.size() != proofs.size()) {
+    throw std::runtime_error("associated data size does not match");
+  }
+  std::vector<bool> results(proofs.size(), false);
+  std::vector<G2> final_ks(proofs.size());
+  std::vector<size_t> candidates;
+  candidates.reserve(proofs.size());
+  for (size_t i = 0; i < proofs.size(); i++) {
+    if (el_passo_prepare_pairing_check(proofs[i], associated_data[i], service_name, &authority_pk, &g, &h,
+                                       final_ks[i])) {
+      candidates.push_back(i);
+    }
+  }
+  batch_pairing_check(proofs, final_ks, candidates, results);
+  for (const auto& i : candidates) {
+    results[i] = results[i] && remember(proofs[i].c, associated_data[i]);
+  }
+  return results;
+}
+
+std::vector<bool>
+PSVerifier::batch_verify_id_without_id_retrieval(const std::vector<IdProof>& proofs,
+                                                 const std::vector<std::string>& associated_data,
+                                                 const std::string& service_name) const
+{
+  if (associated_data.size() != proofs.size()) {
+    throw std::runtime_error("associated data size does not match");
+  }
+  std::vector<bool> results(proofs.size(), false);
+  std::vector<G2> final_ks(proofs.size());
+  std::vector<size_t> candidates;
+  candidates.reserve(proofs.size());
+  for (size_t i = 0; i < proofs.size(); i++) {
+    if (el_passo_prepare_pairing_check(proofs[i], associated_data[i], service_name, nullptr, nullptr, nullptr,
+                                       final_ks[i])) {
+      candidates.push_back(i);
+    }
+  }
+  batch_pairing_check(proofs, final_ks, candidates, results);
+  for (const auto& i : candidates) {
+    results[i] = results[i] && remember(proofs[i].c, associated_data[i]);
+  }
+  return results;
+}
+
+bool
+PSVerifier::el_passo_nizk_verify_id(const IdProof& proof,
+                                    const std::string& associated_data,
+                                    const std::string& service_name,
+                                    const G1& authority_pk, const G1& g, const G1& h,
+                                    std::vector<size_t>& slots) const
+{
+  if (proof.sig1.isZero()
+      || admit_shape(proof.attributes, proof.used_slots, proof.rs.size(), proof.E1.has_value() && proof.E2.has_value(),
+                     true, slots) != PSAdmissionStatus::Admitted) {
+    return false;
+  }
+  PSIdRetrievalParams _params{&proof.E1.value(), &proof.E2.value(), &authority_pk, &g, &h};
+  return nizk_verify_id(proof.version, proof.k, proof.phi, proof.c, proof.rs, proof.attributes, slots,
+                        &_params, associated_data, service_name);
+}
+
+bool
+PSVerifier::el_passo_nizk_verify_id_without_id_retrieval(const IdProof& proof,
+                                                         const std::string& associated_data,
+                                                         const std::string& service_name,
+                                                         std::vector<size_t>& slots) const
+{
+  if (proof.sig1.isZero()
+      || admit_shape(proof.attributes, proof.used_slots, proof.rs.size(), proof.E1.has_value() && proof.E2.has_value(),
+                     false, slots) != PSAdmissionStatus::Admitted) {
+    return false;
+  }
+  return nizk_verify_id(proof.version, proof.k, proof.phi, proof.c, proof.rs, proof.attributes, slots,
+                        nullptr, associated_data, service_name);
+}
+
+bool
+PSVerifier::el_passo_prepare_pairing_check(const IdProof& proof,
+                                           const std::string& associated_data,
+                                           const std::string& service_name,
+                                           const G1* authority_pk, const G1* g, const G1* h,
+                                           G2& final_k) const
+{
+  if (is_replay(proof.c, associated_data)) {
+    return false;
+  }
+  std::vector<size_t> _slots;
+  bool _valid = authority_pk
+      ? el_passo_nizk_verify_id(proof, associated_data, service_name, *authority_pk, *g, *h, _slots)
+      : el_passo_nizk_verify_id_without_id_retrieval(proof, associated_data, service_name, _slots);
+  if (!_valid) {
+    return false;
+  }
+  final_k = prepare_hybrid_verification(proof.k, proof.attributes, _slots);
+  return true;
+}
+
+const char*
+ps_admission_status_message(PSAdmissionStatus status)
+{
+  switch (status) {
+  case PSAdmissionStatus::Admitted:
+    return "admitted";
+  case PSAdmissionStatus::AttributeCountMismatch:
+    return "attribute count does not match the public key";
+  case PSAdmissionStatus::TooFewHiddenAttributes:
+    return "too few hidden attributes";
+  case PSAdmissionStatus::ResponseCountMismatch:
+    return "response count does not match the hidden attributes";
+  case PSAdmissionStatus::MissingIdRetrievalToken:
+    return "missing identity retrieval token";
+  case PSAdmissionStatus::ZeroSignature:
+    return "zero signature";
+  }
+  return "unknown admission error";
+}
+
+PSAdmissionStatus
+PSVerifier::admit(const IdProof& proof, bool with_id_retrieval) const
+{
+  if (proof.sig1.isZero()) {
+    return PSAdmissionStatus::ZeroSignature;
+  }
+  std::vector<size_t> _slots;
+  return admit_shape(proof.attributes, proof.used_slots, proof.rs.size(), proof.E1.has_value() && proof.E2.has_value(),
+                     with_id_retrieval, _slots);
+}
+
+PSAdmissionStatus
+PSVerifier::admit(const IdProofView& proof, bool with_id_retrieval) const
+{
+  std::vector<size_t> _slots;
+  return admit_shape(proof.attributes(), proof.used_slots(), proof.rs_size(), proof.has_id_retrieval(),
+                     with_id_retrieval, _slots);
+}
+
+template <class Attributes>
+PSAdmissionStatus
+PSVerifier::admit_shape(const Attributes& attributes, const std::vector<bool>& used_slots, size_t rs_size,
+                        bool has_id_retrieval, bool with_id_retrieval, std::vector<size_t>& slots) const
+{
+  if (!ps_slot_indexes(used_slots, attributes.size(), m_key.pk().YYi.size(), slots)) {
+    return PSAdmissionStatus::AttributeCountMismatch;
+  }
+  if (with_id_retrieval && !has_id_retrieval) {
+    return PSAdmissionStatus::MissingIdRetrievalToken;
+  }
+  size_t _hidden_num = 0;
+  for (const auto& attribute : attributes) {
+    if (attribute.empty()) {
+      _hidden_num++;
+    }
+  }
+  // rs[0] is the response of s, and rs[1] the one of gamma with id retrieval
+  if (_hidden_num < (with_id_retrieval ? 2 : 1)) {
+    return PSAdmissionStatus::TooFewHiddenAttributes;
+  }
+  // r1_j for each hidden attribute, then r2, then r3 with id retrieval
+  if (rs_size != _hidden_num + (with_id_retrieval ? 2 : 1)) {
+    return PSAdmissionStatus::ResponseCountMismatch;
+  }
+  return PSAdmissionStatus::Admitted;
+}
+
+template <class Attributes>
+bool
+PSVerifier::nizk_verify_id(PSProofVersion version, const G2& k, const G1& phi, const Fr& c,
+                           const std::vector<Fr>& rs, const Attributes& attributes,
+                           const std::vector<size_t>& slots,
+                           const PSIdRetrievalParams* id_retrieval,
+                           const std::string& associated_data,
+                           const std::string& service_name) const
 {
   /** NIZK Verify:
    * Public Value:
    * * k = XX * PI{ YY_j^attribute_j } * gg^t
    * * phi = hash(domain)^s
+   * * E1 = g^epsilon, with id retrieval
+   * * E2 = y^epsilon * h^gamma, with id retrieval
    *
    * Public Random Value:
    * * V_k = XX * PI{ YYj^random1_j } * gg^random_2
    *       = k^c * XX^(1-c) * PI{ YYj^r1_j } * gg^r2
    * * V_phi = hash(domain)^random1_s
    *         = phi^c * hash(domain)^r1_s
+   * * V_E1 = g^random_3, with id retrieval
+   *        = E1^c * g^r3
+   * * V_E2 = y^random_3 * h^random1_gamma, with id retrieval
+   *        = E2^c * y^r3 * h^r1_gamma
    *
    * c: to be compared
-   * c = hash(k || phi || V_k || V_phi || associated_data )
+   * c = hash(k || phi || E1 || E2 || V_k || V_phi || V_E1 || V_E2 || associated_data )
+   * or c = hash(k || phi || V_k || V_phi || associated_data ) without id retrieval
    *
    * Rs:
    * * r1_j: random1_j - attribute_j * c
    * * r2: random2 - t * c
+   * * r3: random3 - epsilon * c, with id retrieval
+   *
+   * The shape of rs and attributes has been checked by admit().
    */
+  // r2 is the last one, or the second last one followed by r3
+  const Fr& _r2 = rs[rs.size() - (id_retrieval ? 2 : 1)];
+
   // V_k = k^c * XX^(1-c) * PI{ YYj^r1_j } * gg^r2
-  G2 _V_k;
-  G2::mul(_V_k, proof.k, proof.c);
+  std::vector<const PSFixedBaseTable<G2>*> _bases;
+  std::vector<Fr> _scalars;
+  _bases.reserve(attributes.size() + 2);
+  _scalars.reserve(attributes.size() + 2);
   int counter = 0;
-  G2 _base_r;
-  for (size_t i = 0; i < proof.attributes.size(); i++) {
-    if (proof.attributes[i] == "") {
-      G2::mul(_base_r, m_pk.YYi[i], proof.rs[counter]);
+  for (size_t i = 0; i < attributes.size(); i++) {
+    if (attributes[i].empty()) {
+      _bases.push_back(&m_key.precomp().YYi[slots[i]]);
+      _scalars.push_back(rs[counter]);
       counter++;
-      G2::add(_V_k, _V_k, _base_r);
     }
   }
-  G2::mul(_base_r, m_pk.gg, proof.rs[proof.rs.size() - 1]);
-  G2::add(_V_k, _V_k, _base_r);
+  _bases.push_back(&m_key.precomp().gg);
+  _scalars.push_back(_r2);
   Fr _1_c = Fr::one();
-  Fr::sub(_1_c, _1_c, proof.c);
-  G2::mul(_base_r, m_pk.XX, _1_c);
-  G2::add(_V_k, _V_k, _base_r);
+  Fr::sub(_1_c, _1_c, c);
+  _bases.push_back(&m_key.precomp().XX);
+  _scalars.push_back(_1_c);
+  G2 _V_k, _k_c;
+  PSFixedBaseTable<G2>::multi_mul(_V_k, _bases, _scalars);
+  G2::mul(_k_c, k, c);
+  G2::add(_V_k, _V_k, _k_c);
 
   // V_phi = phi^c * hash(domain)^r1_s
   G1 _V_phi;
-  G1::mul(_V_phi, proof.phi, proof.c);
+  G1::mul(_V_phi, phi, c);
   G1 _temp;
-  hashAndMapToG1(_temp, service_name);
-  G1::mul(_temp, _temp, proof.rs[0]);
+  service_hash_mul(_temp, service_name, rs[0]);
   G1::add(_V_phi, _V_phi, _temp);
 
-  // Calculate c = hash(k || phi || V_k || V_phi || associated_data )
+  // Calculate c = hash(k || phi || E1 || E2 || V_k || V_phi || V_E1 || V_E2 || associated_data )
+  // or c = hash(k || phi || V_k || V_phi || associated_data ) without id retrieval
   Fr _local_c;
-  cybozu::Sha256 digest_engine;
-  digest_engine.update(proof.k.serializeToHexStr());
-  digest_engine.update(proof.phi.serializeToHexStr());
-  digest_engine.update(_V_k.serializeToHexStr());
-  digest_engine.update(_V_phi.serializeToHexStr());
-  auto _c_str = digest_engine.digest(associated_data);
-  _local_c.setHashOf(_c_str);
+  PSTranscript transcript(version, PS_TRANSCRIPT_PROVE_ID);
+  transcript.append(k);
+  transcript.append(phi);
+  if (id_retrieval) {
+    const Fr& _r3 = rs[rs.size() - 1];
+    G1 _V_E1, _V_E2;
+    // V_E1 = E1^c * g^r3
+    G1::mul(_V_E1, *id_retrieval->E1, c);
+    G1::mul(_temp, *id_retrieval->g, _r3);
+    G1::add(_V_E1, _V_E1, _temp);
+
+    // V_E2 = E2^c * y^r3 * h^r1_gamma
+    G1::mul(_V_E2, *id_retrieval->E2, c);
+    G1::mul(_temp, *id_retrieval->authority_pk, _r3);
+    G1::add(_V_E2, _V_E2, _temp);
+    G1::mul(_temp, *id_retrieval->h, rs[1]);
+    G1::add(_V_E2, _V_E2, _temp);
+
+    transcript.append(*id_retrieval->E1);
+    transcript.append(*id_retrieval->E2);
+    transcript.append(_V_k);
+    transcript.append(_V_phi);
+    transcript.append(_V_E1);
+    transcript.append(_V_E2);
+  }
+  else {
+    transcript.append(_V_k);
+    transcript.append(_V_phi);
+  }
+  transcript.challenge(_local_c, associated_data);
   // std::cout << "parepare: V k: " << _V_k.serializeToHexStr() << std::endl;
   // std::cout << "parepare: V phi: " << _V_phi.serializeToHexStr() << std::endl;
 
-  if (proof.c != _local_c) {
-    return false;
+  return c == _local_c;
+}
+
+void
+PSVerifier::batch_pairing_check(const std::vector<IdProof>& proofs, const std::vector<G2>& final_ks,
+                                const std::vector<size_t>& indexes, std::vector<bool>& results) const
+{
+  if (indexes.empty()) {
+    return;
   }
+  if (indexes.size() == 1) {
+    size_t i = indexes[0];
+    results[i] = ps_pairing_equal(proofs[i].sig1, final_ks[i], proofs[i].sig2, m_key.gg_lines());
+    return;
+  }
+  // PI{ e(sig1_i^rho_i, k_i) } * e(-SUM{ sig2_i^rho_i }, gg) ?= 1 with random small rho_i
+  std::vector<G1> _ps;
+  std::vector<G2> _qs;
+  std::vector<G1> _sig2s;
+  std::vector<Fr> _rhos;
+  _ps.reserve(indexes.size() + 1);
+  _qs.reserve(indexes.size() + 1);
+  _sig2s.reserve(indexes.size());
+  _rhos.reserve(indexes.size());
+  G1 _temp;
+  Fr _rho;
+  for (const auto& i : indexes) {
+    _rho = ps_random_small_exponent();
+    G1::mul(_temp, proofs[i].sig1, _rho);
+    _ps.push_back(_temp);
+    _qs.push_back(final_ks[i]);
+    _sig2s.push_back(proofs[i].sig2);
+    _rhos.push_back(_rho);
+  }
+  G1 _sig2_sum;
+  ps_multi_mul(_sig2_sum, _sig2s, _rhos);
+  G1::neg(_sig2_sum, _sig2_sum);
+  if (ps_pairing_product_is_one(_ps, _qs, _sig2_sum, m_key.gg_lines())) {
+    for (const auto& i : indexes) {
+      results[i] = true;
+    }
+    return;
+  }
+  // at least one signature is invalid, bisect to find out which
+  std::vector<size_t> _left(indexes.begin(), indexes.begin() + indexes.size() / 2);
+  std::vector<size_t> _right(indexes.begin() + indexes.size() / 2, indexes.end());
+  batch_pairing_check(proofs, final_ks, _left, results);
+  batch_pairing_check(proofs, final_ks, _right, results);
+}
 
-  // signature verification, e(sigma’_1, k) ?= e(sigma’_2, gg)
-  G2 _final_k = prepare_hybrid_verification(proof.k, proof.attributes);
-  GT lhs, rhs;
-  pairing(lhs, proof.sig1, _final_k);
-  pairing(rhs, proof.sig2, m_pk.gg);
-  return lhs == rhs;
+void
+PSVerifier::register_service_name(const std::string& service_name)
+{
+  if (m_service_tables.count(service_name) > 0) {
+    return;
+  }
+  G1 _service_hash;
+  hashAndMapToG1(_service_hash, service_name);
+  m_service_tables.emplace(service_name, PSFixedBaseTable<G1>(_service_hash));
+}
+
+void
+PSVerifier::register_disclosed_attribute(size_t index, const std::string& value)
+{
+  if (index >= m_attribute_terms.size()) {
+    throw std::runtime_error("attribute index out of range");
+  }
+  Fr _hash;
+  _hash.setHashOf(value);
+  G2 _term;
+  m_key.precomp().YYi[index].mul(_term, _hash);
+  m_attribute_terms[index][value] = _term;
+}
+
+void
+PSVerifier::set_replay_cache(std::shared_ptr<PSReplayCache> cache)
+{
+  check_cache_lifetimes(cache.get(), m_result_cache.get());
+  m_replay_cache = std::move(cache);
+}
+
+void
+PSVerifier::set_result_cache(std::shared_ptr<PSResultCache> cache)
+{
+  check_cache_lifetimes(m_replay_cache.get(), cache.get());
+  m_result_cache = std::move(cache);
+}
+
+void
+PSVerifier::check_cache_lifetimes(const PSReplayCache* replay_cache, const PSResultCache* result_cache)
+{
+  if (replay_cache && result_cache && result_cache->ttl() > replay_cache->ttl()) {
+    throw std::runtime_error("result cache outlives replay cache");
+  }
+}
+
+bool
+PSVerifier::is_replay(const Fr& c, const std::string& associated_data) const
+{
+  return m_replay_cache && m_replay_cache->contains(c, associated_data);
 }
 
+bool
+PSVerifier::remember(const Fr& c, const std::string& associated_data) const
+{
+  return !m_replay_cache || m_replay_cache->insert(c, associated_data);
+}
+
+void
+PSVerifier::service_hash_mul(G1& z, const std::string& service_name, const Fr& scalar) const
+{
+  auto it = m_service_tables.find(service_name);
+  if (it != m_service_tables.end()) {
+    it->second.mul(z, scalar);
+    return;
+  }
+  G1 _service_hash;
+  hashAndMapToG1(_service_hash, service_name);
+  G1::mul(z, _service_hash, scalar);
+}
+
+template <class Attributes>
 G2
-PSVerifier::prepare_hybrid_verification(const G2& k, const std::vector<std::string>& attributes) const
+PSVerifier::prepare_hybrid_verification(const G2& k, const Attributes& attributes,
+                                        const std::vector<size_t>& slots) const
 {
-  G2 _final_k = k;
-  G2 _temp_yyi_hash;
+  std::vector<const PSFixedBaseTable<G2>*> _bases;
+  std::vector<Fr> _hashes;
+  _bases.reserve(attributes.size());
+  _hashes.reserve(attributes.size());
   Fr _temp_hash;
+  G2 _registered_sum;  // terms of registered values
+  _registered_sum.clear();
   for (size_t i = 0; i < attributes.size(); i++) {
-    if (attributes[i] == "") {
+    if (attributes[i].empty()) {
       continue;
     }
-    _temp_hash.setHashOf(attributes[i]);
-    G2::mul(_temp_yyi_hash, m_pk.YYi[i], _temp_hash);
-    G2::add(_final_k, _final_k, _temp_yyi_hash);
+    const auto& _registered = m_attribute_terms[slots[i]];
+    if (!_registered.empty()) {
+      auto it = _registered.find(attributes[i]);
+      if (it != _registered.end()) {
+        G2::add(_registered_sum, _registered_sum, it->second);
+        continue;
+      }
+    }
+    _temp_hash.setHashOf(attributes[i].data(), attributes[i].size());
+    _bases.push_back(&m_key.precomp().YYi[slots[i]]);
+    _hashes.push_back(_temp_hash);
   }
+  G2 _final_k;
+  PSFixedBaseTable<G2>::multi_mul(_final_k, _bases, _hashes);
+  G2::add(_final_k, _final_k, _registered_sum);
+  G2::add(_final_k, _final_k, k);
   return _final_k;
 }
 
@@ -232,4 +636,35 @@ std::string
 PSVerifier::get_user_name_from_signon_request(const IdProof& proof)
 {
   return proof.phi.getStr();
-}
\ No newline at end of file
+}
+
+// the compressed encoding of phi, hashed to a fixed size key
+static PSAccountId
+account_id(const G1& phi)
+{
+  uint8_t _buf[128];
+  size_t _size = phi.serialize(_buf, sizeof(_buf));
+  if (_size == 0) {
+    throw std::runtime_error("element serialization failed");
+  }
+  PSAccountId _id;
+  cybozu::Sha256().digest(_id.data(), _id.size(), _buf, _size);
+  return _id;
+}
+
+PSAccountId
+PSVerifier::get_user_id_from_signon_request(const IdProof& proof)
+{
+  return account_id(proof.phi);
+}
+
+bool
+PSVerifier::get_user_id_from_signon_request(const IdProofView& proof, PSAccountId& id)
+{
+  G1 _phi;
+  if (!proof.decode_phi(_phi)) {
+    return false;
+  }
+  id = account_id(_phi);
+  return true;
+}
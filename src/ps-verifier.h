@@ -1,10 +1,38 @@
 #ifndef PS_SRC_PS_VERIFIER_H_
 #define PS_SRC_PS_VERIFIER_H_
 
+#include "ps-account-index.h"
 #include "ps-encoding.h"
+#include "ps-pairing.h"
+#include "ps-precomp.h"
+#include "ps-pubkey-handle.h"
+#include "ps-replay-cache.h"
+#include "ps-result-cache.h"
+
+#include <map>
+#include <memory>
+#include <unordered_map>
 
 using namespace mcl::bls12;
 
+/**
+ * @brief Why PSVerifier::admit() rejected the shape of a proof.
+ */
+enum class PSAdmissionStatus : uint8_t {
+  Admitted = 0,
+  AttributeCountMismatch = 1,   // the attributes do not match the slots of the key, see ps_slot_indexes()
+  TooFewHiddenAttributes = 2,   // s, and gamma with id retrieval, must be committed
+  ResponseCountMismatch = 3,    // rs does not hold one response per hidden attribute plus r2 (and r3)
+  MissingIdRetrievalToken = 4,  // E1, E2 are required by el_passo_verify_id()
+  ZeroSignature = 5             // sig1 is the point at infinity
+};
+
+/**
+ * @brief A human-readable description of @p status.
+ */
+const char*
+ps_admission_status_message(PSAdmissionStatus status);
+
 /**
  * The verifier who wants to verify a user's ownership of a PS credential.
  */
@@ -13,10 +41,20 @@ public:
   /**
    * @brief Construct a new PSVerifier object
    *
-   * @param pk The public key of the PSSigner.
+   * @param pk The public key of the PSSigner. Throws std::runtime_error if PSPubKey::validate() fails.
    */
   PSVerifier(const PSPubKey& pk);
 
+  /**
+   * @brief Construct a new PSVerifier object sharing an already validated key and its precomputation.
+   *
+   * One handle per IdP key can back the verifiers of all worker threads. Registered service
+   * names and attribute values stay per verifier.
+   *
+   * @param key The public key of the PSSigner. Throws std::runtime_error if the handle is empty.
+   */
+  PSVerifier(const PSPubKeyHandle& key);
+
   /**
    * @brief Verify the signature over the given attributes (all in plaintext).
    *
@@ -53,6 +91,137 @@ public:
                                           const std::string& associated_data,
                                           const std::string& service_name) const;
 
+  /**
+   * @brief EL PASSO VerifyID over an IdProofView, without decoding the proof into an IdProof.
+   *
+   * The points of the proof are deserialized only when needed: the signature is not decoded
+   * if the NIZK proof does not hold. A malformed element makes the verification fail.
+   */
+  bool
+  el_passo_verify_id(const IdProofView& proof,
+                     const std::string& associated_data,
+                     const std::string& service_name,
+                     const G1& authority_pk, const G1& g, const G1& h) const;
+
+  bool
+  el_passo_verify_id_without_id_retrieval(const IdProofView& proof,
+                                          const std::string& associated_data,
+                                          const std::string& service_name) const;
+
+  /**
+   * @brief Check the shape of a proof against the public key.
+   *
+   * Only sizes and placeholders are compared, in O(attributes) integer work, so a malformed proof is
+   * rejected before any scalar multiplication or pairing. All el_passo_verify_id*() functions run
+   * this check first; it is exposed so that servers can log the reason of a rejection.
+   *
+   * @param proof input The ProveID message generated by a certificate owner.
+   * @param with_id_retrieval input Whether the proof is to be verified with el_passo_verify_id().
+   * @return PSAdmissionStatus::Admitted, or the reason the proof cannot be valid.
+   */
+  PSAdmissionStatus
+  admit(const IdProof& proof, bool with_id_retrieval) const;
+
+  /**
+   * @brief Check the shape of an IdProofView against the public key, without decoding any element.
+   */
+  PSAdmissionStatus
+  admit(const IdProofView& proof, bool with_id_retrieval) const;
+
+  /**
+   * @brief EL PASSO VerifyID over many proofs at once.
+   *
+   * The NIZK proof of each IdProof is checked individually because its challenge commits to
+   * the prover's random values. The PS signature checks of all remaining proofs are then combined
+   * with random small exponents into a single multi-pairing check of N + 1 pairings and one final
+   * exponentiation. If the combined check fails, the set is bisected to find the invalid proofs.
+   *
+   * @param proofs input The ProveID messages generated by certificate owners.
+   * @param associated_data input The associated data bound with each proof, in the same order as @p proofs.
+   * @param service_name input The RP's service name, e.g., RP's domain name.
+   * @param authority_pk input The EL Gamal public key (a G1 point) of an accountability authority.
+   * @param g input A G1 point that both prover and verifier agree on for NIZK of the identity retrieval token
+   * @param h input A G1 point that both prover and verifier agree on for NIZK of the identity retrieval token
+   * @return std::vector<bool> One result per proof, true if the proof at the same index is valid.
+   */
+  std::vector<bool>
+  batch_verify_id(const std::vector<IdProof>& proofs,
+                  const std::vector<std::string>& associated_data,
+                  const std::string& service_name,
+                  const G1& authority_pk, const G1& g, const G1& h) const;
+
+  std::vector<bool>
+  batch_verify_id_without_id_retrieval(const std::vector<IdProof>& proofs,
+                                       const std::vector<std::string>& associated_data,
+                                       const std::string& service_name) const;
+
+  /**
+   * @brief Register an RP service name ahead of verification.
+   *
+   * The service name is hashed to G1 once and a fixed-base table is built for the point,
+   * so that verifying proofs for this service name needs no hash-to-curve and computes
+   * V_phi with a precomputed multiplication. Service names that are not registered are
+   * still accepted and hashed on every verification.
+   *
+   * Registration is not thread-safe; register all service names before sharing the verifier.
+   *
+   * @param service_name input The RP's service name, e.g., RP's domain name.
+   */
+  void
+  register_service_name(const std::string& service_name);
+
+  /**
+   * @brief Register a disclosed attribute value ahead of verification.
+   *
+   * YYi^hash(@p value) is computed once, so that verifying proofs that disclose @p value at
+   * @p index needs neither the hash nor the multiplication for it. Meant for values shared by
+   * many users, e.g., a credential type or an expiration date. Values that are not registered
+   * are still accepted.
+   *
+   * Registration is not thread-safe; register all values before sharing the verifier.
+   *
+   * @param index input The key slot of the attribute. Throws std::runtime_error if out of range.
+   * @param value input The plaintext attribute value.
+   */
+  void
+  register_disclosed_attribute(size_t index, const std::string& value);
+
+  /**
+   * @brief Reject the proofs already accepted within the time to live of @p cache.
+   *
+   * Every el_passo_verify_id*() and batch_verify_id*() call looks up the challenge c and the
+   * associated data of a proof in @p cache before any scalar multiplication or pairing, so a
+   * replayed proof costs a hash lookup, and the proofs found valid are added to @p cache.
+   * If the same proof is verified twice at once, only one of the calls accepts it.
+   * A cache can be shared by several verifiers, e.g., one per worker thread.
+   *
+   * Setting the cache is not thread-safe; set it before sharing the verifier.
+   *
+   * @param cache input The cache, or nullptr to accept replayed proofs. Throws std::runtime_error if
+   *        its time to live is shorter than the time to live of the result cache.
+   */
+  void
+  set_replay_cache(std::shared_ptr<PSReplayCache> cache);
+
+  /**
+   * @brief Answer byte-identical retries of an encoded proof with the verdict of the first try.
+   *
+   * The el_passo_verify_id*() overloads taking an IdProofView look up a digest of the encoded
+   * proof, its associated data, the service name, and the id retrieval parameters in @p cache
+   * before verifying it, and record the verdict afterwards. A cached rejection is served as it is.
+   * A cached acceptance is served only if the replay cache, when set, does not know the proof:
+   * with a replay cache, a retry of an accepted proof is a replay and is rejected without any
+   * curve operation. Proofs verified from an IdProof are not cached. A cache must only be shared
+   * by verifiers of the same public key.
+   *
+   * Setting the cache is not thread-safe; set it before sharing the verifier.
+   *
+   * @param cache input The cache, or nullptr to verify every retry. Throws std::runtime_error if
+   *        its time to live exceeds the time to live of the replay cache.
+   */
+  void
+  set_result_cache(std::shared_ptr<PSResultCache> cache);
+
   /**
    * @brief Get the user name from signon request object.
    *
@@ -62,12 +231,119 @@ public:
   static std::string
   get_user_name_from_signon_request(const IdProof& proof);
 
+  /**
+   * @brief Get the binary user ID from signon request object.
+   *
+   * The ID is the SHA-256 digest of the compressed phi, 32 bytes instead of the decimal string of
+   * get_user_name_from_signon_request(), and the key of a PSAccountIndex.
+   *
+   * @param proof input The ProveID message generated by a certificate owner.
+   * @return PSAccountId The user's ID at RP.
+   */
+  static PSAccountId
+  get_user_id_from_signon_request(const IdProof& proof);
+
+  /**
+   * @brief Get the binary user ID from an IdProofView, decoding only phi.
+   *
+   * @return bool False if phi is not a valid encoding.
+   */
+  static bool
+  get_user_id_from_signon_request(const IdProofView& proof, PSAccountId& id);
+
 private:
+  friend class PSVerificationService;  // runs the stages of el_passo_verify_id() separately
+
+  // the identity retrieval token and its parameters, passed to nizk_verify_id() when id retrieval is on
+  struct PSIdRetrievalParams {
+    const G1* E1;
+    const G1* E2;
+    const G1* authority_pk;
+    const G1* g;
+    const G1* h;
+  };
+
+  // @p slots is set to the key slot of each attribute of @p proof
+  bool
+  el_passo_nizk_verify_id(const IdProof& proof,
+                          const std::string& associated_data,
+                          const std::string& service_name,
+                          const G1& authority_pk, const G1& g, const G1& h,
+                          std::vector<size_t>& slots) const;
+
+  bool
+  el_passo_nizk_verify_id_without_id_retrieval(const IdProof& proof,
+                                               const std::string& associated_data,
+                                               const std::string& service_name,
+                                               std::vector<size_t>& slots) const;
+
+  // the NIZK checks of @p proof, then @p final_k for its signature check; id retrieval is on if @p authority_pk is set
+  bool
+  el_passo_prepare_pairing_check(const IdProof& proof,
+                                 const std::string& associated_data,
+                                 const std::string& service_name,
+                                 const G1* authority_pk, const G1* g, const G1* h,
+                                 G2& final_k) const;
+
+  void
+  batch_pairing_check(const std::vector<IdProof>& proofs, const std::vector<G2>& final_ks,
+                      const std::vector<size_t>& indexes, std::vector<bool>& results) const;
+
+  // Attributes is a vector of std::string or std::string_view
+  template <class Attributes>
+  bool
+  nizk_verify_id(PSProofVersion version, const G2& k, const G1& phi, const Fr& c,
+                 const std::vector<Fr>& rs, const Attributes& attributes,
+                 const std::vector<size_t>& slots,
+                 const PSIdRetrievalParams* id_retrieval,
+                 const std::string& associated_data,
+                 const std::string& service_name) const;
+
+  // @p slots is set to the key slot of each attribute
+  template <class Attributes>
+  PSAdmissionStatus
+  admit_shape(const Attributes& attributes, const std::vector<bool>& used_slots, size_t rs_size,
+              bool has_id_retrieval, bool with_id_retrieval, std::vector<size_t>& slots) const;
+
+  template <class Attributes>
   G2
-  prepare_hybrid_verification(const G2& k, const std::vector<std::string>& attributes) const;
+  prepare_hybrid_verification(const G2& k, const Attributes& attributes, const std::vector<size_t>& slots) const;
+
+  // the verdict of @p proof from the result cache, or verify() whose verdict is then cached
+  template <class Verify>
+  bool
+  with_result_cache(const IdProofView& proof,
+                    const std::string& associated_data,
+                    const std::string& service_name,
+                    const G1* authority_pk, const G1* g, const G1* h,
+                    Verify verify) const;
+
+  // true with the verdict in @p valid if the result cache holds @p key, see set_result_cache()
+  bool
+  cached_verdict(const IdProofView& proof, const PSResultCache::Digest& key,
+                 const std::string& associated_data, bool& valid) const;
+
+  // throws if verdicts would be cached longer than accepted proofs are remembered
+  static void
+  check_cache_lifetimes(const PSReplayCache* replay_cache, const PSResultCache* result_cache);
+
+  // true if a proof with @p c and @p associated_data has been accepted before
+  bool
+  is_replay(const Fr& c, const std::string& associated_data) const;
+
+  // records a valid proof in the replay cache, false if it has been accepted meanwhile
+  bool
+  remember(const Fr& c, const std::string& associated_data) const;
+
+  void
+  service_hash_mul(G1& z, const std::string& service_name, const Fr& scalar) const;
 
 private:
-  PSPubKey m_pk;  // public key
+  PSPubKeyHandle m_key;  // public key and its precomputation, shared
+  std::unordered_map<std::string, PSFixedBaseTable<G1>> m_service_tables;  // hash(service_name) tables
+  std::vector<std::map<std::string, G2, std::less<>>> m_attribute_terms;  // YYi^hash(value) per index
+  std::shared_ptr<PSReplayCache> m_replay_cache;  // proofs accepted before, may be shared
+  std::shared_ptr<PSResultCache> m_result_cache;  // verdicts of encoded proofs, may be shared
 };
 
 #endif  // PS_SRC_PS_VERIFIER_H_
\ No newline at end of file
@@ -5,6 +5,8 @@
 
 #include <chrono>
 #include <iostream>
+#include <thread>
+#include <utility>
 
 using namespace mcl::bls12;
 char m_buf[128];
@@ -81,6 +83,44 @@ test_ps_buffer_encoding()
             << std::endl;
 }
 
+void
+test_concurrent_encoding()
+{
+  std::cout << "****test_concurrent_encoding Start****" << std::endl;
+  G1 g;
+  G2 gg;
+  hashAndMapToG1(g, "abc");
+  hashAndMapToG2(gg, "edf");
+  PSSigner idp(10, g, gg);
+  auto pk = idp.key_gen();
+  auto expected = pk.toBufferString();
+
+  const size_t thread_num = 8;
+  std::vector<char> results(thread_num, true);
+  std::vector<std::thread> threads;
+  for (size_t t = 0; t < thread_num; t++) {
+    threads.emplace_back([&, t] {
+      for (size_t i = 0; i < 200; i++) {
+        if (pk.toBufferString() != expected) {
+          results[t] = false;
+          return;
+        }
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  for (size_t t = 0; t < thread_num; t++) {
+    if (!results[t]) {
+      std::cout << "test_concurrent_encoding failure" << std::endl;
+      return;
+    }
+  }
+  std::cout << "****test_concurrent_encoding ends without errors****\n"
+            << std::endl;
+}
+
 void
 test_pk_with_different_attr_num()
 {
@@ -117,6 +157,53 @@ test_pk_with_different_attr_num()
             << std::endl;
 }
 
+void
+test_pk_validation()
+{
+  std::cout << "****test_pk_validation Start****" << std::endl;
+  G1 g;
+  G2 gg;
+  hashAndMapToG1(g, "abc");
+  hashAndMapToG2(gg, "edf");
+  PSSigner idp(20, g, gg);
+  auto buffer = idp.key_gen().toBufferString();
+
+  PSPubKey pk = PSPubKey::fromBufferString(buffer);
+  if (pk.is_validated() || !pk.validate()) {
+    std::cout << "valid public key failed validation" << std::endl;
+    return;
+  }
+  PSPubKey cached = pk;
+  if (!cached.is_validated()) {
+    std::cout << "validated flag is not kept by a copy" << std::endl;
+    return;
+  }
+
+  // Yi[i] and YYi[i] with different exponents
+  PSPubKey swapped = PSPubKey::fromBufferString(buffer);
+  std::swap(swapped.YYi[3], swapped.YYi[7]);
+  if (swapped.validate()) {
+    std::cout << "public key with mismatched Yi and YYi passed validation" << std::endl;
+    return;
+  }
+  PSPubKey zero = PSPubKey::fromBufferString(buffer);
+  zero.Yi[0].clear();
+  zero.YYi[0].clear();
+  if (zero.validate()) {
+    std::cout << "public key with a zero point passed validation" << std::endl;
+    return;
+  }
+  try {
+    PSVerifier rp(swapped);
+    std::cout << "PSVerifier accepted an invalid public key" << std::endl;
+    return;
+  }
+  catch (const std::runtime_error&) {
+  }
+  std::cout << "****test_pk_validation ends without errors****\n"
+            << std::endl;
+}
+
 void
 test_ps_sign_verify()
 {
@@ -134,7 +221,8 @@ test_ps_sign_verify()
   attributes.push_back(std::make_tuple("secret1", true));
   attributes.push_back(std::make_tuple("secret2", true));
   attributes.push_back(std::make_tuple("plain1", false));
-  auto request = user.el_passo_request_id(attributes, "hello");
+  auto session = user.el_passo_request_id(attributes, "hello");
+  auto request = session.request;
   request = PSCredRequest::fromBufferString(request.toBufferString());
 
   PSCredential sig;
@@ -144,7 +232,7 @@ test_ps_sign_verify()
   }
   sig = PSCredential::fromBufferString(sig.toBufferString());
 
-  auto ubld_sig = user.unblind_credential(sig);
+  auto ubld_sig = user.unblind_credential(sig, session);
   std::vector<std::string> all_attributes;
   all_attributes.push_back("secret1");
   all_attributes.push_back("secret2");
@@ -163,6 +251,59 @@ test_ps_sign_verify()
             << std::endl;
 }
 
+void
+test_secret_key()
+{
+  std::cout << "****test_secret_key Start****" << std::endl;
+  G1 g;
+  G2 gg;
+  hashAndMapToG1(g, "abc");
+  hashAndMapToG2(gg, "edf");
+  PSSigner idp(3, g, gg);
+  auto pubKey = idp.key_gen();
+
+  // a signer restored from the encoded key issues credentials under the same public key
+  auto sk = PSSecretKey::fromBufferString(idp.get_secret_key().toBufferString());
+  PSSigner restored(sk);
+  if (restored.get_pub_key().XX != pubKey.XX || restored.get_pub_key().YYi != pubKey.YYi) {
+    std::cout << "restored public key mismatch" << std::endl;
+    return;
+  }
+  PSRequester user(pubKey);
+  std::vector<std::tuple<std::string, bool>> attributes;
+  attributes.push_back(std::make_tuple("secret1", true));
+  attributes.push_back(std::make_tuple("secret2", true));
+  attributes.push_back(std::make_tuple("plain1", false));
+  auto session = user.el_passo_request_id(attributes, "hello");
+  PSCredential sig;
+  if (!restored.el_passo_provide_id(session.request, "hello", sig)
+      || !user.verify(user.unblind_credential(sig, session), {"secret1", "secret2", "plain1"})) {
+    std::cout << "restored signer issued an invalid credential" << std::endl;
+    return;
+  }
+
+  // a private key is rejected with another public key
+  PSSigner other(3, g, gg);
+  auto mismatched = sk;
+  mismatched.pk = other.key_gen();
+  bool rejected = false;
+  try {
+    PSSigner wrong(mismatched);
+  }
+  catch (std::runtime_error&) {
+    rejected = true;
+  }
+  PSSecretKey decoded;
+  auto buffer = sk.toBufferString();
+  buffer.pop_back();
+  if (!rejected || PSSecretKey::tryFromBufferString(buffer, decoded) != PSDecodeStatus::Truncated) {
+    std::cout << "invalid secret key accepted" << std::endl;
+    return;
+  }
+  std::cout << "****test_secret_key ends without errors****\n"
+            << std::endl;
+}
+
 void
 test_el_passo(size_t total_attribute_num)
 {
@@ -194,7 +335,8 @@ test_el_passo(size_t total_attribute_num)
     attributes.push_back(std::make_tuple("s-new", true));
   }
   begin = std::chrono::steady_clock::now();
-  auto request = user.el_passo_request_id(attributes, "hello");
+  auto session = user.el_passo_request_id(attributes, "hello");
+  auto request = session.request;
   end = std::chrono::steady_clock::now();
   std::cout << "User-RequestID: "
             << std::chrono::duration_cast<std::chrono::microseconds>(end - begin).count()
@@ -221,7 +363,7 @@ test_el_passo(size_t total_attribute_num)
   // User-UnblindID
   sig = PSCredential::fromBufferString(sig.toBufferString());
   begin = std::chrono::steady_clock::now();
-  auto ubld_sig = user.unblind_credential(sig);
+  auto ubld_sig = user.unblind_credential(sig, session);
   end = std::chrono::steady_clock::now();
   std::cout << "User-UnblindID: "
             << std::chrono::duration_cast<std::chrono::microseconds>(end - begin).count()
@@ -269,13 +411,386 @@ test_el_passo(size_t total_attribute_num)
             << std::endl;
 }
 
+void
+test_proof_versions()
+{
+  std::cout << "****test_proof_versions Start****" << std::endl;
+  G1 g;
+  G2 gg;
+  hashAndMapToG1(g, "abc");
+  hashAndMapToG2(gg, "edf");
+  PSSigner idp(3, g, gg);
+  auto pk = idp.key_gen();
+  PSRequester user(pk);
+  std::vector<std::tuple<std::string, bool>> attributes;
+  attributes.push_back(std::make_tuple("s", true));
+  attributes.push_back(std::make_tuple("gamma", true));
+  attributes.push_back(std::make_tuple("tp", false));
+  auto session = user.el_passo_request_id(attributes, "hello");
+  auto request = PSCredRequest::fromBufferString(session.request.toBufferString());
+  if (request.version != PSProofVersion::Current) {
+    std::cout << "PSCredRequest version is not kept by encoding" << std::endl;
+    return;
+  }
+  PSCredential sig;
+  if (!idp.el_passo_provide_id(request, "hello", sig)) {
+    std::cout << "sign request failure" << std::endl;
+    return;
+  }
+  auto ubld_sig = user.unblind_credential(sig, session);
+
+  G1 authority_pk;
+  G1 h;
+  hashAndMapToG1(authority_pk, "ghi");
+  hashAndMapToG1(h, "jkl");
+  PSVerifier rp(pk);
+
+  // a proof in the format before versioning has no version element and still verifies
+  auto token = user.el_passo_precompute_prove_id(ubld_sig, attributes, authority_pk, g, h);
+  auto legacy_buffer = user.el_passo_prove_id(std::move(token), "hello", "service", PSProofVersion::HexTranscript).toBufferString();
+  if (legacy_buffer[0] != static_cast<uint8_t>(PSEncodingType::G1)) {
+    std::cout << "HexTranscript proof is encoded with a version" << std::endl;
+    return;
+  }
+  auto legacy = IdProof::fromBufferString(legacy_buffer);
+  if (legacy.version != PSProofVersion::HexTranscript
+      || !rp.el_passo_verify_id(legacy, "hello", "service", authority_pk, g, h)) {
+    std::cout << "EL PASSO Verify ID of a HexTranscript proof failed" << std::endl;
+    return;
+  }
+
+  // the version is bound to the challenge
+  token = user.el_passo_precompute_prove_id_without_id_retrieval(ubld_sig, attributes);
+  auto proof = IdProof::fromBufferString(user.el_passo_prove_id(std::move(token), "hello", "service").toBufferString());
+  if (proof.version != PSProofVersion::BinaryTranscript
+      || !rp.el_passo_verify_id_without_id_retrieval(proof, "hello", "service")) {
+    std::cout << "EL PASSO Verify ID of a BinaryTranscript proof failed" << std::endl;
+    return;
+  }
+  proof.version = PSProofVersion::HexTranscript;
+  if (rp.el_passo_verify_id_without_id_retrieval(proof, "hello", "service")) {
+    std::cout << "EL PASSO Verify ID accepted a proof with a wrong version" << std::endl;
+    return;
+  }
+
+  // unknown versions are rejected by the decoder
+  proof.version = PSProofVersion::BinaryTranscript;
+  auto buffer = proof.toBufferString();
+  buffer[1] = 0x7F;
+  try {
+    IdProof::fromBufferString(buffer);
+    std::cout << "IdProof with an unknown version is decoded" << std::endl;
+    return;
+  }
+  catch (const std::runtime_error&) {
+  }
+  std::cout << "****test_proof_versions ends without errors****\n"
+            << std::endl;
+}
+
+void
+test_id_proof_view()
+{
+  std::cout << "****test_id_proof_view Start****" << std::endl;
+  G1 g;
+  G2 gg;
+  hashAndMapToG1(g, "abc");
+  hashAndMapToG2(gg, "edf");
+  PSSigner idp(4, g, gg);
+  auto pk = idp.key_gen();
+  PSRequester user(pk);
+  std::vector<std::tuple<std::string, bool>> attributes;
+  attributes.push_back(std::make_tuple("s", true));
+  attributes.push_back(std::make_tuple("gamma", true));
+  attributes.push_back(std::make_tuple("tp", false));
+  attributes.push_back(std::make_tuple("email", false));
+  auto session = user.el_passo_request_id(attributes, "hello");
+  PSCredential sig;
+  if (!idp.el_passo_provide_id(session.request, "hello", sig)) {
+    std::cout << "sign request failure" << std::endl;
+    return;
+  }
+  auto ubld_sig = user.unblind_credential(sig, session);
+  G1 authority_pk;
+  G1 h;
+  hashAndMapToG1(authority_pk, "ghi");
+  hashAndMapToG1(h, "jkl");
+  PSVerifier rp(pk);
+
+  auto proof = user.el_passo_prove_id(ubld_sig, attributes, "hello", "service", authority_pk, g, h);
+  auto buffer = proof.toBufferString();
+  IdProofView view(buffer);
+  if (!view.has_id_retrieval() || view.attributes().size() != 4
+      || !view.attributes()[0].empty() || view.attributes()[3] != "email") {
+    std::cout << "IdProofView attributes mismatch" << std::endl;
+    return;
+  }
+  auto decoded = view.to_id_proof();
+  if (decoded.sig1 != proof.sig1 || decoded.k != proof.k || decoded.rs != proof.rs || decoded.E2 != proof.E2) {
+    std::cout << "IdProofView decoding mismatch" << std::endl;
+    return;
+  }
+  if (!rp.el_passo_verify_id(view, "hello", "service", authority_pk, g, h)) {
+    std::cout << "EL PASSO Verify ID over IdProofView failed" << std::endl;
+    return;
+  }
+  if (rp.el_passo_verify_id(view, "other", "service", authority_pk, g, h)) {
+    std::cout << "EL PASSO Verify ID over IdProofView accepted other associated data" << std::endl;
+    return;
+  }
+
+  auto proof2 = user.el_passo_prove_id_without_id_retrieval(ubld_sig, attributes, "hello", "service");
+  auto buffer2 = proof2.toBufferString();
+  IdProofView view2(buffer2.data(), buffer2.size());
+  if (view2.has_id_retrieval() || !rp.el_passo_verify_id_without_id_retrieval(view2, "hello", "service")) {
+    std::cout << "EL PASSO Verify ID without id retrieval over IdProofView failed" << std::endl;
+    return;
+  }
+
+  // a disclosed attribute changed in the buffer breaks the signature check
+  buffer2[buffer2.size() - 1] ^= 1;
+  if (rp.el_passo_verify_id_without_id_retrieval(IdProofView(buffer2), "hello", "service")) {
+    std::cout << "EL PASSO Verify ID over a modified IdProofView passed" << std::endl;
+    return;
+  }
+
+  // a truncated buffer is rejected while parsing
+  try {
+    IdProofView truncated(buffer.data(), buffer.size() / 2);
+    std::cout << "IdProofView parsed a truncated buffer" << std::endl;
+    return;
+  }
+  catch (const std::runtime_error&) {
+  }
+  std::cout << "****test_id_proof_view ends without errors****\n"
+            << std::endl;
+}
+
+void
+test_uncompressed_encoding()
+{
+  std::cout << "****test_uncompressed_encoding Start****" << std::endl;
+  G1 g;
+  G2 gg;
+  hashAndMapToG1(g, "abc");
+  hashAndMapToG2(gg, "edf");
+  PSSigner idp(3, g, gg);
+  auto pk = idp.key_gen();
+  auto pk_buffer = pk.toUncompressedBufferString();
+  std::cout << "Public Key size, compressed: " << pk.toBufferString().size()
+            << ", uncompressed: " << pk_buffer.size() << std::endl;
+  auto decoded_pk = PSPubKey::fromBufferString(pk_buffer);
+  if (pk_buffer.size() <= pk.toBufferString().size()
+      || decoded_pk.g != pk.g || decoded_pk.XX != pk.XX || decoded_pk.Yi != pk.Yi || decoded_pk.YYi != pk.YYi) {
+    std::cout << "uncompressed PSPubKey decoding mismatch" << std::endl;
+    return;
+  }
+
+  PSRequester user(decoded_pk);
+  std::vector<std::tuple<std::string, bool>> attributes;
+  attributes.push_back(std::make_tuple("s", true));
+  attributes.push_back(std::make_tuple("gamma", true));
+  attributes.push_back(std::make_tuple("tp", false));
+  auto session = user.el_passo_request_id(attributes, "hello");
+  auto request = PSCredRequest::fromBufferString(session.request.toUncompressedBufferString());
+  PSCredential sig;
+  if (request.A != session.request.A || !idp.el_passo_provide_id(request, "hello", sig)) {
+    std::cout << "uncompressed PSCredRequest decoding mismatch" << std::endl;
+    return;
+  }
+  sig = PSCredential::fromBufferString(sig.toUncompressedBufferString());
+  auto ubld_sig = user.unblind_credential(sig, session);
+
+  G1 authority_pk;
+  G1 h;
+  hashAndMapToG1(authority_pk, "ghi");
+  hashAndMapToG1(h, "jkl");
+  PSVerifier rp(decoded_pk);
+  auto proof_buffer = user.el_passo_prove_id(ubld_sig, attributes, "hello", "service", authority_pk, g, h).toUncompressedBufferString();
+  auto proof = IdProof::fromBufferString(proof_buffer);
+  if (!rp.el_passo_verify_id(proof, "hello", "service", authority_pk, g, h)
+      || !rp.el_passo_verify_id(IdProofView(proof_buffer), "hello", "service", authority_pk, g, h)) {
+    std::cout << "EL PASSO Verify ID of an uncompressed IdProof failed" << std::endl;
+    return;
+  }
+  std::cout << "****test_uncompressed_encoding ends without errors****\n"
+            << std::endl;
+}
+
+void
+test_decode_status()
+{
+  std::cout << "****test_decode_status Start****" << std::endl;
+  G1 g;
+  G2 gg;
+  hashAndMapToG1(g, "abc");
+  hashAndMapToG2(gg, "edf");
+  PSSigner idp(2, g, gg);
+  auto pk = idp.key_gen();
+  PSRequester user(pk);
+  std::vector<std::tuple<std::string, bool>> attributes;
+  attributes.push_back(std::make_tuple("s", true));
+  attributes.push_back(std::make_tuple("tp", false));
+  auto session = user.el_passo_request_id(attributes, "hello");
+  PSCredential sig;
+  idp.el_passo_provide_id(session.request, "hello", sig);
+  auto ubld_sig = user.unblind_credential(sig, session);
+  G1 authority_pk;
+  G1 h;
+  hashAndMapToG1(authority_pk, "ghi");
+  hashAndMapToG1(h, "jkl");
+  auto buffer = user.el_passo_prove_id(ubld_sig, attributes, "hello", "service", authority_pk, g, h).toBufferString();
+
+  IdProof proof;
+  if (IdProof::tryFromBufferString(buffer, proof) != PSDecodeStatus::Ok) {
+    std::cout << "tryFromBufferString rejected a valid IdProof" << std::endl;
+    return;
+  }
+
+  // every truncation is rejected without an exception, and leaves the output untouched
+  for (size_t size = 0; size < buffer.size(); size++) {
+    PSBuffer truncated;
+    truncated.insert(truncated.end(), buffer.begin(), buffer.begin() + size);
+    IdProof out = proof;
+    IdProofView view;
+    // the proof without E1, E2 is still a valid proof
+    bool expected_ok = size == buffer.size() - 2 * (2 + Fp::getByteSize());
+    if ((IdProof::tryFromBufferString(truncated, out) == PSDecodeStatus::Ok) != expected_ok
+        || (IdProofView::parse(truncated.data(), truncated.size(), view) == PSDecodeStatus::Ok) != expected_ok
+        || (!expected_ok && out.c != proof.c)) {
+      std::cout << "truncated IdProof of " << size << " bytes is not rejected" << std::endl;
+      return;
+    }
+  }
+
+  auto expect = [&](const PSBuffer& buf, PSDecodeStatus status, const char* what) {
+    IdProof out;
+    if (IdProof::tryFromBufferString(buf, out) != status) {
+      std::cout << what << " is not rejected with " << ps_decode_status_message(status) << std::endl;
+      return false;
+    }
+    return true;
+  };
+  // version, then the type of sig1
+  PSBuffer tampered = buffer;
+  tampered[1] = 0x7F;
+  if (!expect(tampered, PSDecodeStatus::UnsupportedVersion, "unknown version")) {
+    return;
+  }
+  tampered = buffer;
+  tampered[2] = static_cast<uint8_t>(PSEncodingType::Fr);
+  if (!expect(tampered, PSDecodeStatus::UnexpectedType, "wrong element type")) {
+    return;
+  }
+  tampered = buffer;
+  tampered[3] -= 1;
+  if (!expect(tampered, PSDecodeStatus::BadLength, "wrong point length")) {
+    return;
+  }
+  tampered = buffer;
+  tampered.push_back(0);
+  if (!expect(tampered, PSDecodeStatus::TrailingBytes, "trailing byte")) {
+    return;
+  }
+  tampered = buffer;
+  std::fill(tampered.begin() + 4, tampered.begin() + 4 + Fp::getByteSize(), 0xFF);
+  if (!expect(tampered, PSDecodeStatus::InvalidElement, "invalid point")) {
+    return;
+  }
+  try {
+    PSPubKey::fromBufferString(tampered);
+    std::cout << "PSPubKey decoded from an IdProof buffer" << std::endl;
+    return;
+  }
+  catch (const std::runtime_error&) {
+  }
+
+  // the other messages
+  PSPubKey decoded_pk;
+  PSCredRequest decoded_request;
+  PSCredential decoded_sig;
+  auto pk_buffer = pk.toBufferString();
+  auto request_buffer = session.request.toBufferString();
+  auto sig_buffer = sig.toBufferString();
+  if (PSPubKey::tryFromBufferString(pk_buffer, decoded_pk) != PSDecodeStatus::Ok || decoded_pk.YYi != pk.YYi
+      || PSCredRequest::tryFromBufferString(request_buffer, decoded_request) != PSDecodeStatus::Ok
+      || decoded_request.A != session.request.A
+      || PSCredential::tryFromBufferString(sig_buffer, decoded_sig) != PSDecodeStatus::Ok || decoded_sig.sig2 != sig.sig2) {
+    std::cout << "tryFromBufferString rejected a valid message" << std::endl;
+    return;
+  }
+  pk_buffer.pop_back();
+  request_buffer.pop_back();
+  sig_buffer.pop_back();
+  if (PSPubKey::tryFromBufferString(pk_buffer, decoded_pk) != PSDecodeStatus::Truncated
+      || PSCredRequest::tryFromBufferString(request_buffer, decoded_request) != PSDecodeStatus::Truncated
+      || PSCredential::tryFromBufferString(sig_buffer, decoded_sig) != PSDecodeStatus::Truncated) {
+    std::cout << "truncated message is not rejected" << std::endl;
+    return;
+  }
+  std::cout << "****test_decode_status ends without errors****\n"
+            << std::endl;
+}
+
+void
+test_slot_bitmap()
+{
+  std::cout << "****test_slot_bitmap Start****" << std::endl;
+  std::vector<bool> slots(19, false);
+  slots[0] = slots[7] = slots[8] = slots[18] = true;
+  PSBuffer buffer;
+  buffer.appendSlotBitmap(slots);
+  std::vector<bool> newSlots;
+  if (buffer.size() != 1 + 1 + 3 || buffer.parseSlotBitmap(0, newSlots) != buffer.size() || newSlots != slots) {
+    std::cout << "slot bitmap encoding mismatch" << std::endl;
+    return;
+  }
+  std::vector<size_t> indexes;
+  if (!ps_slot_indexes(slots, 4, 19, indexes) || indexes != std::vector<size_t>{0, 7, 8, 18}
+      || ps_slot_indexes(slots, 3, 19, indexes) || ps_slot_indexes(slots, 4, 20, indexes)
+      || !ps_slot_indexes(std::vector<bool>(), 3, 3, indexes) || indexes != std::vector<size_t>{0, 1, 2}) {
+    std::cout << "ps_slot_indexes mismatch" << std::endl;
+    return;
+  }
+
+  // the bitmap sits before the attributes, and a set padding bit is rejected
+  PSCredRequest request;
+  hashAndMapToG1(request.A, "abc");
+  request.rs.resize(2);
+  request.attributes = {"", "a", "b", ""};
+  request.used_slots = slots;
+  auto encoded = request.toBufferString();
+  PSCredRequest decoded;
+  if (PSCredRequest::tryFromBufferString(encoded, decoded) != PSDecodeStatus::Ok || decoded.used_slots != slots
+      || decoded.attributes != request.attributes) {
+    std::cout << "PSCredRequest with slots decoding mismatch" << std::endl;
+    return;
+  }
+  // the last byte of the bitmap comes before the 8 bytes of the attribute list
+  encoded[encoded.size() - 9] |= 0x80;
+  if (PSCredRequest::tryFromBufferString(encoded, decoded) != PSDecodeStatus::BadLength) {
+    std::cout << "slot bitmap with a padding bit is decoded" << std::endl;
+    return;
+  }
+  std::cout << "****test_slot_bitmap ends without errors****\n"
+            << std::endl;
+}
+
 int
 main(int argc, char const *argv[])
 {
   initPairing();
   test_ps_buffer_encoding();
+  test_concurrent_encoding();
   test_pk_with_different_attr_num();
+  test_pk_validation();
   test_ps_sign_verify();
+  test_secret_key();
   test_el_passo(3);
   test_el_passo(4);
+  test_proof_versions();
+  test_id_proof_view();
+  test_uncompressed_encoding();
+  test_decode_status();
+  test_slot_bitmap();
 }
@@ -1,12 +1,176 @@
+#include <ps-issuance-socket.h>
+#include <ps-msm.h>
+#include <ps-precomp.h>
 #include <ps-requester.h>
 #include <ps-signer.h>
+#include <ps-token-pool.h>
+#include <ps-verification-socket.h>
 #include <ps-verifier.h>
 
+#include <atomic>
 #include <chrono>
 #include <iostream>
+#include <optional>
+#include <thread>
+#include <utility>
+
+#include <fcntl.h>
+#include <unistd.h>
 
 using namespace mcl::bls12;
 
+// a user holding a credential over s, gamma (committed) and tp (disclosed), issued under a 3-slot key,
+// and the parameters of its identity retrieval token
+struct TestCredential {
+  G1 g;
+  G1 authority_pk;
+  G1 h;
+  PSPubKey pk;
+  PSRequester user;
+  std::vector<std::tuple<std::string, bool>> attributes;
+  PSCredential credential;  // unblinded
+
+  IdProof
+  prove(const std::string& associated_data, const std::string& service_name) const
+  {
+    return user.el_passo_prove_id(credential, attributes, associated_data, service_name,
+                                  authority_pk, g, h);
+  }
+
+  IdProof
+  prove_without_id_retrieval(const std::string& associated_data, const std::string& service_name) const
+  {
+    return user.el_passo_prove_id_without_id_retrieval(credential, attributes,
+                                                       associated_data, service_name);
+  }
+
+  // PSVerifier::el_passo_verify_id() of an IdProof or an IdProofView with the parameters above
+  template <typename Proof>
+  bool
+  verify(const PSVerifier& rp, const Proof& proof, const std::string& associated_data,
+         const std::string& service_name) const
+  {
+    return rp.el_passo_verify_id(proof, associated_data, service_name, authority_pk, g, h);
+  }
+};
+
+static std::optional<TestCredential>
+issue_test_credential()
+{
+  G1 g, authority_pk, h;
+  G2 gg;
+  hashAndMapToG1(g, "abc");
+  hashAndMapToG2(gg, "edf");
+  hashAndMapToG1(authority_pk, "ghi");
+  hashAndMapToG1(h, "jkl");
+  PSSigner idp(3, g, gg);
+  auto pubKey = idp.key_gen();
+
+  PSRequester user(pubKey);
+  std::vector<std::tuple<std::string, bool>> attributes;
+  attributes.push_back(std::make_tuple("s", true));
+  attributes.push_back(std::make_tuple("gamma", true));
+  attributes.push_back(std::make_tuple("tp", false));
+  auto session = user.el_passo_request_id(attributes, "hello");
+  PSCredential sig;
+  if (!idp.el_passo_provide_id(session.request, "hello", sig)) {
+    std::cout << "sign request failure" << std::endl;
+    return std::nullopt;
+  }
+  auto ubld_sig = user.unblind_credential(sig, session);
+  return TestCredential{g, authority_pk, h, pubKey, user, attributes, ubld_sig};
+}
+
+void
+test_fixed_base_table()
+{
+  std::cout << "****test_fixed_base_table Start****" << std::endl;
+  G1 g;
+  G2 gg;
+  hashAndMapToG1(g, "abc");
+  hashAndMapToG2(gg, "edf");
+  for (size_t window_bits = 1; window_bits <= 8; window_bits++) {
+    PSFixedBaseTable<G1> g_table(g, window_bits);
+    PSFixedBaseTable<G2> gg_table(gg, window_bits);
+    Fr scalar;
+    G1 expected1, result1;
+    G2 expected2, result2;
+    for (size_t i = 0; i < 10; i++) {
+      scalar.setByCSPRNG();
+      G1::mul(expected1, g, scalar);
+      g_table.mul(result1, scalar);
+      G2::mul(expected2, gg, scalar);
+      gg_table.mul(result2, scalar);
+      if (expected1 != result1 || expected2 != result2) {
+        std::cout << "fixed-base multiplication failure with window " << window_bits << std::endl;
+        return;
+      }
+    }
+    g_table.mul(result1, Fr(0));
+    if (!result1.isZero()) {
+      std::cout << "fixed-base multiplication by zero failure" << std::endl;
+      return;
+    }
+  }
+  std::cout << "****test_fixed_base_table ends without errors****\n"
+            << std::endl;
+}
+
+void
+test_multi_mul()
+{
+  std::cout << "****test_multi_mul Start****" << std::endl;
+  size_t sizes[] = {0, 1, 2, 5, 60};
+  for (const auto& n : sizes) {
+    std::vector<G1> bases1;
+    std::vector<G2> bases2;
+    std::vector<PSFixedBaseTable<G1>> tables1;
+    std::vector<PSFixedBaseTable<G2>> tables2;
+    std::vector<Fr> scalars;
+    G1 expected1, temp1;
+    G2 expected2, temp2;
+    expected1.clear();
+    expected2.clear();
+    for (size_t i = 0; i < n; i++) {
+      hashAndMapToG1(temp1, "g1-" + std::to_string(i));
+      hashAndMapToG2(temp2, "g2-" + std::to_string(i));
+      bases1.push_back(temp1);
+      bases2.push_back(temp2);
+      tables1.emplace_back(temp1);
+      tables2.emplace_back(temp2);
+      Fr scalar;
+      scalar.setByCSPRNG();
+      scalars.push_back(scalar);
+      G1::mul(temp1, temp1, scalar);
+      G1::add(expected1, expected1, temp1);
+      G2::mul(temp2, temp2, scalar);
+      G2::add(expected2, expected2, temp2);
+    }
+    std::vector<const PSFixedBaseTable<G1>*> table_ptrs1;
+    std::vector<const PSFixedBaseTable<G2>*> table_ptrs2;
+    for (size_t i = 0; i < n; i++) {
+      table_ptrs1.push_back(&tables1[i]);
+      table_ptrs2.push_back(&tables2[i]);
+    }
+    G1 result1;
+    G2 result2;
+    ps_multi_mul(result1, bases1, scalars);
+    ps_multi_mul(result2, bases2, scalars);
+    if (result1 != expected1 || result2 != expected2) {
+      std::cout << "multi-scalar multiplication failure over " << n << " bases" << std::endl;
+      return;
+    }
+    PSFixedBaseTable<G1>::multi_mul(result1, table_ptrs1, scalars);
+    PSFixedBaseTable<G2>::multi_mul(result2, table_ptrs2, scalars);
+    if (result1 != expected1 || result2 != expected2) {
+      std::cout << "fixed-base multi-scalar multiplication failure over " << n << " bases" << std::endl;
+      return;
+    }
+  }
+  std::cout << "****test_multi_mul ends without errors****\n"
+            << std::endl;
+}
+
 void
 test_ps_sign_verify()
 {
@@ -23,7 +187,8 @@ test_ps_sign_verify()
   attributes.push_back(std::make_tuple("secret1", true));
   attributes.push_back(std::make_tuple("secret2", true));
   attributes.push_back(std::make_tuple("plain1", false));
-  auto request = user.el_passo_request_id(attributes, "hello");
+  auto session = user.el_passo_request_id(attributes, "hello");
+  auto request = session.request;
 
   PSCredential sig;
   if (!idp.el_passo_provide_id(request, "hello", sig)) {
@@ -31,7 +196,7 @@ test_ps_sign_verify()
     return;
   }
 
-  auto ubld_sig = user.unblind_credential(sig);
+  auto ubld_sig = user.unblind_credential(sig, session);
   std::vector<std::string> all_attributes;
   all_attributes.push_back("secret1");
   all_attributes.push_back("secret2");
@@ -46,10 +211,106 @@ test_ps_sign_verify()
     std::cout << "randomized credential verification failure" << std::endl;
     return;
   }
+
+  all_attributes[2] = "plain2";
+  if (user.verify(rand_sig, all_attributes)) {
+    std::cout << "credential over wrong attributes passed verification" << std::endl;
+    return;
+  }
   std::cout << "****test_ps_sign_verify ends without errors****\n"
             << std::endl;
 }
 
+void
+test_provide_id_batch(size_t request_num)
+{
+  std::cout << "****test_provide_id_batch Start****" << std::endl;
+  G1 g;
+  G2 gg;
+  hashAndMapToG1(g, "abc");
+  hashAndMapToG2(gg, "edf");
+  PSSigner idp(3, g, gg);
+  auto pubKey = idp.key_gen();
+
+  PSRequester user(pubKey);
+  std::vector<std::tuple<std::string, bool>> attributes;
+  attributes.push_back(std::make_tuple("s", true));
+  attributes.push_back(std::make_tuple("gamma", true));
+  attributes.push_back(std::make_tuple("tp", false));
+  std::vector<PSIssuanceSession> sessions;
+  std::vector<PSCredRequest> requests;
+  std::vector<std::string> associated_data;
+  for (size_t i = 0; i < request_num; i++) {
+    associated_data.push_back("hello-" + std::to_string(i));
+    sessions.push_back(user.el_passo_request_id(attributes, associated_data[i]));
+    requests.push_back(sessions[i].request);
+  }
+  // a request bound to other associated data must be rejected
+  associated_data[1] = "replayed";
+
+  std::vector<PSCredential> sigs;
+  auto begin = std::chrono::steady_clock::now();
+  auto results = idp.provide_id_batch(requests, associated_data, sigs);
+  auto end = std::chrono::steady_clock::now();
+  std::cout << "IDP-ProvideIDBatch over " << request_num << " requests: "
+            << std::chrono::duration_cast<std::chrono::microseconds>(end - begin).count()
+            << "[µs]" << std::endl;
+  std::vector<std::string> all_attributes{"s", "gamma", "tp"};
+  for (size_t i = 0; i < request_num; i++) {
+    if (results[i] != (i != 1)) {
+      std::cout << "ProvideID batch result mismatch at " << i << std::endl;
+      return;
+    }
+    if (results[i] && !user.verify(user.unblind_credential(sigs[i], sessions[i]), all_attributes)) {
+      std::cout << "ProvideID batch signature verification failure at " << i << std::endl;
+      return;
+    }
+  }
+  std::cout << "****test_provide_id_batch ends without errors****\n"
+            << std::endl;
+}
+
+void
+test_interleaved_issuance_sessions()
+{
+  std::cout << "****test_interleaved_issuance_sessions Start****" << std::endl;
+  G1 g;
+  G2 gg;
+  hashAndMapToG1(g, "abc");
+  hashAndMapToG2(gg, "edf");
+  PSSigner idp(2, g, gg);
+  auto pubKey = idp.key_gen();
+
+  // two requests in flight on the same requester, unblinded in reverse order
+  PSRequester user(pubKey);
+  std::vector<std::tuple<std::string, bool>> attributes1, attributes2;
+  attributes1.push_back(std::make_tuple("alice-secret", true));
+  attributes1.push_back(std::make_tuple("alice", false));
+  attributes2.push_back(std::make_tuple("bob-secret", true));
+  attributes2.push_back(std::make_tuple("bob", false));
+  auto session1 = user.el_passo_request_id(attributes1, "hello1");
+  auto session2 = user.el_passo_request_id(attributes2, "hello2");
+
+  PSCredential sig1, sig2;
+  if (!idp.el_passo_provide_id(session1.request, "hello1", sig1) ||
+      !idp.el_passo_provide_id(session2.request, "hello2", sig2)) {
+    std::cout << "sign request failure" << std::endl;
+    return;
+  }
+  auto ubld_sig2 = user.unblind_credential(sig2, session2);
+  auto ubld_sig1 = user.unblind_credential(sig1, session1);
+  if (!user.verify(ubld_sig1, {"alice-secret", "alice"}) || !user.verify(ubld_sig2, {"bob-secret", "bob"})) {
+    std::cout << "interleaved credential verification failure" << std::endl;
+    return;
+  }
+  if (user.verify(user.unblind_credential(sig1, session2), {"alice-secret", "alice"})) {
+    std::cout << "credential unblinded with another session passed verification" << std::endl;
+    return;
+  }
+  std::cout << "****test_interleaved_issuance_sessions ends without errors****\n"
+            << std::endl;
+}
+
 void
 test_el_passo(size_t total_attribute_num)
 {
@@ -75,7 +336,8 @@ test_el_passo(size_t total_attribute_num)
   attributes.push_back(std::make_tuple("gamma", true));
   attributes.push_back(std::make_tuple("tp", false));
   begin = std::chrono::steady_clock::now();
-  auto request = user.el_passo_request_id(attributes, "hello");
+  auto session = user.el_passo_request_id(attributes, "hello");
+  auto request = session.request;
   end = std::chrono::steady_clock::now();
   std::cout << "User-RequestID: "
             << std::chrono::duration_cast<std::chrono::microseconds>(end - begin).count()
@@ -96,7 +358,7 @@ test_el_passo(size_t total_attribute_num)
 
   // User-UnblindID
   begin = std::chrono::steady_clock::now();
-  auto ubld_sig = user.unblind_credential(sig);
+  auto ubld_sig = user.unblind_credential(sig, session);
   end = std::chrono::steady_clock::now();
   std::cout << "User-UnblindID: "
             << std::chrono::duration_cast<std::chrono::microseconds>(end - begin).count()
@@ -124,6 +386,10 @@ test_el_passo(size_t total_attribute_num)
             << std::chrono::duration_cast<std::chrono::microseconds>(end - begin).count()
             << "[µs]" << std::endl;
   bool result2 = rp.el_passo_verify_id_without_id_retrieval(prove2, "hello", "service");
+  rp.register_service_name("service");
+  bool result3 = rp.el_passo_verify_id(prove, "hello", "service", authority_pk, g, h);
+  bool result4 = rp.el_passo_verify_id_without_id_retrieval(prove2, "hello", "service");
+  bool result5 = rp.el_passo_verify_id(prove, "hello", "other-service", authority_pk, g, h);
   if (!result) {
     std::cout << "EL PASSO Verify ID (with authority) failed" << std::endl;
     return;
@@ -132,14 +398,1019 @@ test_el_passo(size_t total_attribute_num)
     std::cout << "EL PASSO Verify ID (no authority) failed" << std::endl;
     return;
   }
+  if (!result3 || !result4) {
+    std::cout << "EL PASSO Verify ID with registered service name failed" << std::endl;
+    return;
+  }
+  if (result5) {
+    std::cout << "EL PASSO Verify ID accepted a proof for another service name" << std::endl;
+    return;
+  }
   std::cout << "****test_el_passo ends without errors****\n"
             << std::endl;
 }
 
+void
+test_el_passo_batch_verify(size_t proof_num)
+{
+  std::cout << "****test_el_passo_batch_verify Start****" << std::endl;
+  G1 g;
+  G2 gg;
+  hashAndMapToG1(g, "abc");
+  hashAndMapToG2(gg, "edf");
+  PSSigner idp(3, g, gg);
+  auto pubKey = idp.key_gen();
+
+  PSRequester user(pubKey);
+  std::vector<std::tuple<std::string, bool>> attributes;
+  attributes.push_back(std::make_tuple("s", true));
+  attributes.push_back(std::make_tuple("gamma", true));
+  attributes.push_back(std::make_tuple("tp", false));
+  auto session = user.el_passo_request_id(attributes, "hello");
+  auto request = session.request;
+  PSCredential sig;
+  if (!idp.el_passo_provide_id(request, "hello", sig)) {
+    std::cout << "sign request failure" << std::endl;
+    return;
+  }
+  auto ubld_sig = user.unblind_credential(sig, session);
+
+  G1 authority_pk;
+  G1 h;
+  hashAndMapToG1(authority_pk, "ghi");
+  hashAndMapToG1(h, "jkl");
+  std::vector<IdProof> proofs;
+  std::vector<std::string> associated_data;
+  for (size_t i = 0; i < proof_num; i++) {
+    associated_data.push_back("session-" + std::to_string(i));
+    proofs.push_back(user.el_passo_prove_id(ubld_sig, attributes, associated_data[i], "service", authority_pk, g, h));
+  }
+
+  PSVerifier rp(pubKey);
+  rp.register_service_name("service");
+  auto begin = std::chrono::steady_clock::now();
+  auto results = rp.batch_verify_id(proofs, associated_data, "service", authority_pk, g, h);
+  auto end = std::chrono::steady_clock::now();
+  std::cout << "RP-BatchVerifyID over " << proof_num << " proofs: "
+            << std::chrono::duration_cast<std::chrono::microseconds>(end - begin).count()
+            << "[µs]" << std::endl;
+  for (size_t i = 0; i < proof_num; i++) {
+    if (!results[i]) {
+      std::cout << "EL PASSO Batch Verify ID rejected a valid proof" << std::endl;
+      return;
+    }
+  }
+
+  // a signature that does not match the NIZK proof and a proof bound to other associated data
+  proofs[1].sig2 = proofs[0].sig2;
+  associated_data[proof_num - 1] = "replayed";
+  results = rp.batch_verify_id(proofs, associated_data, "service", authority_pk, g, h);
+  for (size_t i = 0; i < proof_num; i++) {
+    bool expected = (i != 1 && i != proof_num - 1);
+    if (results[i] != expected) {
+      std::cout << "EL PASSO Batch Verify ID result mismatch at " << i << std::endl;
+      return;
+    }
+  }
+  std::cout << "****test_el_passo_batch_verify ends without errors****\n"
+            << std::endl;
+}
+
+void
+test_el_passo_presentation_token()
+{
+  std::cout << "****test_el_passo_presentation_token Start****" << std::endl;
+  auto fixture = issue_test_credential();
+  if (!fixture) {
+    return;
+  }
+  PSVerifier rp(fixture->pk);
+
+  // offline part ahead of time, online part at login
+  auto begin = std::chrono::steady_clock::now();
+  auto token = fixture->user.el_passo_precompute_prove_id(fixture->credential, fixture->attributes,
+                                                         fixture->authority_pk, fixture->g, fixture->h);
+  auto mid = std::chrono::steady_clock::now();
+  auto id_proof = fixture->user.el_passo_prove_id(std::move(token), "login", "service");
+  auto end = std::chrono::steady_clock::now();
+  std::cout << "User-ProveID offline: "
+            << std::chrono::duration_cast<std::chrono::microseconds>(mid - begin).count()
+            << "[µs], online: "
+            << std::chrono::duration_cast<std::chrono::microseconds>(end - mid).count()
+            << "[µs]" << std::endl;
+  if (!fixture->verify(rp, id_proof, "login", "service")) {
+    std::cout << "EL PASSO Verify ID with a presentation token failure" << std::endl;
+    return;
+  }
+
+  token = fixture->user.el_passo_precompute_prove_id_without_id_retrieval(fixture->credential,
+                                                                          fixture->attributes);
+  id_proof = fixture->user.el_passo_prove_id(std::move(token), "login", "service");
+  if (id_proof.E1.has_value() || !rp.el_passo_verify_id_without_id_retrieval(id_proof, "login", "service")) {
+    std::cout << "EL PASSO Verify ID without id retrieval with a presentation token failure" << std::endl;
+    return;
+  }
+
+  // a second proof from the same token would reveal the committed attributes
+  bool reuse_rejected = false;
+  try {
+    fixture->user.el_passo_prove_id(std::move(token), "login-again", "service");
+  }
+  catch (std::runtime_error&) {
+    reuse_rejected = true;
+  }
+  if (!reuse_rejected) {
+    std::cout << "presentation token used twice" << std::endl;
+    return;
+  }
+
+  // invalid inputs throw from the constructor rather than on the background thread
+  bool pool_rejected = false;
+  try {
+    auto short_attributes = fixture->attributes;
+    short_attributes.pop_back();
+    PSPresentationTokenPool pool(fixture->user, fixture->credential, short_attributes, 4);
+  }
+  catch (std::runtime_error&) {
+    pool_rejected = true;
+  }
+  if (!pool_rejected) {
+    std::cout << "presentation token pool accepted attributes not matching the key" << std::endl;
+    return;
+  }
+
+  {
+    PSPresentationTokenPool pool(fixture->user, fixture->credential, fixture->attributes,
+                                 fixture->authority_pk, fixture->g, fixture->h, 4);
+    for (size_t i = 0; i < 8; i++) {
+      auto ad = "login-" + std::to_string(i);
+      id_proof = fixture->user.el_passo_prove_id(pool.take(), ad, "service");
+      if (!fixture->verify(rp, id_proof, ad, "service")) {
+        std::cout << "EL PASSO Verify ID with a pooled presentation token failure" << std::endl;
+        return;
+      }
+    }
+  }
+  std::cout << "****test_el_passo_presentation_token ends without errors****\n"
+            << std::endl;
+}
+
+void
+test_verifier_admission()
+{
+  std::cout << "****test_verifier_admission Start****" << std::endl;
+  auto fixture = issue_test_credential();
+  if (!fixture) {
+    return;
+  }
+  auto proof = fixture->prove("hello", "service");
+  auto proof_without_id_retrieval = fixture->prove_without_id_retrieval("hello", "service");
+
+  PSVerifier rp(fixture->pk);
+  if (rp.admit(proof, true) != PSAdmissionStatus::Admitted
+      || rp.admit(proof_without_id_retrieval, false) != PSAdmissionStatus::Admitted
+      || rp.admit(IdProofView(proof.toBufferString()), true) != PSAdmissionStatus::Admitted) {
+    std::cout << "valid proof is not admitted" << std::endl;
+    return;
+  }
+
+  // each malformed proof is rejected with its reason, and by the verification itself
+  auto expect = [&](const IdProof& bad, bool with_id_retrieval, PSAdmissionStatus status) {
+    bool verified = with_id_retrieval ? fixture->verify(rp, bad, "hello", "service")
+                                      : rp.el_passo_verify_id_without_id_retrieval(bad, "hello", "service");
+    if (rp.admit(bad, with_id_retrieval) != status || verified) {
+      std::cout << "malformed proof is not rejected with " << ps_admission_status_message(status) << std::endl;
+      return false;
+    }
+    return true;
+  };
+  auto bad = proof;
+  bad.attributes.push_back("extra");
+  if (!expect(bad, true, PSAdmissionStatus::AttributeCountMismatch)) {
+    return;
+  }
+  bad = proof;
+  bad.rs.pop_back();
+  if (!expect(bad, true, PSAdmissionStatus::ResponseCountMismatch)) {
+    return;
+  }
+  bad = proof;
+  bad.rs.resize(1000, bad.rs[0]);
+  if (!expect(bad, true, PSAdmissionStatus::ResponseCountMismatch)) {
+    return;
+  }
+  bad = proof;
+  bad.attributes[1] = "gamma";
+  if (!expect(bad, true, PSAdmissionStatus::TooFewHiddenAttributes)) {
+    return;
+  }
+  bad = proof;
+  bad.sig1.clear();
+  if (!expect(bad, true, PSAdmissionStatus::ZeroSignature)) {
+    return;
+  }
+  if (!expect(proof_without_id_retrieval, true, PSAdmissionStatus::MissingIdRetrievalToken)
+      || !expect(proof, false, PSAdmissionStatus::ResponseCountMismatch)) {
+    return;
+  }
+
+  // the signature over an attribute list not matching the key is rejected by both parties
+  std::vector<std::string> all_attributes;
+  for (const auto& attribute : fixture->attributes) {
+    all_attributes.push_back(std::get<0>(attribute));
+  }
+  auto short_attributes = all_attributes;
+  short_attributes.pop_back();
+  auto long_attributes = all_attributes;
+  long_attributes.push_back("extra");
+  auto both_verify = [&](const std::vector<std::string>& signed_attributes, bool expected) {
+    return fixture->user.verify(fixture->credential, signed_attributes) == expected
+           && rp.verify(fixture->credential, signed_attributes) == expected;
+  };
+  if (!both_verify(all_attributes, true) || !both_verify(short_attributes, false)
+      || !both_verify(long_attributes, false)) {
+    std::cout << "signature verified over attributes not matching the key" << std::endl;
+    return;
+  }
+  std::cout << "****test_verifier_admission ends without errors****\n"
+            << std::endl;
+}
+
+void
+test_stored_credential()
+{
+  std::cout << "****test_stored_credential Start****" << std::endl;
+  G1 g;
+  G2 gg;
+  hashAndMapToG1(g, "abc");
+  hashAndMapToG2(gg, "edf");
+  PSSigner idp(4, g, gg);
+  auto pubKey = idp.key_gen();
+
+  PSRequester user(pubKey);
+  std::vector<std::tuple<std::string, bool>> attributes;
+  attributes.push_back(std::make_tuple("s", true));
+  attributes.push_back(std::make_tuple("gamma", true));
+  attributes.push_back(std::make_tuple("tp", false));
+  attributes.push_back(std::make_tuple("2026-12-31", false));
+  auto session = user.el_passo_request_id(attributes, "hello");
+  PSCredential sig;
+  if (!idp.el_passo_provide_id(session.request, "hello", sig)) {
+    std::cout << "sign request failure" << std::endl;
+    return;
+  }
+  auto ubld_sig = user.unblind_credential(sig, session);
+  std::vector<std::string> all_attributes{"s", "gamma", "tp", "2026-12-31"};
+  auto credential = user.store_credential(ubld_sig, all_attributes);
+  if (!user.verify(credential)) {
+    std::cout << "stored credential verification failure" << std::endl;
+    return;
+  }
+  try {
+    user.store_credential(ubld_sig, std::vector<std::string>{"s", "gamma", "tp", "2027-12-31"});
+    std::cout << "credential stored with wrong attributes" << std::endl;
+    return;
+  }
+  catch (const std::runtime_error&) {
+  }
+
+  G1 authority_pk;
+  G1 h;
+  hashAndMapToG1(authority_pk, "ghi");
+  hashAndMapToG1(h, "jkl");
+  std::vector<bool> hidden{true, true, false, false};
+  PSVerifier rp(pubKey);
+
+  // s is never disclosed, and gamma is committed whenever it is encrypted for the authority
+  auto prove_rejected = [&](const std::vector<bool>& bad_hidden, bool with_id_retrieval) {
+    try {
+      if (with_id_retrieval) {
+        user.el_passo_prove_id(credential, bad_hidden, "hello", "service", authority_pk, g, h);
+      }
+      else {
+        user.el_passo_prove_id_without_id_retrieval(credential, bad_hidden, "hello", "service");
+      }
+    }
+    catch (const std::runtime_error&) {
+      return true;
+    }
+    return false;
+  };
+  if (!prove_rejected({false, true, true, true}, false) || !prove_rejected({false, true, true, true}, true)
+      || !prove_rejected({true, false, true, true}, true) || prove_rejected({true, false, false, false}, false)) {
+    std::cout << "stored credential proof with s or gamma disclosed" << std::endl;
+    return;
+  }
+
+  for (int round = 0; round < 2; round++) {
+    auto proof = user.el_passo_prove_id(credential, hidden, "hello", "service", authority_pk, g, h);
+    auto proof_without_id_retrieval = user.el_passo_prove_id_without_id_retrieval(credential, hidden, "hello", "service");
+    if (!rp.el_passo_verify_id(proof, "hello", "service", authority_pk, g, h)
+        || !rp.el_passo_verify_id_without_id_retrieval(proof_without_id_retrieval, "hello", "service")) {
+      std::cout << "EL PASSO Verify ID of a stored credential failure in round " << round << std::endl;
+      return;
+    }
+    // the same user at the same RP
+    auto tuple_proof = user.el_passo_prove_id(ubld_sig, attributes, "hello", "service", authority_pk, g, h);
+    if (proof.phi != tuple_proof.phi || proof.attributes != tuple_proof.attributes) {
+      std::cout << "stored credential proof does not match" << std::endl;
+      return;
+    }
+    // a proof disclosing another value is rejected whether the value is registered or not
+    proof.attributes[3] = "2027-12-31";
+    if (rp.el_passo_verify_id(proof, "hello", "service", authority_pk, g, h)) {
+      std::cout << "EL PASSO Verify ID passed with a modified attribute in round " << round << std::endl;
+      return;
+    }
+    // the second round verifies with registered values
+    rp.register_disclosed_attribute(2, "tp");
+    rp.register_disclosed_attribute(3, "2026-12-31");
+    rp.register_disclosed_attribute(3, "2027-12-31");
+  }
+  std::cout << "****test_stored_credential ends without errors****\n"
+            << std::endl;
+}
+
+void
+test_sparse_credential()
+{
+  std::cout << "****test_sparse_credential Start****" << std::endl;
+  G1 g;
+  G2 gg;
+  hashAndMapToG1(g, "abc");
+  hashAndMapToG2(gg, "edf");
+  PSSigner idp(16, g, gg);
+  auto pubKey = idp.key_gen();
+
+  // a credential using slots 0, 1, 5, and 9 of the 16 slots of the key
+  std::vector<bool> used_slots(16, false);
+  used_slots[0] = used_slots[1] = used_slots[5] = used_slots[9] = true;
+  PSRequester user(pubKey);
+  std::vector<std::tuple<std::string, bool>> attributes;
+  attributes.push_back(std::make_tuple("s", true));
+  attributes.push_back(std::make_tuple("gamma", true));
+  attributes.push_back(std::make_tuple("tp", false));
+  attributes.push_back(std::make_tuple("2026-12-31", false));
+  try {
+    user.el_passo_request_id(attributes, std::vector<bool>(16, true), "hello");
+    std::cout << "request with mismatched slots is generated" << std::endl;
+    return;
+  }
+  catch (const std::runtime_error&) {
+  }
+  auto session = user.el_passo_request_id(attributes, used_slots, "hello");
+  auto request = PSCredRequest::fromBufferString(session.request.toBufferString());
+  PSCredential sig;
+  if (request.used_slots != used_slots || !idp.el_passo_provide_id(request, "hello", sig)) {
+    std::cout << "sign sparse request failure" << std::endl;
+    return;
+  }
+  auto ubld_sig = user.unblind_credential(sig, session);
+  auto credential = user.store_credential(ubld_sig, {"s", "gamma", "tp", "2026-12-31"}, used_slots);
+
+  G1 authority_pk;
+  G1 h;
+  hashAndMapToG1(authority_pk, "ghi");
+  hashAndMapToG1(h, "jkl");
+  std::vector<bool> hidden{true, true, false, false};
+  PSVerifier rp(pubKey);
+  auto proof = user.el_passo_prove_id(credential, hidden, "hello", "service", authority_pk, g, h);
+  auto buffer = proof.toBufferString();
+  std::cout << "Sparse IdProof size: " << buffer.size() << std::endl;
+  if (!rp.el_passo_verify_id(IdProof::fromBufferString(buffer), "hello", "service", authority_pk, g, h)
+      || !rp.el_passo_verify_id(IdProofView(buffer), "hello", "service", authority_pk, g, h)
+      || !rp.el_passo_verify_id_without_id_retrieval(
+          user.el_passo_prove_id_without_id_retrieval(credential, hidden, "hello", "service"), "hello", "service")) {
+    std::cout << "EL PASSO Verify ID of a sparse credential failure" << std::endl;
+    return;
+  }
+  std::vector<IdProof> proofs{proof, proof};
+  auto results = rp.batch_verify_id(proofs, {"hello", "hello"}, "service", authority_pk, g, h);
+  if (!results[0] || !results[1]) {
+    std::cout << "batch verification of sparse proofs failure" << std::endl;
+    return;
+  }
+
+  // the same attributes claimed in other slots, or as a dense credential, are rejected
+  auto moved = proof;
+  moved.used_slots[9] = false;
+  moved.used_slots[10] = true;
+  auto dense = proof;
+  dense.used_slots.clear();
+  if (rp.el_passo_verify_id(moved, "hello", "service", authority_pk, g, h)
+      || rp.admit(dense, true) != PSAdmissionStatus::AttributeCountMismatch) {
+    std::cout << "EL PASSO Verify ID passed with modified slots" << std::endl;
+    return;
+  }
+  std::cout << "****test_sparse_credential ends without errors****\n"
+            << std::endl;
+}
+
+void
+test_shared_pub_key_handle()
+{
+  std::cout << "****test_shared_pub_key_handle Start****" << std::endl;
+  G1 g;
+  G2 gg;
+  hashAndMapToG1(g, "abc");
+  hashAndMapToG2(gg, "edf");
+  PSSigner idp(4, g, gg);
+  if (idp.get_pub_key_handle().use_count() != 0) {
+    std::cout << "handle is not empty before key_gen" << std::endl;
+    return;
+  }
+  auto pubKey = idp.key_gen();
+  auto key = idp.get_pub_key_handle();
+  if (key.pk().XX != pubKey.XX || key.pk().YYi != pubKey.YYi) {
+    std::cout << "handle does not hold the generated key" << std::endl;
+    return;
+  }
+
+  PSRequester user(key);
+  std::vector<std::tuple<std::string, bool>> attributes;
+  attributes.push_back(std::make_tuple("s", true));
+  attributes.push_back(std::make_tuple("gamma", true));
+  attributes.push_back(std::make_tuple("tp", false));
+  attributes.push_back(std::make_tuple("2026-12-31", false));
+  auto session = user.el_passo_request_id(attributes, "hello");
+  PSCredential sig;
+  if (!idp.el_passo_provide_id(session.request, "hello", sig)) {
+    std::cout << "sign request failure" << std::endl;
+    return;
+  }
+  auto ubld_sig = user.unblind_credential(sig, session);
+
+  G1 authority_pk;
+  G1 h;
+  hashAndMapToG1(authority_pk, "ghi");
+  hashAndMapToG1(h, "jkl");
+  std::vector<bool> hidden{true, true, false, false};
+  auto proof = user.el_passo_prove_id(ubld_sig, attributes, "hello", "service", authority_pk, g, h);
+
+  // one verifier per thread, all on the same key
+  const size_t thread_num = 4;
+  std::vector<PSVerifier> rps(thread_num, PSVerifier(key));
+  if (key.use_count() != static_cast<long>(thread_num + 3)) {
+    std::cout << "unexpected use count " << key.use_count() << std::endl;
+    return;
+  }
+  std::vector<char> results(thread_num, false);
+  std::vector<std::thread> threads;
+  for (size_t i = 0; i < thread_num; i++) {
+    threads.emplace_back([&, i] {
+      results[i] = rps[i].el_passo_verify_id(proof, "hello", "service", authority_pk, g, h);
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  for (size_t i = 0; i < thread_num; i++) {
+    if (!results[i]) {
+      std::cout << "EL PASSO Verify ID with a shared key failure in thread " << i << std::endl;
+      return;
+    }
+  }
+
+  // re-keying the signer leaves the handles already shared untouched
+  auto new_pub_key = idp.key_gen();
+  if (key.pk().XX != pubKey.XX || !rps[0].el_passo_verify_id(proof, "hello", "service", authority_pk, g, h)) {
+    std::cout << "shared key changed by key_gen" << std::endl;
+    return;
+  }
+
+  // and the new key replaces the old one, with one slot per attribute, and signs
+  if (new_pub_key.Yi.size() != attributes.size() || new_pub_key.YYi.size() != attributes.size()
+      || idp.get_pub_key_handle().pk().YYi != new_pub_key.YYi) {
+    std::cout << "re-keyed signer has " << new_pub_key.Yi.size() << " slots" << std::endl;
+    return;
+  }
+  PSRequester new_user(idp.get_pub_key_handle());
+  auto new_session = new_user.el_passo_request_id(attributes, "hello");
+  if (!idp.el_passo_provide_id(new_session.request, "hello", sig)) {
+    std::cout << "sign request with the new key failure" << std::endl;
+    return;
+  }
+  auto new_proof = new_user.el_passo_prove_id(new_user.unblind_credential(sig, new_session), attributes, "hello",
+                                              "service", authority_pk, g, h);
+  if (!PSVerifier(new_pub_key).el_passo_verify_id(new_proof, "hello", "service", authority_pk, g, h)
+      || rps[0].el_passo_verify_id(new_proof, "hello", "service", authority_pk, g, h)) {
+    std::cout << "EL PASSO Verify ID with the new key failure" << std::endl;
+    return;
+  }
+
+  auto bad_key = pubKey;
+  bad_key.XX.clear();
+  try {
+    PSPubKeyHandle handle(bad_key);
+    std::cout << "handle of an invalid key is constructed" << std::endl;
+    return;
+  }
+  catch (const std::runtime_error&) {
+  }
+  try {
+    PSVerifier rp{PSPubKeyHandle()};
+    std::cout << "verifier of an empty handle is constructed" << std::endl;
+    return;
+  }
+  catch (const std::runtime_error&) {
+  }
+  std::cout << "****test_shared_pub_key_handle ends without errors****\n"
+            << std::endl;
+}
+
+void
+test_verification_service(size_t proof_num)
+{
+  std::cout << "****test_verification_service Start****" << std::endl;
+  auto fixture = issue_test_credential();
+  if (!fixture) {
+    return;
+  }
+  // every third proof is invalid: a swapped signature, other associated data, or truncated
+  std::vector<PSBuffer> buffers;
+  std::vector<std::string> associated_data;
+  std::vector<bool> expected;
+  for (size_t i = 0; i < proof_num; i++) {
+    associated_data.push_back("session-" + std::to_string(i));
+    auto proof = fixture->prove(associated_data[i], "service");
+    expected.push_back(i % 3 != 2);
+    if (i % 9 == 2) {
+      proof.sig2 = proof.sig1;
+    }
+    auto buffer = proof.toBufferString();
+    if (i % 9 == 5) {
+      associated_data[i] = "replayed";
+    }
+    else if (i % 9 == 8) {
+      buffer.resize(buffer.size() / 2);
+    }
+    buffers.push_back(buffer);
+  }
+
+  PSVerifier rp(fixture->pk);
+  rp.register_service_name("service");
+  {
+    PSVerificationService service(rp, "service", fixture->authority_pk, fixture->g, fixture->h, 4, 8, 4);
+    auto begin = std::chrono::steady_clock::now();
+    std::vector<std::future<bool>> results;
+    for (size_t i = 0; i < proof_num; i++) {
+      results.push_back(service.submit(buffers[i], associated_data[i]));
+    }
+    for (size_t i = 0; i < proof_num; i++) {
+      if (results[i].get() != expected[i]) {
+        std::cout << "verification service result mismatch at " << i << std::endl;
+        return;
+      }
+    }
+    auto end = std::chrono::steady_clock::now();
+    std::cout << "RP-VerificationService over " << proof_num << " proofs: "
+              << std::chrono::duration_cast<std::chrono::microseconds>(end - begin).count()
+              << "[µs]" << std::endl;
+  }
+
+  // a service that is full rejects try_submit(), and finishes accepted proofs when destroyed
+  std::atomic<size_t> _valid(0);
+  {
+    std::promise<void> _gate;
+    auto _opened = _gate.get_future().share();
+    auto _count = [&](bool valid) {
+      _opened.wait();  // holds the only worker until the service is full
+      _valid += valid;
+    };
+    PSVerificationService service(rp, "service", fixture->authority_pk, fixture->g, fixture->h, 1, 2);
+    bool _enforced = service.try_submit(buffers[0], associated_data[0], _count)
+        && service.try_submit(buffers[1], associated_data[1], _count)
+        && !service.try_submit(buffers[3], associated_data[3], _count);
+    _gate.set_value();
+    if (!_enforced) {
+      std::cout << "verification service capacity is not enforced" << std::endl;
+      return;
+    }
+  }
+  if (_valid != 2) {
+    std::cout << "verification service dropped accepted proofs" << std::endl;
+    return;
+  }
+
+  // the same proofs through the Unix socket front end
+  PSVerificationService service(rp, "service", fixture->authority_pk, fixture->g, fixture->h, 2);
+  std::string path = "/tmp/ps-verification-test-" + std::to_string(::getpid()) + ".sock";
+  PSVerificationSocketServer server(service, path);
+  PSVerificationSocketClient client1(path);
+  PSVerificationSocketClient client2(path);
+  for (size_t i = 0; i < proof_num; i++) {
+    auto& client = i % 2 ? client1 : client2;
+    if (client.verify(buffers[i], associated_data[i]) != expected[i]) {
+      std::cout << "verification socket result mismatch at " << i << std::endl;
+      return;
+    }
+  }
+  std::cout << "****test_verification_service ends without errors****\n"
+            << std::endl;
+}
+
+void
+test_issuance_service(size_t request_num)
+{
+  std::cout << "****test_issuance_service Start****" << std::endl;
+  G1 g;
+  G2 gg;
+  hashAndMapToG1(g, "abc");
+  hashAndMapToG2(gg, "edf");
+  PSSigner idp(3, g, gg);
+  auto pubKey = idp.key_gen();
+
+  PSRequester user(pubKey);
+  std::vector<std::tuple<std::string, bool>> attributes;
+  attributes.push_back(std::make_tuple("s", true));
+  attributes.push_back(std::make_tuple("gamma", true));
+  attributes.push_back(std::make_tuple("tp", false));
+  std::vector<std::string> all_attributes{"s", "gamma", "tp"};
+  std::vector<PSIssuanceSession> sessions;
+  for (size_t i = 0; i < request_num; i++) {
+    sessions.push_back(user.el_passo_request_id(attributes, "hello-" + std::to_string(i)));
+  }
+
+  {
+    // a batch holds at most request_num - 1 requests, so at least two batches are signed however the window closes
+    PSIssuanceService service(idp, 2, 64, request_num - 1, std::chrono::microseconds(50000));
+    std::vector<std::future<std::optional<PSCredential>>> results;
+    for (size_t i = 0; i < request_num; i++) {
+      // a request bound to other associated data must be rejected
+      results.push_back(service.submit(sessions[i].request, i == 1 ? "replayed" : "hello-" + std::to_string(i)));
+    }
+    for (size_t i = 0; i < request_num; i++) {
+      auto sig = results[i].get();
+      if (sig.has_value() != (i != 1)) {
+        std::cout << "issuance service result mismatch at " << i << std::endl;
+        return;
+      }
+      if (sig && !user.verify(user.unblind_credential(*sig, sessions[i]), all_attributes)) {
+        std::cout << "issuance service signature verification failure at " << i << std::endl;
+        return;
+      }
+    }
+    auto stats = service.stats();
+    std::cout << "IDP-IssuanceService over " << request_num << " requests: " << stats.batches << " batches, p50 "
+              << stats.p50_latency_us << "[µs], p99 " << stats.p99_latency_us << "[µs]" << std::endl;
+    if (stats.issued != request_num - 1 || stats.rejected != 1 || stats.batches < 2 || stats.queue_depth != 0) {
+      std::cout << "unexpected issuance stats" << std::endl;
+      return;
+    }
+  }
+
+  // the same requests through the Unix socket front end, in binary and in base64
+  PSIssuanceService service(idp, 2, 64, 8, std::chrono::microseconds(100));
+  std::string path = "/tmp/ps-issuance-test-" + std::to_string(::getpid()) + ".sock";
+  PSIssuanceSocketServer server(service, path);
+  PSIssuanceSocketClient client(path);
+  PSCredential sig;
+  if (!client.request_id(sessions[0].request, "hello-0", sig)
+      || !user.verify(user.unblind_credential(sig, sessions[0]), all_attributes)) {
+    std::cout << "issuance socket failure" << std::endl;
+    return;
+  }
+  auto base64_sig = client.request_id(sessions[2].request.toBufferString().toBase64(), "hello-2");
+  if (base64_sig.empty()
+      || !user.verify(user.unblind_credential(PSCredential::fromBufferString(PSBuffer::fromBase64(base64_sig)),
+                                              sessions[2]),
+                      all_attributes)) {
+    std::cout << "base64 issuance socket failure" << std::endl;
+    return;
+  }
+  if (client.request_id(sessions[3].request, "replayed", sig) || !client.request_id("garbage", "hello-3").empty()) {
+    std::cout << "issuance socket signed an invalid request" << std::endl;
+    return;
+  }
+  if (client.stats().find("issued=2\n") == std::string::npos) {
+    std::cout << "unexpected issuance socket stats: " << client.stats() << std::endl;
+    return;
+  }
+  std::cout << "****test_issuance_service ends without errors****\n"
+            << std::endl;
+}
+
+void
+test_replay_cache()
+{
+  std::cout << "****test_replay_cache Start****" << std::endl;
+  auto fixture = issue_test_credential();
+  if (!fixture) {
+    return;
+  }
+  auto cache = std::make_shared<PSReplayCache>(std::chrono::milliseconds(200));
+  PSVerifier rp1(fixture->pk);
+  PSVerifier rp2(fixture->pk);
+  rp1.set_replay_cache(cache);
+  rp2.set_replay_cache(cache);
+
+  // a forged proof reusing the challenge of a valid one is rejected and does not block it
+  auto proof = fixture->prove("session-1", "service");
+  auto forged = proof;
+  forged.sig2 = forged.sig1;
+  if (fixture->verify(rp1, forged, "session-1", "service") || cache->size() != 0) {
+    std::cout << "forged proof recorded" << std::endl;
+    return;
+  }
+  auto buffer = proof.toBufferString();
+  if (!fixture->verify(rp1, proof, "session-1", "service")
+      || fixture->verify(rp1, proof, "session-1", "service")
+      || fixture->verify(rp2, IdProofView(buffer), "session-1", "service")) {
+    std::cout << "replayed proof accepted" << std::endl;
+    return;
+  }
+
+  // the second copy in a batch is a replay of the first
+  auto proof2 = fixture->prove_without_id_retrieval("session-2", "service");
+  auto results = rp2.batch_verify_id_without_id_retrieval({proof2, proof2}, {"session-2", "session-2"}, "service");
+  if (!results[0] || results[1] || cache->size() != 2) {
+    std::cout << "replay within a batch accepted" << std::endl;
+    return;
+  }
+
+  // through the verification service, which checks the cache before decoding any point
+  auto proof3 = fixture->prove("session-3", "service");
+  {
+    PSVerificationService service(rp1, "service", fixture->authority_pk, fixture->g, fixture->h, 2);
+    if (!service.submit(proof3.toBufferString(), "session-3").get()
+        || service.submit(proof3.toBufferString(), "session-3").get()
+        || service.submit(buffer, "session-1").get()) {
+      std::cout << "replayed proof accepted by the verification service" << std::endl;
+      return;
+    }
+  }
+
+  // an expired proof is accepted again, its associated data has to be rejected by the RP by then
+  std::this_thread::sleep_for(std::chrono::milliseconds(250));
+  if (!fixture->verify(rp1, proof, "session-1", "service")) {
+    std::cout << "expired proof rejected" << std::endl;
+    return;
+  }
+  std::cout << "****test_replay_cache ends without errors****\n"
+            << std::endl;
+}
+
+void
+test_result_cache()
+{
+  std::cout << "****test_result_cache Start****" << std::endl;
+  auto fixture = issue_test_credential();
+  if (!fixture) {
+    return;
+  }
+  auto cache = std::make_shared<PSResultCache>(2, std::chrono::minutes(5), 1);
+  PSVerifier rp(fixture->pk);
+  rp.set_result_cache(cache);
+
+  // without a replay cache, a retry of an accepted proof is answered from the cache
+  auto buffer = fixture->prove("session-1", "service").toBufferString();
+  if (!fixture->verify(rp, IdProofView(buffer), "session-1", "service")
+      || !fixture->verify(rp, IdProofView(buffer), "session-1", "service")) {
+    std::cout << "retried proof rejected" << std::endl;
+    return;
+  }
+  auto stats = cache->stats();
+  if (stats.hits != 1 || stats.misses != 1 || stats.size != 1 || stats.capacity != 2) {
+    std::cout << "wrong result cache counters" << std::endl;
+    return;
+  }
+
+  // the verdict is bound to the associated data, the service name and the mode
+  if (fixture->verify(rp, IdProofView(buffer), "session-2", "service")
+      || fixture->verify(rp, IdProofView(buffer), "session-1", "other")
+      || rp.el_passo_verify_id_without_id_retrieval(IdProofView(buffer), "session-1", "service")) {
+    std::cout << "verdict reused for another verification" << std::endl;
+    return;
+  }
+
+  // invalid verdicts are cached too, and the least recently used verdict is evicted
+  if (cache->stats().size != 2
+      || !fixture->verify(rp, IdProofView(buffer), "session-1", "service")
+      || cache->stats().hits != 1 || cache->stats().misses != 5) {
+    std::cout << "least recently used verdict not evicted" << std::endl;
+    return;
+  }
+
+  // a verdict expires after the time to live
+  auto short_cache = std::make_shared<PSResultCache>(16, std::chrono::milliseconds(50));
+  rp.set_result_cache(short_cache);
+  fixture->verify(rp, IdProofView(buffer), "session-1", "service");
+  std::this_thread::sleep_for(std::chrono::milliseconds(80));
+  if (!fixture->verify(rp, IdProofView(buffer), "session-1", "service")
+      || short_cache->stats().hits != 0 || short_cache->stats().misses != 2) {
+    std::cout << "expired verdict served" << std::endl;
+    return;
+  }
+
+  // a verdict may not outlive the memory of the replay cache
+  int rejected = 0;
+  PSVerifier rp_short_replay(fixture->pk);
+  rp_short_replay.set_replay_cache(std::make_shared<PSReplayCache>(std::chrono::seconds(1)));
+  try {
+    rp_short_replay.set_result_cache(cache);
+  }
+  catch (std::runtime_error&) {
+    rejected++;
+  }
+  PSVerifier rp_long_results(fixture->pk);
+  rp_long_results.set_result_cache(cache);
+  try {
+    rp_long_results.set_replay_cache(std::make_shared<PSReplayCache>(std::chrono::seconds(1)));
+  }
+  catch (std::runtime_error&) {
+    rejected++;
+  }
+  if (rejected != 2) {
+    std::cout << "result cache outlives the replay cache" << std::endl;
+    return;
+  }
+
+  // with a replay cache, a cached acceptance does not let a replay through
+  auto replay_results = std::make_shared<PSResultCache>(16, std::chrono::minutes(5));
+  PSVerifier replay_rp(fixture->pk);
+  replay_rp.set_replay_cache(std::make_shared<PSReplayCache>(std::chrono::minutes(5)));
+  replay_rp.set_result_cache(replay_results);
+  if (!fixture->verify(replay_rp, IdProofView(buffer), "session-1", "service")
+      || fixture->verify(replay_rp, IdProofView(buffer), "session-1", "service")
+      || replay_results->stats().hits != 1) {
+    std::cout << "replayed proof accepted from the result cache" << std::endl;
+    return;
+  }
+
+  // through the verification service, which looks up the caches before decoding any point
+  auto buffer2 = fixture->prove("session-3", "service").toBufferString();
+  {
+    PSVerificationService service(replay_rp, "service", fixture->authority_pk, fixture->g, fixture->h, 2);
+    if (!service.submit(buffer2, "session-3").get() || service.submit(buffer2, "session-3").get()) {
+      std::cout << "replayed proof accepted by the verification service" << std::endl;
+      return;
+    }
+  }
+  if (fixture->verify(replay_rp, IdProofView(buffer2), "session-3", "service")
+      || replay_results->stats().hits != 3) {
+    std::cout << "verification service verdict not cached" << std::endl;
+    return;
+  }
+  std::cout << "****test_result_cache ends without errors****\n"
+            << std::endl;
+}
+
+void
+test_account_index()
+{
+  std::cout << "****test_account_index Start****" << std::endl;
+  auto fixture = issue_test_credential();
+  if (!fixture) {
+    return;
+  }
+
+  // the same user has the same ID at a service across sign-ons, and another ID at another service
+  auto proof1 = fixture->prove_without_id_retrieval("session-1", "service");
+  auto proof2 = fixture->prove_without_id_retrieval("session-2", "service");
+  auto proof3 = fixture->prove_without_id_retrieval("session-3", "other");
+  auto buffer2 = proof2.toBufferString();
+  auto id = PSVerifier::get_user_id_from_signon_request(proof1);
+  PSAccountId view_id;
+  if (!PSVerifier::get_user_id_from_signon_request(IdProofView(buffer2), view_id) || view_id != id
+      || PSVerifier::get_user_id_from_signon_request(proof3) == id) {
+    std::cout << "wrong user ID" << std::endl;
+    return;
+  }
+
+  std::string path = "/tmp/ps-account-index-test-" + std::to_string(::getpid()) + ".idx";
+  ::unlink(path.c_str());
+  auto other_id = [](uint64_t i) {
+    PSAccountId _id{};
+    for (size_t b = 0; b < 8; b++) {
+      _id[b] = static_cast<uint8_t>(i >> (8 * b));
+    }
+    _id[31] = 0xff;
+    return _id;
+  };
+  {
+    PSAccountIndex index(path, 1000);
+    if (index.capacity() < 1000 || index.size() != 0) {
+      std::cout << "wrong account index capacity" << std::endl;
+      return;
+    }
+    bool second_writer = true;
+    try {
+      PSAccountIndex writer(path, 1000);
+    }
+    catch (std::runtime_error&) {
+      second_writer = false;
+    }
+    if (second_writer) {
+      std::cout << "account index opened by two writers" << std::endl;
+      return;
+    }
+    index.insert(id, 7);
+    index.insert(id, 42);
+    for (uint64_t i = 0; i < 900; i++) {
+      index.insert(other_id(i), i);
+    }
+    if (!index.erase(other_id(5)) || index.erase(other_id(5)) || index.size() != 900) {
+      std::cout << "wrong account index size" << std::endl;
+      return;
+    }
+
+    // readers look up accounts while the writer inserts more
+    std::atomic<bool> found_all(true);
+    std::vector<std::thread> readers;
+    for (int t = 0; t < 3; t++) {
+      readers.emplace_back([&index, &found_all, &other_id] {
+        uint64_t _record;
+        for (uint64_t i = 6; i < 900; i++) {
+          if (!index.find(other_id(i), _record) || _record != i) {
+            found_all = false;
+          }
+        }
+      });
+    }
+    for (uint64_t i = 900; i < 1000; i++) {
+      index.insert(other_id(i), i);
+    }
+    for (auto& reader : readers) {
+      reader.join();
+    }
+    bool full = false;
+    try {
+      for (uint64_t i = 1000; i <= index.capacity(); i++) {
+        index.insert(other_id(i), i);
+      }
+    }
+    catch (std::runtime_error&) {
+      full = true;
+    }
+    if (!found_all || !full) {
+      std::cout << "concurrent account lookup failure" << std::endl;
+      return;
+    }
+    index.erase(other_id(1000));
+    index.sync();
+  }
+
+  // reopening maps the file, the accounts are there without loading them
+  PSAccountIndex reader(path);
+  uint64_t record;
+  bool ok = reader.find(id, record) && record == 42 && !reader.find(other_id(5), record)
+            && reader.find(other_id(999), record) && record == 999
+            && !reader.find(PSVerifier::get_user_id_from_signon_request(proof3), record);
+  bool read_only = false;
+  try {
+    reader.insert(other_id(5), 5);
+  }
+  catch (std::runtime_error&) {
+    read_only = true;
+  }
+  if (!ok || !read_only) {
+    ::unlink(path.c_str());
+    std::cout << "reopened account index failure" << std::endl;
+    return;
+  }
+
+  // a corrupt index without an empty slot fails the lookup of a missing account instead of looping
+  int fd = ::open(path.c_str(), O_RDWR);
+  uint64_t used = 1;
+  bool corrupted = fd >= 0;
+  for (uint64_t i = 0; corrupted && i < reader.capacity() / 3 * 4; i++) {
+    // a 64 byte header followed by slots of 40 bytes, each starting with its record
+    uint64_t slot_record;
+    off_t offset = 64 + 40 * i;
+    corrupted = ::pread(fd, &slot_record, sizeof(slot_record), offset) == sizeof(slot_record)
+                && (slot_record != 0 || ::pwrite(fd, &used, sizeof(used), offset) == sizeof(used));
+  }
+  if (fd >= 0) {
+    ::close(fd);
+  }
+  ::unlink(path.c_str());
+  if (!corrupted || reader.find(other_id(5000), record)) {
+    std::cout << "corrupt account index failure" << std::endl;
+    return;
+  }
+  std::cout << "****test_account_index ends without errors****\n"
+            << std::endl;
+}
+
 int
 main(int argc, char const *argv[])
 {
   initPairing();
+  test_fixed_base_table();
+  test_multi_mul();
   test_ps_sign_verify();
+  test_interleaved_issuance_sessions();
+  test_provide_id_batch(16);
   test_el_passo(3);
+  test_el_passo_batch_verify(8);
+  test_el_passo_presentation_token();
+  test_verifier_admission();
+  test_stored_credential();
+  test_sparse_credential();
+  test_shared_pub_key_handle();
+  test_verification_service(18);
+  test_issuance_service(10);
+  test_replay_cache();
+  test_result_cache();
+  test_account_index();
 }
@@ -35,7 +35,12 @@ EMSCRIPTEN_BINDINGS(my_module) {
   class_<PSVerifier>("PSVerifier")
     .constructor<PSPubKey>()
     .function("verify", &PSVerifier::verify)
-    .function("el_passo_verify_id", &PSVerifier::el_passo_verify_id)
-    .function("el_passo_verify_id_without_id_retrieval", &PSVerifier::el_passo_verify_id_without_id_retrieval)
+    .function("el_passo_verify_id",
+              select_overload<bool(const IdProof&, const std::string&, const std::string&,
+                                   const G1&, const G1&, const G1&) const>(&PSVerifier::el_passo_verify_id))
+    .function("el_passo_verify_id_without_id_retrieval",
+              select_overload<bool(const IdProof&, const std::string&, const std::string&) const>(
+                  &PSVerifier::el_passo_verify_id_without_id_retrieval))
+    .function("register_service_name", &PSVerifier::register_service_name)
     .class_function("get_user_name_from_signon_request", &PSVerifier::get_user_name_from_signon_request);
 }
\ No newline at end of file
@@ -42,12 +42,18 @@ string2AttributeVec(const std::string& vectorStr) {
 }
 
 // a helper function to simplify the parameter passing from Javascript to C++ in EL PASSO RequestID
-std::string
+PSIssuanceSession
 el_passo_request_id(PSRequester& requester, const std::string& vectorStr, const std::string& assoData)
 {
   auto vec = string2AttributeVec(vectorStr);
-  auto request = requester.el_passo_request_id(vec, assoData);
-  return request.toBufferString().toBase64();
+  return requester.el_passo_request_id(vec, assoData);
+}
+
+// a helper function to get the base64 request to be sent to the IdP from an issuance session
+std::string
+session_request_base64(PSIssuanceSession& session)
+{
+  return session.request.toBufferString().toBase64();
 }
 
 // a helper function to simplify the parameter passing from Javascript to C++ in EL PASSO ProveID
@@ -65,6 +71,7 @@ el_passo_prove_id(PSRequester& requester, const PSCredential& credential,
 EMSCRIPTEN_BINDINGS(my_module) {
   function("initPairing", &initPS);
   function("el_passo_request_id", &el_passo_request_id);
+  function("session_request_base64", &session_request_base64);
   function("el_passo_prove_id", &el_passo_prove_id);
 
   class_<PSBuffer>("PSBuffer")
@@ -83,6 +90,8 @@ EMSCRIPTEN_BINDINGS(my_module) {
     .function("toBufferString", &PSCredRequest::toBufferString)
     .class_function("fromBufferString", &PSCredRequest::fromBufferString);
 
+  class_<PSIssuanceSession>("PSIssuanceSession");
+
   class_<IdProof>("IdProof")
     .function("toBufferString", &IdProof::toBufferString)
     .class_function("fromBufferString", &IdProof::fromBufferString);
@@ -90,10 +99,19 @@ EMSCRIPTEN_BINDINGS(my_module) {
   class_<PSRequester>("PSRequester")
     .constructor<PSPubKey>()
     .function("maxAllowedAttrNum", &PSRequester::maxAllowedAttrNum)
-    .function("el_passo_request_id", &PSRequester::el_passo_request_id)
+    .function("el_passo_request_id",
+              select_overload<PSIssuanceSession(const std::vector<std::tuple<std::string, bool>>,
+                                                const std::string&) const>(&PSRequester::el_passo_request_id))
     .function("unblind_credential", &PSRequester::unblind_credential)
-    .function("verify", &PSRequester::verify)
+    .function("verify",
+              select_overload<bool(const PSCredential&, const std::vector<std::string>&) const>(&PSRequester::verify))
     .function("randomize_credential", &PSRequester::randomize_credential)
-    .function("el_passo_prove_id", &PSRequester::el_passo_prove_id)
-    .function("el_passo_prove_id_without_id_retrieval", &PSRequester::el_passo_prove_id_without_id_retrieval);
+    .function("el_passo_prove_id",
+              select_overload<IdProof(const PSCredential&, const std::vector<std::tuple<std::string, bool>>,
+                                      const std::string&, const std::string&,
+                                      const G1&, const G1&, const G1&) const>(&PSRequester::el_passo_prove_id))
+    .function("el_passo_prove_id_without_id_retrieval",
+              select_overload<IdProof(const PSCredential&, const std::vector<std::tuple<std::string, bool>>,
+                                      const std::string&, const std::string&) const>(
+                  &PSRequester::el_passo_prove_id_without_id_retrieval));
 }
\ No newline at end of file
@@ -34,7 +34,8 @@ test_el_passo(size_t total_attribute_num)
   attributes.push_back(std::make_tuple("gamma", true));
   attributes.push_back(std::make_tuple("tp", false));
   begin = std::chrono::steady_clock::now();
-  auto request = user.el_passo_request_id(attributes, "hello");
+  auto session = user.el_passo_request_id(attributes, "hello");
+  auto request = session.request;
   end = std::chrono::steady_clock::now();
   std::cout << "User-RequestID: "
             << std::chrono::duration_cast<std::chrono::microseconds>(end - begin).count()
@@ -57,7 +58,7 @@ test_el_passo(size_t total_attribute_num)
 
   // User-UnblindID
   begin = std::chrono::steady_clock::now();
-  auto ubld_sig = user.unblind_credential(sig);
+  auto ubld_sig = user.unblind_credential(sig, session);
   end = std::chrono::steady_clock::now();
   std::cout << "User-UnblindID: "
             << std::chrono::duration_cast<std::chrono::microseconds>(end - begin).count()